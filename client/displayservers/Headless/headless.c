@@ -0,0 +1,379 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * A display server without a window. Rendering goes to an offscreen pbuffer
+ * on the EGL surfaceless platform (or the default display if unavailable) so
+ * the client can be run and profiled on machines without a display server or
+ * GPU, for example with Mesa's llvmpipe. Input, cursor and clipboard
+ * operations are accepted and ignored.
+ */
+
+#include "interface/displayserver.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include "app.h"
+#include "egl_dynprocs.h"
+#include "util.h"
+#include "common/debug.h"
+#include "common/option.h"
+#include "common/time.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+struct HeadlessState
+{
+  EGLDisplay display;
+  int        width, height;
+  bool       finish;
+
+#ifdef ENABLE_OPENGL
+  EGLConfig  glConfig;
+  EGLSurface glSurface;
+#endif
+};
+
+static struct HeadlessState hs = { 0 };
+
+static struct Option headlessOptions[] =
+{
+  {
+    .module       = "headless",
+    .name         = "enable",
+    .description  = "Render offscreen without a window (for testing)",
+    .type         = OPTION_TYPE_BOOL,
+    .value.x_bool = false,
+  },
+  {
+    .module       = "headless",
+    .name         = "finish",
+    .description  = "Wait for the GPU to complete each frame on swap",
+    .type         = OPTION_TYPE_BOOL,
+    .value.x_bool = true,
+  },
+  {0}
+};
+
+static void headlessSetup(void)
+{
+  option_register(headlessOptions);
+}
+
+static bool headlessProbe(void)
+{
+  return option_get_bool("headless", "enable");
+}
+
+static bool headlessEarlyInit(void)
+{
+  return true;
+}
+
+static EGLDisplay headlessGetEGLDisplay(void)
+{
+  if (hs.display != EGL_NO_DISPLAY)
+    return hs.display;
+
+  const char * early_exts = eglQueryString(NULL, EGL_EXTENSIONS);
+
+  if (util_hasGLExt(early_exts, "EGL_MESA_platform_surfaceless"))
+  {
+    if (g_egl_dynProcs.eglGetPlatformDisplay)
+    {
+      DEBUG_INFO("Using the surfaceless platform");
+      hs.display = g_egl_dynProcs.eglGetPlatformDisplay(
+          EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    else if (g_egl_dynProcs.eglGetPlatformDisplayEXT)
+    {
+      DEBUG_INFO("Using the surfaceless platform (EXT)");
+      hs.display = g_egl_dynProcs.eglGetPlatformDisplayEXT(
+          EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+  }
+
+  if (hs.display == EGL_NO_DISPLAY)
+  {
+    DEBUG_INFO("Using the default EGL display");
+    hs.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  return hs.display;
+}
+
+#ifdef ENABLE_OPENGL
+static bool headlessOpenGLInit(void)
+{
+  EGLint attr[] =
+  {
+    EGL_SURFACE_TYPE     , EGL_PBUFFER_BIT,
+    EGL_CONFORMANT       , EGL_OPENGL_BIT,
+    EGL_RENDERABLE_TYPE  , EGL_OPENGL_BIT,
+    EGL_COLOR_BUFFER_TYPE, EGL_RGB_BUFFER,
+    EGL_RED_SIZE         , 8,
+    EGL_GREEN_SIZE       , 8,
+    EGL_BLUE_SIZE        , 8,
+    EGL_NONE
+  };
+
+  EGLDisplay display = headlessGetEGLDisplay();
+  if (display == EGL_NO_DISPLAY)
+  {
+    DEBUG_ERROR("Failed to get EGL display (eglError: 0x%x)", eglGetError());
+    return false;
+  }
+
+  int maj, min;
+  if (!eglInitialize(display, &maj, &min))
+  {
+    DEBUG_ERROR("Unable to initialize EGL");
+    return false;
+  }
+
+  EGLint num_config;
+  if (!eglChooseConfig(display, attr, &hs.glConfig, 1, &num_config) ||
+      num_config == 0)
+  {
+    DEBUG_ERROR("Failed to choose config (eglError: 0x%x)", eglGetError());
+    return false;
+  }
+
+  const EGLint surfattr[] =
+  {
+    EGL_WIDTH , hs.width,
+    EGL_HEIGHT, hs.height,
+    EGL_NONE
+  };
+
+  hs.glSurface = eglCreatePbufferSurface(display, hs.glConfig, surfattr);
+  if (hs.glSurface == EGL_NO_SURFACE)
+  {
+    DEBUG_ERROR("Failed to create pbuffer surface (eglError: 0x%x)",
+        eglGetError());
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+static bool headlessInit(const LG_DSInitParams params)
+{
+  hs.display = EGL_NO_DISPLAY;
+  hs.width   = params.w;
+  hs.height  = params.h;
+  hs.finish  = option_get_bool("headless", "finish");
+
+#ifdef ENABLE_OPENGL
+  if (params.opengl && !headlessOpenGLInit())
+    return false;
+#endif
+
+  DEBUG_INFO("Headless surface: %dx%d", hs.width, hs.height);
+  app_handleResizeEvent(hs.width, hs.height, 1.0, (struct Border) {0, 0, 0, 0});
+  return true;
+}
+
+static void headlessStartup(void)
+{
+}
+
+static void headlessShutdown(void)
+{
+}
+
+static void headlessFree(void)
+{
+#ifdef ENABLE_OPENGL
+  if (hs.glSurface != EGL_NO_SURFACE)
+  {
+    eglDestroySurface(hs.display, hs.glSurface);
+    hs.glSurface = EGL_NO_SURFACE;
+  }
+#endif
+}
+
+static bool headlessGetProp(LG_DSProperty prop, void * ret)
+{
+  switch(prop)
+  {
+    case LG_DS_WARP_SUPPORT:
+      *(enum LG_DSWarpSupport *)ret = LG_DS_WARP_NONE;
+      return true;
+
+    case LG_DS_OFFSCREEN_SIZE:
+      *(struct Point *)ret = (struct Point) { hs.width, hs.height };
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+#ifdef ENABLE_EGL
+static EGLNativeWindowType headlessGetEGLNativeWindow(void)
+{
+  return (EGLNativeWindowType)0;
+}
+
+static void headlessEGLSwapBuffers(EGLDisplay display, EGLSurface surface,
+    const struct Rect * damage, int count)
+{
+  /* swapping a pbuffer is a no-op, without the finish the frame timings would
+   * only measure how long it took to queue the commands */
+  if (hs.finish)
+    glFinish();
+
+  eglSwapBuffers(display, surface);
+}
+#endif
+
+#ifdef ENABLE_OPENGL
+static LG_DSGLContext headlessGLCreateContext(void)
+{
+  eglBindAPI(EGL_OPENGL_API);
+  return eglCreateContext(hs.display, hs.glConfig, EGL_NO_CONTEXT, NULL);
+}
+
+static void headlessGLDeleteContext(LG_DSGLContext context)
+{
+  eglDestroyContext(hs.display, context);
+}
+
+static void headlessGLMakeCurrent(LG_DSGLContext context)
+{
+  eglMakeCurrent(hs.display, hs.glSurface, hs.glSurface, context);
+}
+
+static void headlessGLSetSwapInterval(int interval)
+{
+  eglSwapInterval(hs.display, interval);
+}
+
+static void headlessGLSwapBuffers(void)
+{
+  if (hs.finish)
+    glFinish();
+
+  eglSwapBuffers(hs.display, hs.glSurface);
+}
+#endif
+
+static void headlessGuestPointerUpdated(double x, double y, double localX,
+    double localY)
+{
+}
+
+static void headlessSetPointer(LG_DSPointer pointer)
+{
+}
+
+static void headlessNoop(void)
+{
+}
+
+static int headlessGetCharCode(int sc)
+{
+  return 0;
+}
+
+static void headlessWarpPointer(int x, int y, bool exiting)
+{
+}
+
+static bool headlessIsValidPointerPos(int x, int y)
+{
+  return x >= 0 && x < hs.width && y >= 0 && y < hs.height;
+}
+
+static void headlessWait(unsigned int time)
+{
+  nsleep((uint64_t)time * 1000000ULL);
+}
+
+static void headlessSetWindowSize(int x, int y)
+{
+  /* the pbuffer is created once with the configured window size */
+}
+
+static bool headlessGetFullscreen(void)
+{
+  return false;
+}
+
+static void headlessSetFullscreen(bool fs)
+{
+}
+
+struct LG_DisplayServerOps LGDS_Headless =
+{
+  .name                = "Headless",
+  .setup               = headlessSetup,
+  .probe               = headlessProbe,
+  .earlyInit           = headlessEarlyInit,
+  .init                = headlessInit,
+  .startup             = headlessStartup,
+  .shutdown            = headlessShutdown,
+  .free                = headlessFree,
+  .getProp             = headlessGetProp,
+
+#ifdef ENABLE_EGL
+  .getEGLDisplay       = headlessGetEGLDisplay,
+  .getEGLNativeWindow  = headlessGetEGLNativeWindow,
+  .eglSwapBuffers      = headlessEGLSwapBuffers,
+#endif
+
+#ifdef ENABLE_OPENGL
+  .glCreateContext     = headlessGLCreateContext,
+  .glDeleteContext     = headlessGLDeleteContext,
+  .glMakeCurrent       = headlessGLMakeCurrent,
+  .glSetSwapInterval   = headlessGLSetSwapInterval,
+  .glSwapBuffers       = headlessGLSwapBuffers,
+#endif
+
+  .guestPointerUpdated = headlessGuestPointerUpdated,
+  .setPointer          = headlessSetPointer,
+  .grabPointer         = headlessNoop,
+  .ungrabPointer       = headlessNoop,
+  .capturePointer      = headlessNoop,
+  .uncapturePointer    = headlessNoop,
+  .grabKeyboard        = headlessNoop,
+  .ungrabKeyboard      = headlessNoop,
+  .getCharCode         = headlessGetCharCode,
+  .warpPointer         = headlessWarpPointer,
+  .realignPointer      = headlessNoop,
+  .isValidPointerPos   = headlessIsValidPointerPos,
+  .requestActivation   = headlessNoop,
+  .inhibitIdle         = headlessNoop,
+  .uninhibitIdle       = headlessNoop,
+  .wait                = headlessWait,
+  .setWindowSize       = headlessSetWindowSize,
+  .setFullscreen       = headlessSetFullscreen,
+  .getFullscreen       = headlessGetFullscreen,
+  .minimize            = headlessNoop
+};
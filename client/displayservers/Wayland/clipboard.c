@@ -31,6 +31,13 @@
 
 #include "app.h"
 #include "common/debug.h"
+#include "common/util.h"
+
+/* clipboard data is read in chunks that grow up to this size, so that large
+ * payloads are neither reallocated and copied as they grow nor sent to SPICE
+ * in one piece */
+#define CLIPBOARD_CHUNK_MIN 4096
+#define CLIPBOARD_CHUNK_MAX (1024 * 1024)
 
 struct DataOffer {
   bool isSelfCopy;
@@ -364,15 +371,66 @@ bool waylandCBInit(void)
   return true;
 }
 
+static bool clipboardReadAddChunk(struct ClipboardRead * data)
+{
+  const size_t size = data->tail ?
+    min(data->tail->size * 2, CLIPBOARD_CHUNK_MAX) : CLIPBOARD_CHUNK_MIN;
+
+  struct ClipboardChunk * chunk = malloc(sizeof(*chunk) + size);
+  if (!chunk)
+    return false;
+
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+
+  if (data->tail)
+    data->tail->next = chunk;
+  else
+    data->head = chunk;
+  data->tail = chunk;
+  return true;
+}
+
 static void clipboardReadCancel(struct ClipboardRead * data)
 {
   waylandPollUnregister(data->fd);
   close(data->fd);
-  free(data->buf);
+
+  while(data->head)
+  {
+    struct ClipboardChunk * next = data->head->next;
+    free(data->head);
+    data->head = next;
+  }
+
   free(data);
   wlCb.currentRead = NULL;
 }
 
+/* SPICE needs the total size up front so nothing can be sent until the source
+ * has closed the pipe, the chunks are then sent and freed one at a time */
+static void clipboardReadSend(struct ClipboardRead * data)
+{
+  app_clipboardNotifySize(data->type, data->numRead);
+  if (data->numRead == 0)
+  {
+    app_clipboardData(data->type, data->head->data, 0);
+    return;
+  }
+
+  while(data->head)
+  {
+    struct ClipboardChunk * chunk = data->head;
+    if (chunk->used)
+      app_clipboardData(data->type, chunk->data, chunk->used);
+
+    data->head = chunk->next;
+    free(chunk);
+  }
+  data->tail = NULL;
+}
+
 static void clipboardReadCallback(uint32_t events, void * opaque)
 {
   struct ClipboardRead * data = opaque;
@@ -382,7 +440,9 @@ static void clipboardReadCallback(uint32_t events, void * opaque)
     return;
   }
 
-  ssize_t result = read(data->fd, data->buf + data->numRead, data->size - data->numRead);
+  struct ClipboardChunk * chunk = data->tail;
+  ssize_t result = read(data->fd, chunk->data + chunk->used,
+      chunk->size - chunk->used);
   if (result < 0)
   {
     DEBUG_ERROR("Failed to read from clipboard: %s", strerror(errno));
@@ -392,24 +452,17 @@ static void clipboardReadCallback(uint32_t events, void * opaque)
 
   if (result == 0)
   {
-    app_clipboardNotifySize(data->type, data->numRead);
-    app_clipboardData(data->type, data->buf, data->numRead);
+    clipboardReadSend(data);
     clipboardReadCancel(data);
     return;
   }
 
+  chunk->used   += result;
   data->numRead += result;
-  if (data->numRead >= data->size)
+  if (chunk->used == chunk->size && !clipboardReadAddChunk(data))
   {
-    data->size *= 2;
-    void * nbuf = realloc(data->buf, data->size);
-    if (!nbuf) {
-      DEBUG_ERROR("Failed to realloc clipboard buffer: %s", strerror(errno));
-      clipboardReadCancel(data);
-      return;
-    }
-
-    data->buf = nbuf;
+    DEBUG_ERROR("Failed to allocate a clipboard chunk: %s", strerror(errno));
+    clipboardReadCancel(data);
   }
 }
 
@@ -455,13 +508,13 @@ void waylandCBRequest(LG_ClipboardData type)
   }
 
   data->fd      = fds[0];
-  data->size    = 4096;
   data->numRead = 0;
-  data->buf     = malloc(data->size);
+  data->head    = NULL;
+  data->tail    = NULL;
   data->offer   = wlCb.offer;
   data->type    = type;
 
-  if (!data->buf)
+  if (!clipboardReadAddChunk(data))
   {
     DEBUG_ERROR("Failed to allocate memory to receive clipboard data");
     close(data->fd);
@@ -473,7 +526,7 @@ void waylandCBRequest(LG_ClipboardData type)
   {
     DEBUG_ERROR("Failed to register clipboard read into epoll: %s", strerror(errno));
     close(data->fd);
-    free(data->buf);
+    free(data->head);
     free(data);
     return;
   }
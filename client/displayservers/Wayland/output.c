@@ -70,14 +70,16 @@ static void outputModeHandler(void * opaque, struct wl_output * wl_output, uint3
     return;
 
   struct WaylandOutput * node = opaque;
-  node->modeWidth  = width;
-  node->modeHeight = height;
+  node->modeWidth   = width;
+  node->modeHeight  = height;
+  node->modeRefresh = refresh;
 }
 
 static void outputDoneHandler(void * opaque, struct wl_output * output)
 {
   struct WaylandOutput * node = opaque;
   outputUpdateScale(node);
+  waylandWindowUpdateRefresh();
 }
 
 static void outputScaleHandler(void * opaque, struct wl_output * output, int32_t scale)
@@ -218,3 +220,13 @@ wl_fixed_t waylandOutputGetScale(struct wl_output * output)
       return node->scale;
   return 0;
 }
+
+int32_t waylandOutputGetRefresh(struct wl_output * output)
+{
+  struct WaylandOutput * node;
+
+  wl_list_for_each(node, &wlWm.outputs, link)
+    if (node->output == output)
+      return node->modeRefresh;
+  return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "wayland.h"
+
+#include <stdbool.h>
+#include <wayland-client.h>
+
+#include "common/debug.h"
+
+void waylandTearingFree(void)
+{
+  if (wlWm.tearingControl)
+    wp_tearing_control_v1_destroy(wlWm.tearingControl);
+
+  if (wlWm.tearingControlManager)
+    wp_tearing_control_manager_v1_destroy(wlWm.tearingControlManager);
+}
+
+void waylandSetVRR(bool enable)
+{
+  if (!wlWm.tearingControlManager)
+  {
+    if (enable)
+      DEBUG_WARN("wp_tearing_control_manager_v1 not exported by compositor, "
+                 "frames will be presented at vblank");
+    return;
+  }
+
+  if (!wlWm.tearingControl)
+    wlWm.tearingControl = wp_tearing_control_manager_v1_get_tearing_control(
+        wlWm.tearingControlManager, wlWm.surface);
+
+  wp_tearing_control_v1_set_presentation_hint(wlWm.tearingControl, enable ?
+      WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC :
+      WP_TEARING_CONTROL_V1_PRESENTATION_HINT_VSYNC);
+  wl_surface_commit(wlWm.surface);
+}
@@ -185,6 +185,7 @@ static void waylandShutdown(void)
 static void waylandFree(void)
 {
   waylandIdleFree();
+  waylandTearingFree();
   waylandWindowFree();
   waylandPresentationFree();
   waylandInputFree();
@@ -202,6 +203,12 @@ static bool waylandGetProp(LG_DSProperty prop, void * ret)
     return true;
   }
 
+  if (prop == LG_DS_REFRESH_RATE)
+  {
+    *(unsigned int*)ret = atomic_load(&wlWm.refreshRate);
+    return *(unsigned int*)ret != 0;
+  }
+
   return false;
 }
 
@@ -255,6 +262,7 @@ struct LG_DisplayServerOps LGDS_Wayland =
   .waitFrame           = waylandWaitFrame,
   .skipFrame           = waylandSkipFrame,
   .stopWaitFrame       = waylandStopWaitFrame,
+  .setVRR              = waylandSetVRR,
   .guestPointerUpdated = waylandGuestPointerUpdated,
   .setPointer          = waylandSetPointer,
   .grabPointer         = waylandGrabPointer,
@@ -19,6 +19,7 @@
  */
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 
 #include <wayland-client.h>
@@ -47,6 +48,7 @@
 #include "wayland-idle-inhibit-unstable-v1-client-protocol.h"
 #include "wayland-xdg-output-unstable-v1-client-protocol.h"
 #include "wayland-xdg-activation-v1-client-protocol.h"
+#include "wayland-tearing-control-v1-client-protocol.h"
 
 typedef void (*WaylandPollCallback)(uint32_t events, void * opaque);
 
@@ -68,6 +70,7 @@ struct WaylandOutput
   int32_t logicalHeight;
   int32_t modeWidth;
   int32_t modeHeight;
+  int32_t modeRefresh;
   bool    modeRotate;
   struct wl_output * output;
   struct zxdg_output_v1 * xdgOutput;
@@ -109,6 +112,7 @@ struct WaylandDSState
   struct wl_compositor * compositor;
 
   wl_fixed_t scale;
+  atomic_uint refreshRate;
   bool fractionalScale;
   bool needsResize;
   bool configured;
@@ -170,6 +174,9 @@ struct WaylandDSState
 
   struct xdg_activation_v1 * xdgActivation;
 
+  struct wp_tearing_control_manager_v1 * tearingControlManager;
+  struct wp_tearing_control_v1 * tearingControl;
+
   struct wp_viewporter * viewporter;
   struct wp_viewport * viewport;
   struct zxdg_output_manager_v1 * xdgOutputManager;
@@ -193,12 +200,19 @@ struct WCBTransfer
   const char ** mimetypes;
 };
 
+struct ClipboardChunk
+{
+  struct ClipboardChunk * next;
+  size_t size;
+  size_t used;
+  uint8_t data[];
+};
+
 struct ClipboardRead
 {
   int fd;
-  size_t size;
   size_t numRead;
-  uint8_t * buf;
+  struct ClipboardChunk * head, * tail;
   enum LG_ClipboardData type;
   struct wl_data_offer * offer;
 };
@@ -259,6 +273,10 @@ void waylandGLSetSwapInterval(int interval);
 void waylandGLSwapBuffers(void);
 #endif
 
+// tearing module
+void waylandTearingFree(void);
+void waylandSetVRR(bool enable);
+
 // idle module
 bool waylandIdleInit(void);
 void waylandIdleFree(void);
@@ -285,6 +303,7 @@ void waylandOutputFree(void);
 void waylandOutputBind(uint32_t name, uint32_t version);
 void waylandOutputTryUnbind(uint32_t name);
 wl_fixed_t waylandOutputGetScale(struct wl_output * output);
+int32_t waylandOutputGetRefresh(struct wl_output * output);
 
 // poll module
 bool waylandPollInit(void);
@@ -305,6 +324,7 @@ void waylandRegistryFree(void);
 bool waylandWindowInit(const char * title, const char * appId, bool fullscreen, bool maximize, bool borderless, bool resizable);
 void waylandWindowFree(void);
 void waylandWindowUpdateScale(void);
+void waylandWindowUpdateRefresh(void);
 void waylandSetWindowSize(int x, int y);
 bool waylandIsValidPointerPos(int x, int y);
 bool waylandWaitFrame(void);
@@ -54,6 +54,22 @@ void waylandWindowUpdateScale(void)
   }
 }
 
+void waylandWindowUpdateRefresh(void)
+{
+  // the compositor paces the window to the fastest output it is on
+  int32_t maxRefresh = 0;
+  struct SurfaceOutput * node;
+
+  wl_list_for_each(node, &wlWm.surfaceOutputs, link)
+  {
+    int32_t refresh = waylandOutputGetRefresh(node->output);
+    if (refresh > maxRefresh)
+      maxRefresh = refresh;
+  }
+
+  atomic_store(&wlWm.refreshRate, maxRefresh);
+}
+
 static void wlSurfaceEnterHandler(void * data, struct wl_surface * surface, struct wl_output * output)
 {
   struct SurfaceOutput * node = malloc(sizeof(*node));
@@ -66,6 +82,7 @@ static void wlSurfaceEnterHandler(void * data, struct wl_surface * surface, stru
   node->output = output;
   wl_list_insert(&wlWm.surfaceOutputs, &node->link);
   waylandWindowUpdateScale();
+  waylandWindowUpdateRefresh();
 }
 
 static void wlSurfaceLeaveHandler(void * data, struct wl_surface * surface, struct wl_output * output)
@@ -78,6 +95,7 @@ static void wlSurfaceLeaveHandler(void * data, struct wl_surface * surface, stru
       break;
     }
   waylandWindowUpdateScale();
+  waylandWindowUpdateRefresh();
 }
 
 static const struct wl_surface_listener wlSurfaceListener = {
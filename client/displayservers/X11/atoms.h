@@ -41,6 +41,7 @@
   DEF_ATOM(_NET_WM_PID, True) \
   DEF_ATOM(WM_DELETE_WINDOW, True) \
   DEF_ATOM(_MOTIF_WM_HINTS, True) \
+  DEF_ATOM(_VARIABLE_REFRESH, False) \
   \
   DEF_ATOM(CLIPBOARD, False) \
   DEF_ATOM(TARGETS, False) \
@@ -0,0 +1,240 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "present.h"
+
+#include "app.h"
+#include "common/debug.h"
+#include "common/option.h"
+#include "common/ringbuffer.h"
+#include "common/util.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// the weights of the moving averages in samples
+#define PERIOD_WEIGHT 16
+#define RENDER_WEIGHT 8
+
+// rendering is forced until this many frames have been timed
+#define WARMUP_FRAMES 60
+
+/* refresh period samples that are way off the estimate are ignored unless
+ * this many arrive in a row, in which case the refresh rate has changed */
+#define PERIOD_REJECT_LIMIT 8
+
+static struct Option options[] =
+{
+  {
+    .module       = "x11",
+    .name         = "jitMargin",
+    .description  = "Time in microseconds to allow on top of the measured render time with jitRender",
+    .type         = OPTION_TYPE_INT,
+    .value.x_int  = 1000,
+  },
+  {0}
+};
+
+struct X11Present
+{
+  // all times are in nanoseconds on CLOCK_MONOTONIC
+  uint64_t margin;
+
+  // the last vblank and the refresh period, written by the event thread
+  _Atomic(uint64_t) ust, msc;
+  _Atomic(uint64_t) period;
+  int               rejected;
+
+  // the vblank the render thread last scheduled a frame for
+  _Atomic(uint64_t) predictedUst, predictedMsc;
+
+  // the render time statistics, only used by the render thread
+  uint64_t frameStart;
+  bool     skipped;
+  int      renderSamples;
+  int64_t  renderMean;
+  int64_t  renderDev;
+
+  RingBuffer  errors;
+  GraphHandle errorGraph;
+};
+
+static struct X11Present ps = { 0 };
+
+static inline uint64_t monotonicTime(void)
+{
+  // the ust XPresent reports is CLOCK_MONOTONIC, nanotime uses the raw clock
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char * errorGraphFormatFn(const char * name,
+    float min, float max, float avg, float freq, float last)
+{
+  static char title[64];
+  snprintf(title, sizeof(title),
+      "%s: min:%4.2f max:%4.2f avg:%4.2f now:%4.2f",
+      name, min, max, avg, last);
+  return title;
+}
+
+void x11PresentSetup(void)
+{
+  option_register(options);
+}
+
+void x11PresentInit(void)
+{
+  ps.margin     = max(0, option_get_int("x11", "jitMargin")) * 1000ULL;
+  ps.skipped    = true;
+  ps.errors     = ringbuffer_new(256, sizeof(float));
+  ps.errorGraph = app_registerGraph("VBLANK ERR", ps.errors, -2.0f, 2.0f,
+      errorGraphFormatFn);
+}
+
+void x11PresentFree(void)
+{
+  app_unregisterGraph(ps.errorGraph);
+  ringbuffer_free(&ps.errors);
+}
+
+uint64_t x11PresentGetPeriod(void)
+{
+  return atomic_load(&ps.period);
+}
+
+void x11PresentComplete(uint64_t ust, uint64_t msc)
+{
+  ust *= 1000ULL;
+
+  const uint64_t lastUst = atomic_load(&ps.ust);
+  const uint64_t lastMsc = atomic_load(&ps.msc);
+  if (lastMsc && msc > lastMsc && ust > lastUst)
+  {
+    const uint64_t sample = (ust - lastUst) / (msc - lastMsc);
+    uint64_t period = atomic_load(&ps.period);
+
+    if (!period)
+      period = sample;
+    else if (sample > period / 2 && sample < period * 2)
+    {
+      period = (int64_t)period +
+        ((int64_t)sample - (int64_t)period) / PERIOD_WEIGHT;
+      ps.rejected = 0;
+    }
+    else if (++ps.rejected > PERIOD_REJECT_LIMIT)
+    {
+      DEBUG_INFO("Refresh period changed to %.3f ms", sample / 1e6);
+      period      = sample;
+      ps.rejected = 0;
+    }
+
+    atomic_store(&ps.period, period);
+  }
+
+  if (msc == atomic_load(&ps.predictedMsc))
+  {
+    const float error =
+      ((int64_t)ust - (int64_t)atomic_load(&ps.predictedUst)) / 1e6f;
+    ringbuffer_push(ps.errors, &error);
+  }
+
+  atomic_store(&ps.ust, ust);
+  atomic_store(&ps.msc, msc);
+}
+
+bool x11PresentWaitFrame(LGEvent * event)
+{
+  // the time since the last call is how long the last frame took to render
+  if (!ps.skipped)
+  {
+    const int64_t sample = monotonicTime() - ps.frameStart;
+    if (!ps.renderSamples)
+      ps.renderMean = sample;
+    else
+    {
+      const int64_t diff = sample - ps.renderMean;
+      ps.renderMean += diff / RENDER_WEIGHT;
+      ps.renderDev  += (llabs(diff) - ps.renderDev) / RENDER_WEIGHT;
+    }
+
+    if (ps.renderSamples < WARMUP_FRAMES)
+      ++ps.renderSamples;
+  }
+  ps.skipped = false;
+
+  // wait for the next vblank
+  lgWaitEvent(event, TIMEOUT_INFINITE);
+
+  const uint64_t ust    = atomic_load(&ps.ust);
+  const uint64_t msc    = atomic_load(&ps.msc);
+  const uint64_t period = atomic_load(&ps.period);
+
+  /* force rendering until the render time is known so that it can be
+   * measured */
+  if (!period || ps.renderSamples < WARMUP_FRAMES)
+  {
+    ps.frameStart = monotonicTime();
+    return true;
+  }
+
+  /* the time needed to have the frame ready, if we can't make it within a
+   * refresh period rendering starts right away */
+  const uint64_t budget = ps.renderMean + 2 * ps.renderDev + ps.margin;
+  const uint64_t lead   = budget < period ? budget : 0;
+
+  // if we woke late, target the next vblank that we can still make
+  uint64_t now    = monotonicTime();
+  uint64_t vblank = ust + period;
+  uint64_t target = msc + 1;
+  if (vblank < now + lead)
+  {
+    const uint64_t skip = (now + lead - vblank) / period + 1;
+    vblank += skip * period;
+    target += skip;
+  }
+
+  atomic_store(&ps.predictedUst, vblank);
+  atomic_store(&ps.predictedMsc, target);
+
+  const uint64_t start = vblank - lead;
+  if (start > now)
+  {
+    const struct timespec ts =
+    {
+      .tv_sec  = start / 1000000000ULL,
+      .tv_nsec = start % 1000000000ULL
+    };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {};
+    now = monotonicTime();
+  }
+
+  ps.frameStart = now;
+  return false;
+}
+
+void x11PresentSkipFrame(void)
+{
+  ps.skipped = true;
+}
@@ -0,0 +1,50 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_X11DS_PRESENT_
+#define _H_X11DS_PRESENT_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common/event.h"
+
+/* Schedules rendering for jitRender from the XPresent complete events, which
+ * report the time of every vblank. The refresh period and the time it takes
+ * to render a frame are tracked so that rendering can start as late as
+ * possible while still making the next vblank. */
+
+void x11PresentSetup(void);
+void x11PresentInit(void);
+void x11PresentFree(void);
+
+// called from the event thread for every PresentCompleteNotify
+void x11PresentComplete(uint64_t ust, uint64_t msc);
+
+// waits for `event` and then until it is time to render the next frame
+bool x11PresentWaitFrame(LGEvent * event);
+
+// called when the frame was not rendered after x11PresentWaitFrame returned
+void x11PresentSkipFrame(void);
+
+// the measured refresh period in nanoseconds, or zero if not yet known
+uint64_t x11PresentGetPeriod(void);
+
+#endif
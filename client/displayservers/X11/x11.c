@@ -24,6 +24,7 @@
 #include "atoms.h"
 #include "clipboard.h"
 #include "cursor.h"
+#include "present.h"
 
 #include "resources/icondata.h"
 #include "resources/no-input-cursor/16.xcur.h"
@@ -168,6 +169,7 @@ static void x11Setup(void)
 {
   X11WM_Default.setup();
   X11WM_i3     .setup();
+  x11PresentSetup();
 }
 
 static bool x11Probe(void)
@@ -690,6 +692,7 @@ static bool x11Init(const LG_DSInitParams params)
     XPresentSelectInput(x11.display, x11.window, PresentCompleteNotifyMask);
     x11.presentPixmap = XCreatePixmap(x11.display, x11.window, 1, 1, 24);
     x11.presentRegion = XFixesCreateRegion(x11.display, &(XRectangle){0}, 1);
+    x11PresentInit();
   }
 
   XMapWindow(x11.display, x11.window);
@@ -772,6 +775,7 @@ static void x11Free(void)
     lgFreeEvent(x11.frameEvent);
     XFreePixmap(x11.display, x11.presentPixmap);
     XFixesDestroyRegion(x11.display, x11.presentRegion);
+    x11PresentFree();
   }
 
   if (x11.window)
@@ -796,6 +800,17 @@ static bool x11GetProp(LG_DSProperty prop, void *ret)
       *(enum LG_DSWarpSupport*)ret = LG_DS_WARP_SCREEN;
       return true;
 
+    case LG_DS_REFRESH_RATE:
+    {
+      // the period is only measured when XPresent is in use for jitRender
+      const uint64_t period = x11.jitRender ? x11PresentGetPeriod() : 0;
+      if (!period)
+        return false;
+
+      *(unsigned int*)ret = 1000000000000ULL / period;
+      return true;
+    }
+
     case LG_DS_MAX_MULTISAMPLE:
     {
       Display * dpy = XOpenDisplay(NULL);
@@ -1471,8 +1486,7 @@ static void x11XPresentEvent(XGenericEventCookie *cookie)
     {
       XPresentCompleteNotifyEvent * e = cookie->data;
       x11DoPresent(e->msc);
-      atomic_store(&x11.presentMsc, e->msc);
-      atomic_store(&x11.presentUst, e->ust);
+      x11PresentComplete(e->ust, e->msc);
       lgSignalEvent(x11.frameEvent);
       break;
     }
@@ -1562,146 +1576,12 @@ static void x11GLSwapBuffers(void)
 
 static bool x11WaitFrame(void)
 {
-  /* wait until we are woken up by the present event */
-  lgWaitEvent(x11.frameEvent, TIMEOUT_INFINITE);
-
-#define WARMUP_TIME 3000000 //2s
-#define CALIBRATION_COUNT 400
-  const uint64_t ust = atomic_load(&x11.presentUst);
-  const uint64_t msc = atomic_load(&x11.presentMsc);
-
-  static bool warmup = true;
-  if (warmup)
-  {
-    static uint64_t expire = 0;
-    if (!expire)
-    {
-      DEBUG_INFO("Warming up...");
-      expire = ust + WARMUP_TIME;
-    }
-
-    if (ust < expire)
-      return false;
-
-    warmup = false;
-    DEBUG_INFO("Warmup done, doing calibration...");
-  }
-
-  /* calibrate a delay to push our presentation time forward as far as
-   * possible without skipping frames */
-  static int      calibrate = 0;
-  static uint64_t lastts    = 0;
-  static uint64_t lastmsc   = 0;
-  static uint64_t delay     = 0;
-
-  uint64_t deltamsc = 0;
-  if (lastts)
-  {
-    uint64_t deltats = ust - lastts;
-    deltamsc = msc - lastmsc;
-
-    if (calibrate == 0)
-    {
-      if (!delay)
-        delay = deltats / 2;
-      else
-      {
-        /* increase the delay until we see a skip */
-        if (deltamsc < 2)
-          delay += 100;
-        else
-        {
-          delay -= 100;
-          ++calibrate;
-          deltamsc = 0;
-        }
-      }
-    }
-    else
-    {
-      if (calibrate < CALIBRATION_COUNT)
-      {
-        /* every skip we back off the delay */
-        if (deltamsc > 1)
-        {
-          /* prevent underflow */
-          if (delay - 100 < delay)
-          {
-            delay -= 100;
-            calibrate = 1;
-            deltamsc = 0;
-          }
-          else
-          {
-            /* if underflow, we are simply too slow, no delay */
-            delay = 0;
-            calibrate = CALIBRATION_COUNT;
-          }
-        }
-
-        /* if we have finished, print out the delay */
-        if (++calibrate == CALIBRATION_COUNT)
-        {
-          /* delays shorter then 1ms are unmaintainable */
-          if (delay < 1000)
-          {
-            delay = 0;
-            DEBUG_INFO("Calibration done, no delay required");
-          }
-          else
-            DEBUG_INFO("Calibration done, delay = %lu us", delay);
-        }
-      }
-    }
-  }
-
-  lastts  = ust;
-  lastmsc = msc;
-
-  /* adjustments if we are still seeing odd skips */
-  const uint64_t lastWMEvent = atomic_load(&x11.lastWMEvent);
-  const uint64_t eventDelta = ust > lastWMEvent ? ust - lastWMEvent : 0;
-
-  static int      skipCount = 0;
-  static uint64_t lastSkipTime = 0;
-
-  if (skipCount > 0 && ust - lastSkipTime > 1000000UL)
-    skipCount = 0;
-
-  if (delay > 0 && deltamsc > 1 && eventDelta > 1000000UL)
-  {
-    /* only adjust if the last skip was less then 1s ago */
-    const bool flag = ust - lastSkipTime < 1000000UL;
-    lastSkipTime = ust;
-
-    if (flag && ++skipCount > 10)
-    {
-      if (delay - 500 < delay)
-      {
-        delay -= 500;
-        DEBUG_INFO("Excessing skipping detected, reduced calibration delay to %lu us", delay);
-        skipCount = 0;
-      }
-      else
-      {
-        delay = 0;
-        DEBUG_WARN("Excessive skipping detected, calibration delay disabled");
-      }
-    }
-  }
-
-  if (delay)
-  {
-    struct timespec ts = { .tv_nsec = delay * 1000 };
-    while(nanosleep(&ts, &ts)) {};
-  }
-
-  /* force rendering until we have finished calibration so we can take into
-   * account how long it takes for the scene to render */
-  if (calibrate < CALIBRATION_COUNT)
-    return true;
+  return x11PresentWaitFrame(x11.frameEvent);
+}
 
-  return false;
+static void x11SkipFrame(void)
+{
+  x11PresentSkipFrame();
 }
 
 static void x11StopWaitFrame(void)
@@ -1709,6 +1589,24 @@ static void x11StopWaitFrame(void)
   lgSignalEvent(x11.frameEvent);
 }
 
+static void x11SetVRR(bool enable)
+{
+  /* the X drivers that support adaptive sync only enable it for windows that
+   * opt in with this property */
+  unsigned long value = enable ? 1 : 0;
+  XChangeProperty(
+    x11.display,
+    x11.window,
+    x11atoms._VARIABLE_REFRESH,
+    XA_CARDINAL,
+    32,
+    PropModeReplace,
+    (unsigned char *)&value,
+    1
+  );
+  XFlush(x11.display);
+}
+
 static void x11GuestPointerUpdated(double x, double y, double localX, double localY)
 {
   if (app_isCaptureMode() || !x11.entered)
@@ -2007,7 +1905,9 @@ struct LG_DisplayServerOps LGDS_X11 =
   .glSwapBuffers      = x11GLSwapBuffers,
 #endif
   .waitFrame           = x11WaitFrame,
+  .skipFrame           = x11SkipFrame,
   .stopWaitFrame       = x11StopWaitFrame,
+  .setVRR              = x11SetVRR,
   .guestPointerUpdated = x11GuestPointerUpdated,
   .setPointer          = x11SetPointer,
   .grabPointer         = x11GrabPointer,
@@ -75,7 +75,6 @@ struct X11DSState
 
   int               xpresentOp;
   bool              jitRender;
-  _Atomic(uint64_t) presentMsc, presentUst;
   uint32_t          presentSerial;
   Pixmap            presentPixmap;
   XserverRegion     presentRegion;
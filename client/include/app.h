@@ -100,6 +100,13 @@ bool app_overlayNeedsRender(void);
  */
 int app_renderOverlay(struct Rect * rects, int maxRects);
 
+/**
+ * returns true if the draw data built by the last call to app_renderOverlay
+ * differs from the call before it, renderers that cache the rendered overlay
+ * only need to redraw it when this is set
+ */
+bool app_overlayChanged(void);
+
 void app_freeOverlays(void);
 
 /**
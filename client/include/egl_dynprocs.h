@@ -38,6 +38,7 @@ struct EGLDynProcs
   PFNGLDEBUGMESSAGECALLBACKKHRPROC    glDebugMessageCallback;
   PFNGLDEBUGMESSAGECALLBACKKHRPROC    glDebugMessageCallbackKHR;
   PFNGLBUFFERSTORAGEEXTPROC           glBufferStorageEXT;
+  PFNGLGETQUERYOBJECTUI64VEXTPROC     glGetQueryObjectui64vEXT;
   PFNEGLCREATEIMAGEPROC               eglCreateImage;
   PFNEGLDESTROYIMAGEPROC              eglDestroyImage;
 };
@@ -53,6 +53,22 @@ typedef enum LG_DSProperty
    * return data type: bool
    */
   LG_DS_WARP_SUPPORT,
+
+  /**
+   * returns the size of the offscreen surface to render to if the display
+   * server has no native window, renderers must then create a pbuffer surface
+   * of this size instead of a window surface
+   * if not implemented LG assumes a native window is available
+   * return data type: struct Point
+   */
+  LG_DS_OFFSCREEN_SIZE,
+
+  /**
+   * returns the refresh rate of the display the window is on in mHz
+   * if not implemented or unknown the host captures at its own rate
+   * return data type: unsigned int
+   */
+  LG_DS_REFRESH_RATE,
 }
 LG_DSProperty;
 
@@ -161,8 +177,8 @@ struct LG_DisplayServerOps
   /* Waits for a good time to render the next frame in time for the next vblank.
    * This is optional and a display server may choose to not implement it.
    *
-   * return true to force the frame to be rendered, this is used by X11 for
-   * calibration */
+   * return true to force the frame to be rendered, this is used by X11 to
+   * measure how long frames take to render */
   bool (*waitFrame)(void);
 
   /* This must be called when waitFrame returns, but no frame is actually rendered. */
@@ -171,6 +187,11 @@ struct LG_DisplayServerOps
   /* This is used to interrupt waitFrame. */
   void (*stopWaitFrame)(void);
 
+  /* Optional, asks the compositor to present frames as soon as they are
+   * submitted instead of at the next vblank, for variable refresh rate
+   * displays */
+  void (*setVRR)(bool enable);
+
   /* dm specific cursor implementations */
   void (*guestPointerUpdated)(double x, double y, double localX, double localY);
   void (*setPointer)(LG_DSPointer pointer);
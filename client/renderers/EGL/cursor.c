@@ -78,6 +78,12 @@ struct EGL_Cursor
   _Atomic(struct CursorSize) size;
   _Atomic(float)             scale;
 
+  // latched by egl_cursorPrepare for egl_cursorRender
+  bool              prepared;
+  struct CursorPos  drawPos;
+  struct CursorSize drawSize;
+  float             drawScale;
+
   struct CursorTex norm;
   struct CursorTex mono;
   struct EGL_Model * model;
@@ -244,9 +250,10 @@ void egl_cursorSetState(EGL_Cursor * cursor, const bool visible,
   atomic_store(&cursor->hs , hs);
 }
 
-struct CursorState egl_cursorRender(EGL_Cursor * cursor,
+struct CursorState egl_cursorPrepare(EGL_Cursor * cursor,
     LG_RendererRotate rotate, int width, int height)
 {
+  cursor->prepared = false;
   if (!cursor->visible)
     return (struct CursorState) { .visible = false };
 
@@ -375,6 +382,23 @@ struct CursorState egl_cursorRender(EGL_Cursor * cursor,
   state.rect.x = max(0, state.rect.x - 1);
   state.rect.y = max(0, state.rect.y - 1);
 
+  cursor->prepared  = true;
+  cursor->drawPos   = pos;
+  cursor->drawSize  = size;
+  cursor->drawScale = scale;
+
+  return state;
+}
+
+void egl_cursorRender(EGL_Cursor * cursor)
+{
+  if (!cursor->prepared)
+    return;
+
+  const struct CursorPos  pos   = cursor->drawPos;
+  const struct CursorSize size  = cursor->drawSize;
+  const float             scale = cursor->drawScale;
+
   glEnable(GL_BLEND);
   switch(cursor->type)
   {
@@ -426,6 +450,4 @@ struct CursorState egl_cursorRender(EGL_Cursor * cursor,
     }
   }
   glDisable(GL_BLEND);
-
-  return state;
 }
@@ -50,5 +50,10 @@ void egl_cursorSetScale(EGL_Cursor * cursor, const float scale);
 void egl_cursorSetState(EGL_Cursor * cursor, const bool visible,
     const float x, const float y, const float hx, const float hy);
 
-struct CursorState egl_cursorRender(EGL_Cursor * cursor,
+/* uploads any pending shape and latches the cursor position, returns the area
+ * that egl_cursorRender will draw to */
+struct CursorState egl_cursorPrepare(EGL_Cursor * cursor,
     LG_RendererRotate rotate, int width, int height);
+
+/* draws the cursor as latched by the last call to egl_cursorPrepare */
+void egl_cursorRender(EGL_Cursor * cursor);
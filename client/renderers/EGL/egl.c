@@ -46,18 +46,20 @@
 #include "damage.h"
 #include "desktop.h"
 #include "cursor.h"
+#include "overlay.h"
 #include "postprocess.h"
 #include "util.h"
 
 #define MAX_BUFFER_AGE       3
 #define DESKTOP_DAMAGE_COUNT 4
-#define MAX_ACCUMULATED_DAMAGE ((KVMFR_MAX_DAMAGE_RECTS + MAX_OVERLAY_RECTS + 2) * MAX_BUFFER_AGE)
+#define MAX_ACCUMULATED_DAMAGE ((KVMFR_MAX_DAMAGE_RECTS + MAX_OVERLAY_RECTS + 2) * MAX_BUFFER_AGE + MAX_OVERLAY_RECTS)
 #define IDX_AGO(counter, i, total) (((counter) + (total) - (i)) % (total))
 
 struct Options
 {
   bool vsync;
   bool doubleBuffer;
+  bool overlayCache;
 };
 
 struct Inst
@@ -77,6 +79,7 @@ struct Inst
   EGL_Desktop     * desktop; // the desktop
   EGL_Cursor      * cursor;  // the mouse cursor
   EGL_Damage      * damage;  // the damage display
+  EGL_Overlay     * overlay; // the cached imgui overlay
   bool              imgui;   // if imgui was initialized
 
   LG_RendererFormat    format;
@@ -224,6 +227,27 @@ static struct Option egl_options[] =
     .type         = OPTION_TYPE_INT,
     .value.x_int  = 10000,
   },
+  {
+    .module       = "egl",
+    .name         = "programCache",
+    .description  = "Cache compiled shader programs to speed up startup",
+    .type         = OPTION_TYPE_BOOL,
+    .value.x_bool = true
+  },
+  {
+    .module       = "egl",
+    .name         = "asyncUpload",
+    .description  = "Upload frames on the frame thread so rendering never waits for them",
+    .type         = OPTION_TYPE_BOOL,
+    .value.x_bool = true
+  },
+  {
+    .module       = "egl",
+    .name         = "overlayCache",
+    .description  = "Only redraw the overlay when it changes",
+    .type         = OPTION_TYPE_BOOL,
+    .value.x_bool = true
+  },
 
   {0}
 };
@@ -263,6 +287,7 @@ static bool egl_create(LG_Renderer ** renderer, const LG_RendererParams params,
 
   this->opt.vsync        = option_get_bool("egl", "vsync");
   this->opt.doubleBuffer = option_get_bool("egl", "doubleBuffer");
+  this->opt.overlayCache = option_get_bool("egl", "overlayCache");
 
   this->translateX   = 0;
   this->translateY   = 0;
@@ -302,6 +327,7 @@ static void egl_deinitialize(LG_Renderer * renderer)
   egl_desktopFree(&this->desktop);
   egl_cursorFree (&this->cursor);
   egl_damageFree (&this->damage);
+  egl_overlayFree(&this->overlay);
 
   LG_LOCK_FREE(this->lock);
   LG_LOCK_FREE(this->desktopDamageLock);
@@ -500,6 +526,9 @@ static void egl_onResize(LG_Renderer * renderer, const int width, const int heig
 
   glViewport(0, 0, this->width, this->height);
 
+  if (this->overlay)
+    egl_overlaySetSize(this->overlay, this->width, this->height);
+
   if (destRect.valid)
   {
     this->translateX     = -1.0f + (((this->destRect.w / 2) + this->destRect.x) * 2) / (float)this->width;
@@ -594,6 +623,12 @@ static bool egl_onFrameFormat(LG_Renderer * renderer, const LG_RendererFormat fo
       return false;
     }
 
+  }
+
+  /* the frame thread is restarted when video is stopped and resumed, make sure
+   * the context is current on the thread we are being called from */
+  if (unlikely(eglGetCurrentContext() != this->frameContext))
+  {
     if (!eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->frameContext))
     {
       DEBUG_ERROR("Failed to make the frame context current");
@@ -741,11 +776,17 @@ static bool egl_renderStartup(LG_Renderer * renderer, bool useDMA)
 {
   struct Inst * this = UPCAST(struct Inst, renderer);
 
-  this->nativeWind = app_getEGLNativeWindow();
-  if (!this->nativeWind)
+  struct Point offscreen;
+  const bool headless = app_getProp(LG_DS_OFFSCREEN_SIZE, &offscreen);
+
+  if (!headless)
   {
-    DEBUG_ERROR("Failed to get EGL native window");
-    return false;
+    this->nativeWind = app_getEGLNativeWindow();
+    if (!this->nativeWind)
+    {
+      DEBUG_ERROR("Failed to get EGL native window");
+      return false;
+    }
   }
 
   this->display = app_getEGLDisplay();
@@ -776,6 +817,7 @@ static bool egl_renderStartup(LG_Renderer * renderer, bool useDMA)
 
   EGLint attr[] =
   {
+    EGL_SURFACE_TYPE   , headless ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
     EGL_BUFFER_SIZE    , 30,
     EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
     EGL_SAMPLE_BUFFERS , maxSamples > 0 ? 1 : 0,
@@ -796,20 +838,39 @@ static bool egl_renderStartup(LG_Renderer * renderer, bool useDMA)
     EGL_NONE
   };
 
-  this->surface = eglCreateWindowSurface(this->display, this->configs, this->nativeWind, surfattr);
-  if (this->surface == EGL_NO_SURFACE)
+  if (headless)
   {
-    // On Nvidia proprietary drivers on Wayland, specifying EGL_RENDER_BUFFER can cause
-    // window creation to fail, so we try again without it.
-    this->surface = eglCreateWindowSurface(this->display, this->configs, this->nativeWind, NULL);
+    const EGLint pbattr[] =
+    {
+      EGL_WIDTH , offscreen.x,
+      EGL_HEIGHT, offscreen.y,
+      EGL_NONE
+    };
+
+    this->surface = eglCreatePbufferSurface(this->display, this->configs, pbattr);
     if (this->surface == EGL_NO_SURFACE)
     {
-      DEBUG_ERROR("Failed to create EGL surface (eglError: 0x%x)", eglGetError());
+      DEBUG_ERROR("Failed to create EGL pbuffer surface (eglError: 0x%x)", eglGetError());
       return false;
     }
-    else
-      DEBUG_WARN("EGL surface creation with EGL_RENDER_BUFFER failed, "
-        "egl:doubleBuffer setting may not be respected");
+  }
+  else
+  {
+    this->surface = eglCreateWindowSurface(this->display, this->configs, this->nativeWind, surfattr);
+    if (this->surface == EGL_NO_SURFACE)
+    {
+      // On Nvidia proprietary drivers on Wayland, specifying EGL_RENDER_BUFFER can cause
+      // window creation to fail, so we try again without it.
+      this->surface = eglCreateWindowSurface(this->display, this->configs, this->nativeWind, NULL);
+      if (this->surface == EGL_NO_SURFACE)
+      {
+        DEBUG_ERROR("Failed to create EGL surface (eglError: 0x%x)", eglGetError());
+        return false;
+      }
+      else
+        DEBUG_WARN("EGL surface creation with EGL_RENDER_BUFFER failed, "
+          "egl:doubleBuffer setting may not be respected");
+    }
   }
 
   const char * client_exts = eglQueryString(this->display, EGL_EXTENSIONS);
@@ -977,12 +1038,21 @@ static bool egl_renderStartup(LG_Renderer * renderer, bool useDMA)
     return false;
   }
 
+  if (!egl_overlayInit(&this->overlay))
+  {
+    DEBUG_ERROR("Failed to initialize the overlay");
+    return false;
+  }
+
+  egl_overlaySetSize(this->overlay, this->width, this->height);
+
   if (!ImGui_ImplOpenGL3_Init("#version 300 es"))
   {
     DEBUG_ERROR("Failed to initialize ImGui");
     return false;
   }
 
+  egl_shaderLogStats();
   app_overlayConfigRegister("EGL", egl_configUI, this);
 
   this->imgui = true;
@@ -1042,6 +1112,114 @@ inline static void renderLetterBox(struct Inst * this)
   }
 }
 
+static inline bool rectIntersects(const struct Rect * a,
+    const struct Rect * b)
+{
+  return a->x < b->x + b->w && b->x < a->x + a->w &&
+         a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static inline bool damageIntersects(const struct FrameDamageRect * a,
+    const struct FrameDamageRect * b)
+{
+  return a->x < b->x + b->width  && b->x < a->x + a->width &&
+         a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+/* merges the overlay rects into bounding boxes until none of them overlap so
+ * that no pixel is composited twice, returns the new count */
+static int mergeOverlayRects(struct Rect * rects, int count)
+{
+  bool merged;
+  do
+  {
+    merged = false;
+    for (int i = 0; i < count; ++i)
+      for (int j = i + 1; j < count; ++j)
+      {
+        if (!rectIntersects(rects + i, rects + j))
+          continue;
+
+        const int x1 = min(rects[i].x, rects[j].x);
+        const int y1 = min(rects[i].y, rects[j].y);
+        const int x2 = max(rects[i].x + rects[i].w, rects[j].x + rects[j].w);
+        const int y2 = max(rects[i].y + rects[i].h, rects[j].y + rects[j].h);
+        rects[i] = (struct Rect) { x1, y1, x2 - x1, y2 - y1 };
+        rects[j--] = rects[--count];
+        merged = true;
+      }
+  }
+  while (merged);
+
+  return count;
+}
+
+/* filters `rects` down to the overlay rects that have to be composited again
+ * this frame, which is all of them if the overlay changed, otherwise only those
+ * with something redrawn below them. The desktop area under each of these is
+ * added to `accumulated` so it is redrawn before the overlay is composited */
+static int overlayDirtyRects(struct Inst * this, const double matrix[6],
+    struct Rect * rects, int count, bool changed,
+    const struct CursorState * cursor, struct DamageRects * accumulated)
+{
+  struct FrameDamageRect footprint[MAX_OVERLAY_RECTS];
+  bool hasFootprint[MAX_OVERLAY_RECTS];
+  bool dirty[MAX_OVERLAY_RECTS];
+
+  // the area inside the letterbox, which is cleared every frame
+  const int dx1 = ceil (this->destRect.x);
+  const int dx2 = floor(this->destRect.x + this->destRect.w);
+  const int dy1 = ceil (this->height - this->destRect.y - this->destRect.h);
+  const int dy2 = floor(this->height - this->destRect.y);
+
+  for (int i = 0; i < count; ++i)
+  {
+    const struct Rect * rect = rects + i;
+    hasFootprint[i] = egl_screenToDesktop(footprint + i, matrix, rect,
+        this->format.frameWidth, this->format.frameHeight);
+
+    dirty[i] = changed ||
+      rect->x < dx1 || rect->x + rect->w > dx2 ||
+      rect->y < dy1 || rect->y + rect->h > dy2 ||
+      (cursor->visible && rectIntersects(rect, &cursor->rect));
+
+    for (int j = 0; !dirty[i] && hasFootprint[i] && j < accumulated->count; ++j)
+      dirty[i] = damageIntersects(footprint + i, accumulated->rects + j);
+  }
+
+  // redrawing the desktop under a dirty rect can spill into its neighbours
+  for (bool grew = true; grew; )
+  {
+    grew = false;
+    for (int i = 0; i < count; ++i)
+    {
+      if (dirty[i] || !hasFootprint[i])
+        continue;
+
+      for (int j = 0; j < count; ++j)
+        if (dirty[j] && hasFootprint[j] &&
+            damageIntersects(footprint + i, footprint + j))
+        {
+          dirty[i] = grew = true;
+          break;
+        }
+    }
+  }
+
+  int dirtyCount = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (!dirty[i])
+      continue;
+
+    if (hasFootprint[i])
+      accumulated->rects[accumulated->count++] = footprint[i];
+    rects[dirtyCount++] = rects[i];
+  }
+
+  return dirtyCount;
+}
+
 static bool egl_render(LG_Renderer * renderer, LG_RendererRotate rotate,
     const bool newFrame, const bool invalidateWindow,
     void (*preSwap)(void * udata), void * udata)
@@ -1056,6 +1234,32 @@ static bool egl_render(LG_Renderer * renderer, LG_RendererRotate rotate,
   struct CursorState cursorState = { .visible = false };
   struct DesktopDamage * desktopDamage;
 
+  /* build the overlay first, if it has not changed the cached copy only needs
+   * to be composited again where the window is redrawn below it */
+  struct Rect damage[KVMFR_MAX_DAMAGE_RECTS + MAX_OVERLAY_RECTS + 2];
+  int damageIdx = app_renderOverlay(damage, MAX_OVERLAY_RECTS);
+  if (unlikely(damageIdx == -1))
+    hasOverlay = true;
+
+  const bool overlayChanged = damageIdx != 0 && (!this->opt.overlayCache ||
+      app_overlayChanged() || egl_overlayIsStale(this->overlay));
+
+  struct Rect overlayRects[MAX_OVERLAY_RECTS];
+  int overlayCount = 0;
+  if (unlikely(damageIdx > 0))
+  {
+    for (int i = 0; i < damageIdx; ++i)
+      damage[i].y = this->height - damage[i].y - damage[i].h;
+
+    memcpy(overlayRects, damage, damageIdx * sizeof(struct Rect));
+    overlayCount = mergeOverlayRects(overlayRects, damageIdx);
+  }
+
+  if (likely(this->destRect.w > 0 && this->destRect.h > 0))
+    cursorState = egl_cursorPrepare(this->cursor,
+        (this->format.rotate + rotate) % LG_ROTATE_MAX,
+        this->width, this->height);
+
   struct DamageRects * accumulated = (struct DamageRects *)alloca(
     sizeof(struct DamageRects) +
     MAX_ACCUMULATED_DAMAGE * sizeof(struct FrameDamageRect)
@@ -1121,11 +1325,27 @@ static bool egl_render(LG_Renderer * renderer, LG_RendererRotate rotate,
         );
     }
 
+    if (likely(!renderAll) && unlikely(overlayCount > 0))
+      overlayCount = overlayDirtyRects(this, matrix, overlayRects,
+          overlayCount, overlayChanged, &cursorState, accumulated);
+
     accumulated->count = rectsMergeOverlapping(accumulated->rects,
         accumulated->count);
   }
   ++this->overlayHistoryIdx;
 
+  if (unlikely(damageIdx != 0))
+  {
+    if (renderAll || damageIdx < 0)
+      overlayCount = -1;
+
+    if (overlayChanged)
+      egl_overlayUpdate(this->overlay);
+    else if (damageIdx > 0)
+      // the dirty rects are composited again without changing their pixels
+      damageIdx = 0;
+  }
+
   if (likely(this->destRect.w > 0 && this->destRect.h > 0))
   {
     if (egl_desktopRender(this->desktop,
@@ -1133,13 +1353,12 @@ static bool egl_render(LG_Renderer * renderer, LG_RendererRotate rotate,
         this->translateX, this->translateY,
         this->scaleX    , this->scaleY    ,
         this->scaleType , rotate, renderAll ? NULL : accumulated))
-    {
-      cursorState = egl_cursorRender(this->cursor,
-          (this->format.rotate + rotate) % LG_ROTATE_MAX,
-          this->width, this->height);
-    }
+      egl_cursorRender(this->cursor);
     else
+    {
+      cursorState.visible = false;
       hasOverlay = true;
+    }
   }
 
   renderLetterBox(this);
@@ -1148,19 +1367,7 @@ static bool egl_render(LG_Renderer * renderer, LG_RendererRotate rotate,
     egl_damageRender(this->damage, rotate, newFrame ? desktopDamage : NULL) |
     invalidateWindow;
 
-  struct Rect damage[KVMFR_MAX_DAMAGE_RECTS + MAX_OVERLAY_RECTS + 2];
-  int damageIdx = app_renderOverlay(damage, MAX_OVERLAY_RECTS);
-  if (unlikely(damageIdx != 0))
-  {
-    if (damageIdx == -1)
-      hasOverlay = true;
-
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
-
-    for (int i = 0; i < damageIdx; ++i)
-      damage[i].y = this->height - damage[i].y - damage[i].h;
-  }
+  egl_overlayRender(this->overlay, overlayRects, overlayCount);
 
   if (likely(damageIdx >= 0 && cursorState.visible))
     damage[damageIdx++] = cursorState.rect;
@@ -75,6 +75,14 @@ typedef struct EGL_FilterOps
       unsigned int width, unsigned int height,
       unsigned int desktopWidth, unsigned int desktopHeight, bool useDMA);
 
+  /* as setup, but the input is the unconverted input of the preceding
+   * internal filter. If the filter can perform the conversion itself it
+   * returns true and the conversion pass is skipped.
+   * this is optional */
+  bool (*setupFused)(EGL_Filter * filter, enum EGL_PixelFormat pixFmt,
+      unsigned int width, unsigned int height,
+      unsigned int desktopWidth, unsigned int desktopHeight, bool useDMA);
+
   /* set the output resolution hint for the filter
    * this is optional and only a hint */
   void (*setOutputResHint)(EGL_Filter * filter,
@@ -99,9 +107,23 @@ typedef struct EGL_FilterOps
 }
 EGL_FilterOps;
 
+#define EGL_FILTER_QUERY_COUNT 3
+
+/* GPU timing of a filter pass, maintained by the post processor */
+typedef struct EGL_FilterTimer
+{
+  GLuint query  [EGL_FILTER_QUERY_COUNT];
+  bool   pending[EGL_FILTER_QUERY_COUNT];
+  int    index;
+  bool   active;
+  float  gpuTime;
+}
+EGL_FilterTimer;
+
 typedef struct EGL_Filter
 {
-  EGL_FilterOps ops;
+  EGL_FilterOps   ops;
+  EGL_FilterTimer timer;
 }
 EGL_Filter;
 
@@ -154,6 +176,18 @@ static inline bool egl_filterSetup(EGL_Filter * filter,
       desktopWidth, desktopHeight, useDMA);
 }
 
+static inline bool egl_filterSetupFused(EGL_Filter * filter,
+    enum EGL_PixelFormat pixFmt, unsigned int width, unsigned int height,
+    unsigned int desktopWidth, unsigned int desktopHeight,
+    bool useDMA)
+{
+  if (!filter->ops.setupFused)
+    return false;
+
+  return filter->ops.setupFused(filter, pixFmt, width, height,
+      desktopWidth, desktopHeight, useDMA);
+}
+
 static inline void egl_filterSetOutputResHint(EGL_Filter * filter,
     unsigned int x, unsigned int y)
 {
@@ -59,9 +59,17 @@ typedef struct EGL_FilterDownscale
   EGL_Shader * linear;
   EGL_Shader * lanczos2;
 
+  // nearest with the 24-bit conversion fused in
+  EGL_Shader * nearest24;
+  EGL_Uniform  uNearest24[2];
+  int          fusedDMA;
+  enum EGL_PixelFormat fusedFmt;
+  bool         fused;
+
   DownscaleFilter filter;
   int useDMA;
   enum EGL_PixelFormat pixFmt;
+  unsigned int inWidth, inHeight;
   unsigned int width, height;
   float pixelSize;
   float vOffset, hOffset;
@@ -158,7 +166,8 @@ static bool egl_filterDownscaleInit(EGL_Filter ** filter)
     return false;
   }
 
-  this->useDMA = -1;
+  this->useDMA   = -1;
+  this->fusedDMA = -1;
 
   if (!egl_shaderInit(&this->nearest))
   {
@@ -178,6 +187,12 @@ static bool egl_filterDownscaleInit(EGL_Filter ** filter)
     goto error_this;
   }
 
+  if (!egl_shaderInit(&this->nearest24))
+  {
+    DEBUG_ERROR("Failed to initialize the shader");
+    goto error_this;
+  }
+
   if (!egl_framebufferInit(&this->fb))
   {
     DEBUG_ERROR("Failed to initialize the framebuffer");
@@ -203,6 +218,7 @@ error_shader:
   egl_shaderFree(&this->nearest);
   egl_shaderFree(&this->linear);
   egl_shaderFree(&this->lanczos2);
+  egl_shaderFree(&this->nearest24);
 
 error_this:
   free(this);
@@ -216,6 +232,7 @@ static void egl_filterDownscaleFree(EGL_Filter * filter)
   egl_shaderFree(&this->nearest);
   egl_shaderFree(&this->linear);
   egl_shaderFree(&this->lanczos2);
+  egl_shaderFree(&this->nearest24);
   egl_framebufferFree(&this->fb);
   glDeleteSamplers(ARRAY_LENGTH(this->sampler), this->sampler);
   free(this);
@@ -297,6 +314,34 @@ static bool egl_filterDownscaleImguiConfig(EGL_Filter * filter)
   return redraw;
 }
 
+static bool setupOutput(EGL_FilterDownscale * this,
+    enum EGL_PixelFormat pixFmt, unsigned int inWidth, unsigned int inHeight,
+    bool fused)
+{
+  const unsigned int width  = (float)inWidth  / this->pixelSize;
+  const unsigned int height = (float)inHeight / this->pixelSize;
+
+  if (this->prepared               &&
+      pixFmt       == this->pixFmt &&
+      fused        == this->fused  &&
+      this->width  == width        &&
+      this->height == height)
+    return this->pixelSize > 1.0f;
+
+  if (!egl_framebufferSetup(this->fb, pixFmt, width, height))
+    return false;
+
+  this->pixFmt   = pixFmt;
+  this->fused    = fused;
+  this->inWidth  = inWidth;
+  this->inHeight = inHeight;
+  this->width    = width;
+  this->height   = height;
+  this->prepared = false;
+
+  return this->pixelSize > 1.0f;
+}
+
 static bool egl_filterDownscaleSetup(EGL_Filter * filter,
     enum EGL_PixelFormat pixFmt, unsigned int width, unsigned int height,
     unsigned int desktopWidth, unsigned int desktopHeight,
@@ -304,9 +349,6 @@ static bool egl_filterDownscaleSetup(EGL_Filter * filter,
 {
   EGL_FilterDownscale * this = UPCAST(EGL_FilterDownscale, filter);
 
-  width  = (float)width  / this->pixelSize;
-  height = (float)height / this->pixelSize;
-
   if (!this->enable)
     return false;
 
@@ -352,21 +394,56 @@ static bool egl_filterDownscaleSetup(EGL_Filter * filter,
     this->useDMA = useDMA;
   }
 
-  if (this->prepared               &&
-      pixFmt       == this->pixFmt &&
-      this->width  == width        &&
-      this->height == height)
-    return this->pixelSize > 1.0f;
+  return setupOutput(this, pixFmt, width, height, false);
+}
 
-  if (!egl_framebufferSetup(this->fb, pixFmt, width, height))
+static bool egl_filterDownscaleSetupFused(EGL_Filter * filter,
+    enum EGL_PixelFormat pixFmt, unsigned int width, unsigned int height,
+    unsigned int desktopWidth, unsigned int desktopHeight,
+    bool useDMA)
+{
+  EGL_FilterDownscale * this = UPCAST(EGL_FilterDownscale, filter);
+
+  /* only nearest samples single texels, the other filters rely on the
+   * hardware filtering of the unpacked texture */
+  if (!this->enable || this->filter != DOWNSCALE_NEAREST ||
+      this->pixelSize <= 1.0f)
     return false;
 
-  this->pixFmt   = pixFmt;
-  this->width    = width;
-  this->height   = height;
-  this->prepared = false;
+  if (pixFmt != EGL_PF_BGR_32 && pixFmt != EGL_PF_RGB_24_32)
+    return false;
 
-  return this->pixelSize > 1.0f;
+  if (this->fusedDMA != useDMA || this->fusedFmt != pixFmt)
+  {
+    EGL_ShaderDefine defines[] =
+    {
+      {"UNPACK_24BIT", pixFmt == EGL_PF_BGR_32 ? "bgra" : "rgba" },
+      {0}
+    };
+
+    if (!egl_shaderCompile(this->nearest24,
+          b_shader_basic_vert    , b_shader_basic_vert_size,
+          b_shader_downscale_frag, b_shader_downscale_frag_size,
+          useDMA, defines)
+       )
+    {
+      DEBUG_ERROR("Failed to compile the shader");
+      return false;
+    }
+
+    this->uNearest24[0].type     = EGL_UNIFORM_TYPE_3F;
+    this->uNearest24[0].location =
+      egl_shaderGetUniform(this->nearest24, "uConfig");
+    this->uNearest24[1].type     = EGL_UNIFORM_TYPE_2F;
+    this->uNearest24[1].location =
+      egl_shaderGetUniform(this->nearest24, "uUnpackedSize");
+
+    this->fusedDMA = useDMA;
+    this->fusedFmt = pixFmt;
+    this->prepared = false;
+  }
+
+  return setupOutput(this, EGL_PF_BGRA, desktopWidth, desktopHeight, true);
 }
 
 static void egl_filterDownscaleGetOutputRes(EGL_Filter * filter,
@@ -388,6 +465,18 @@ static bool egl_filterDownscalePrepare(EGL_Filter * filter)
   switch (this->filter)
   {
     case DOWNSCALE_NEAREST:
+      if (this->fused)
+      {
+        this->uNearest24[0].f[0] = this->pixelSize;
+        this->uNearest24[0].f[1] = this->vOffset;
+        this->uNearest24[0].f[2] = this->hOffset;
+        this->uNearest24[1].f[0] = this->inWidth;
+        this->uNearest24[1].f[1] = this->inHeight;
+        egl_shaderSetUniforms(this->nearest24, this->uNearest24,
+            ARRAY_LENGTH(this->uNearest24));
+        break;
+      }
+
       this->uNearest.f[0] = this->pixelSize;
       this->uNearest.f[1] = this->vOffset;
       this->uNearest.f[2] = this->hOffset;
@@ -418,7 +507,7 @@ static EGL_Texture * egl_filterDownscaleRun(EGL_Filter * filter,
   {
     case DOWNSCALE_NEAREST:
       glBindSampler(0, this->sampler[0]);
-      shader = this->nearest;
+      shader = this->fused ? this->nearest24 : this->nearest;
       break;
 
     case DOWNSCALE_LINEAR:
@@ -453,6 +542,7 @@ EGL_FilterOps egl_filterDownscaleOps =
   .saveState    = egl_filterDownscaleSaveState,
   .loadState    = egl_filterDownscaleLoadState,
   .setup        = egl_filterDownscaleSetup,
+  .setupFused   = egl_filterDownscaleSetupFused,
   .getOutputRes = egl_filterDownscaleGetOutputRes,
   .prepare      = egl_filterDownscalePrepare,
   .run          = egl_filterDownscaleRun
@@ -0,0 +1,176 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "overlay.h"
+#include "common/debug.h"
+
+#include "framebuffer.h"
+#include "model.h"
+#include "shader.h"
+
+#include "cimgui.h"
+#include "generator/output/cimgui_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+
+// these headers are auto generated by cmake
+#include "overlay.vert.h"
+#include "overlay.frag.h"
+
+struct EGL_Overlay
+{
+  EGL_Shader      * shader;
+  EGL_Model       * model;
+  EGL_Framebuffer * fb;
+
+  int  width, height;
+  bool stale;
+};
+
+bool egl_overlayInit(EGL_Overlay ** overlay)
+{
+  EGL_Overlay * this = calloc(1, sizeof(*this));
+  if (!this)
+  {
+    DEBUG_ERROR("Failed to malloc EGL_Overlay");
+    return false;
+  }
+  *overlay = this;
+
+  if (!egl_shaderInit(&this->shader))
+  {
+    DEBUG_ERROR("Failed to initialize the overlay shader");
+    return false;
+  }
+
+  if (!egl_shaderCompile(this->shader,
+        b_shader_overlay_vert, b_shader_overlay_vert_size,
+        b_shader_overlay_frag, b_shader_overlay_frag_size,
+        false, NULL))
+  {
+    DEBUG_ERROR("Failed to compile the overlay shader");
+    return false;
+  }
+
+  if (!egl_modelInit(&this->model))
+  {
+    DEBUG_ERROR("Failed to initialize the overlay model");
+    return false;
+  }
+
+  egl_modelSetDefault(this->model, false);
+  egl_modelSetShader(this->model, this->shader);
+
+  if (!egl_framebufferInit(&this->fb))
+  {
+    DEBUG_ERROR("Failed to initialize the overlay framebuffer");
+    return false;
+  }
+
+  egl_modelSetTexture(this->model, egl_framebufferGetTexture(this->fb));
+  this->stale = true;
+  return true;
+}
+
+void egl_overlayFree(EGL_Overlay ** overlay)
+{
+  EGL_Overlay * this = *overlay;
+  if (!this)
+    return;
+
+  if (this->fb)
+    egl_framebufferFree(&this->fb);
+  egl_modelFree (&this->model );
+  egl_shaderFree(&this->shader);
+
+  free(this);
+  *overlay = NULL;
+}
+
+void egl_overlaySetSize(EGL_Overlay * this, int width, int height)
+{
+  if (this->width == width && this->height == height)
+    return;
+
+  this->width  = width;
+  this->height = height;
+  this->stale  = true;
+}
+
+bool egl_overlayIsStale(EGL_Overlay * this)
+{
+  return this->stale;
+}
+
+bool egl_overlayUpdate(EGL_Overlay * this)
+{
+  if (this->width <= 0 || this->height <= 0)
+    return false;
+
+  if (this->stale && !egl_framebufferSetup(this->fb, EGL_PF_RGBA,
+        this->width, this->height))
+  {
+    DEBUG_ERROR("Failed to setup the overlay framebuffer");
+    return false;
+  }
+
+  egl_framebufferBind(this->fb);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  /* ImGui blends the alpha channel with (ONE, ONE_MINUS_SRC_ALPHA) which
+   * leaves the color premultiplied in the cleared framebuffer */
+  ImGui_ImplOpenGL3_NewFrame();
+  ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, this->width, this->height);
+
+  this->stale = false;
+  return true;
+}
+
+void egl_overlayRender(EGL_Overlay * this, const struct Rect * rects,
+    int count)
+{
+  if (this->stale || count == 0)
+    return;
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  if (count < 0)
+    egl_modelRender(this->model);
+  else
+  {
+    glEnable(GL_SCISSOR_TEST);
+    for(int i = 0; i < count; ++i)
+    {
+      glScissor(rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+      egl_modelRender(this->model);
+    }
+    glDisable(GL_SCISSOR_TEST);
+  }
+
+  glDisable(GL_BLEND);
+}
@@ -0,0 +1,46 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "common/types.h"
+
+/* The ImGui overlay is rendered into a texture that is only redrawn when the
+ * draw data changes, and composited over the parts of the window that need it
+ * every frame */
+typedef struct EGL_Overlay EGL_Overlay;
+
+bool egl_overlayInit(EGL_Overlay ** overlay);
+void egl_overlayFree(EGL_Overlay ** overlay);
+
+void egl_overlaySetSize(EGL_Overlay * overlay, int width, int height);
+
+/* returns true if the cached overlay is out of date */
+bool egl_overlayIsStale(EGL_Overlay * overlay);
+
+/* renders the current ImGui draw data into the cache */
+bool egl_overlayUpdate(EGL_Overlay * overlay);
+
+/* composites the cache over `rects`, which are in window coordinates with a
+ * bottom left origin, or over the entire window if `count` is -1 */
+void egl_overlayRender(EGL_Overlay * overlay, const struct Rect * rects,
+    int count);
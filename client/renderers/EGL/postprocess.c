@@ -37,8 +37,11 @@
 #include "common/paths.h"
 #include "common/stringlist.h"
 #include "common/stringutils.h"
+#include "common/time.h"
 #include "common/vector.h"
 
+#include "egl_dynprocs.h"
+
 static const EGL_FilterOps * EGL_Filters[] =
 {
   &egl_filterDownscaleOps,
@@ -55,6 +58,15 @@ struct EGL_PostProcess
 
   EGL_DesktopRects * rects;
 
+  /* the conversion filter that was skipped by fusing it into the next filter
+   * during the last run */
+  EGL_Filter * fusedFrom, * fusedInto;
+
+  /* GPU timer queries are only issued while the config UI is open */
+  bool     timingSupported;
+  bool     timingDisjoint;
+  uint64_t timingRequested;
+
   StringList presets;
   char * presetDir;
   int activePreset;
@@ -453,6 +465,33 @@ static void drawDropTarget(void)
   igPopStyleColor(1);
 }
 
+static void timingUI(struct EGL_PostProcess * this)
+{
+  this->timingRequested = nanotime();
+
+  const Vector * lists[] =
+  {
+    &this->internalFilters,
+    &this->filters,
+    NULL
+  };
+
+  igText("GPU time per pass:");
+
+  EGL_Filter * filter;
+  for(const Vector ** filters = lists; *filters; ++filters)
+    vector_forEach(filter, *filters)
+    {
+      if (filter == this->fusedFrom)
+        igText("  %s: fused into %s", filter->ops.name,
+            this->fusedInto->ops.name);
+      else if (filter->timer.active)
+        igText("  %s: %.3f ms", filter->ops.name, filter->timer.gpuTime);
+    }
+
+  igSeparator();
+}
+
 static void configUI(void * opaque, int * id)
 {
   struct EGL_PostProcess * this = opaque;
@@ -461,6 +500,9 @@ static void configUI(void * opaque, int * id)
   redraw |= presetsUI(this);
   igSeparator();
 
+  if (this->timingSupported)
+    timingUI(this);
+
   static size_t mouseIdx = -1;
   static bool   moving   = false;
   static size_t moveIdx  = 0;
@@ -568,6 +610,11 @@ bool egl_postProcessInit(EGL_PostProcess ** pp)
     goto error_internal;
   }
 
+  const char * gl_exts = (const char *)glGetString(GL_EXTENSIONS);
+  this->timingSupported = gl_exts &&
+    util_hasGLExt(gl_exts, "GL_EXT_disjoint_timer_query") &&
+    g_egl_dynProcs.glGetQueryObjectui64vEXT;
+
   loadPresetList(this);
   reorderFilters(this);
   app_overlayConfigRegisterTab("EGL Filters", configUI, this);
@@ -595,11 +642,19 @@ void egl_postProcessFree(EGL_PostProcess ** pp)
 
   EGL_Filter ** filter;
   vector_forEachRef(filter, &this->filters)
+  {
+    if ((*filter)->timer.query[0])
+      glDeleteQueries(EGL_FILTER_QUERY_COUNT, (*filter)->timer.query);
     egl_filterFree(filter);
+  }
   vector_destroy(&this->filters);
 
   vector_forEachRef(filter, &this->internalFilters)
+  {
+    if ((*filter)->timer.query[0])
+      glDeleteQueries(EGL_FILTER_QUERY_COUNT, (*filter)->timer.query);
     egl_filterFree(filter);
+  }
   vector_destroy(&this->internalFilters);
 
   free(this->presetDir);
@@ -630,6 +685,81 @@ bool egl_postProcessConfigModified(EGL_PostProcess * this)
   return atomic_load(&this->modified);
 }
 
+/**
+ * Looks for the filter that would run directly after the conversion filter at
+ * `index` and asks it to consume the unconverted input itself, saving a full
+ * resolution intermediate pass.
+ *
+ * Returns the index of the fused filter, or -1 if the conversion must run.
+ */
+static int findFusable(EGL_Filter ** filters, int count, int index,
+    EGL_PixelFormat pixFmt, unsigned int sizeX, unsigned int sizeY,
+    int desktopWidth, int desktopHeight,
+    unsigned int targetX, unsigned int targetY, bool useDMA)
+{
+  unsigned int convX, convY;
+  EGL_PixelFormat convFmt;
+  egl_filterGetOutputRes(filters[index], &convX, &convY, &convFmt);
+
+  for(int i = index + 1; i < count; ++i)
+  {
+    EGL_Filter * filter = filters[i];
+    egl_filterSetOutputResHint(filter, targetX, targetY);
+
+    if (egl_filterSetupFused(filter, pixFmt, sizeX, sizeY,
+          desktopWidth, desktopHeight, useDMA) &&
+        egl_filterPrepare(filter))
+      return i;
+
+    // a filter that runs on the converted output prevents fusing
+    if (egl_filterSetup(filter, convFmt, convX, convY,
+          desktopWidth, desktopHeight, false) &&
+        egl_filterPrepare(filter))
+      return -1;
+  }
+
+  return -1;
+}
+
+static bool timerBegin(EGL_PostProcess * this, EGL_Filter * filter)
+{
+  EGL_FilterTimer * t = &filter->timer;
+  if (!t->query[0])
+    glGenQueries(EGL_FILTER_QUERY_COUNT, t->query);
+
+  const int i = t->index;
+  if (t->pending[i])
+  {
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(t->query[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    // the GPU is further behind than the query ring, skip timing this pass
+    if (!available)
+      return false;
+
+    GLuint64 elapsed;
+    g_egl_dynProcs.glGetQueryObjectui64vEXT(t->query[i], GL_QUERY_RESULT,
+        &elapsed);
+    t->pending[i] = false;
+
+    if (!this->timingDisjoint)
+      t->gpuTime = t->gpuTime * 0.9f + (elapsed / 1e6f) * 0.1f;
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED_EXT, t->query[i]);
+  return true;
+}
+
+static void timerEnd(EGL_Filter * filter)
+{
+  EGL_FilterTimer * t = &filter->timer;
+  glEndQuery(GL_TIME_ELAPSED_EXT);
+
+  t->pending[t->index] = true;
+  t->active            = true;
+  t->index             = (t->index + 1) % EGL_FILTER_QUERY_COUNT;
+}
+
 bool egl_postProcessRun(EGL_PostProcess * this, EGL_Texture * tex,
     EGL_DesktopRects * rects, int desktopWidth, int desktopHeight,
     unsigned int targetX, unsigned int targetY, bool useDMA)
@@ -664,18 +794,37 @@ bool egl_postProcessRun(EGL_PostProcess * this, EGL_Texture * tex,
     .height = desktopHeight,
   };
 
-  EGL_Filter * filter;
   EGL_Texture * texture = tex;
 
-  const Vector * lists[] =
+  const size_t internalCount = vector_size(&this->internalFilters);
+  const size_t count         = internalCount + vector_size(&this->filters);
+  EGL_Filter * filters[count];
+  memcpy(filters, vector_data(&this->internalFilters),
+      internalCount * sizeof(*filters));
+  memcpy(filters + internalCount, vector_data(&this->filters),
+      (count - internalCount) * sizeof(*filters));
+
+  const bool timing = this->timingSupported &&
+    nanotime() - this->timingRequested < 1000000000ULL;
+
+  if (timing)
   {
-    &this->internalFilters,
-    &this->filters,
-    NULL
-  };
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    this->timingDisjoint = disjoint;
+  }
 
-  for(const Vector ** filters = lists; *filters; ++filters)
-    vector_forEach(filter, *filters)
+  this->fusedFrom = NULL;
+  this->fusedInto = NULL;
+
+  for(int i = 0; i < count; ++i)
+    filters[i]->timer.active = false;
+
+  for(int i = 0; i < count; ++i)
+  {
+    EGL_Filter * filter = filters[i];
+
+    if (filter != this->fusedInto)
     {
       egl_filterSetOutputResHint(filter, targetX, targetY);
 
@@ -684,17 +833,37 @@ bool egl_postProcessRun(EGL_PostProcess * this, EGL_Texture * tex,
           !egl_filterPrepare(filter))
         continue;
 
-      texture = egl_filterRun(filter, &filterRects, texture);
-      egl_filterGetOutputRes(filter, &sizeX, &sizeY, &pixFmt);
+      if (filter->ops.type == EGL_FILTER_TYPE_INTERNAL)
+      {
+        const int fused = findFusable(filters, count, i, pixFmt, sizeX, sizeY,
+            desktopWidth, desktopHeight, targetX, targetY, useDMA);
+
+        if (fused >= 0)
+        {
+          // every filter in between has been bypassed
+          this->fusedFrom = filter;
+          this->fusedInto = filters[fused];
+          i = fused - 1;
+          continue;
+        }
+      }
+    }
+
+    const bool timed = timing && timerBegin(this, filter);
+    texture = egl_filterRun(filter, &filterRects, texture);
+    if (timed)
+      timerEnd(filter);
 
-      if (lastFilter)
-        egl_filterRelease(lastFilter);
+    egl_filterGetOutputRes(filter, &sizeX, &sizeY, &pixFmt);
 
-      lastFilter = filter;
+    if (lastFilter)
+      egl_filterRelease(lastFilter);
 
-      // the first filter to run will convert to a normal texture
-      useDMA = false;
-    }
+    lastFilter = filter;
+
+    // the first filter to run will convert to a normal texture
+    useDMA = false;
+  }
 
   this->output  = texture;
   this->outputX = sizeX;
@@ -19,13 +19,48 @@
  */
 
 #include "shader.h"
+#include "common/array.h"
 #include "common/debug.h"
+#include "common/option.h"
+#include "common/paths.h"
 #include "common/stringutils.h"
+#include "common/time.h"
 #include "util.h"
 
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PROGRAM_CACHE_MAGIC   0x4250474c // LGPB
+#define PROGRAM_CACHE_VERSION 1
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+}
+ProgramCacheHeader;
+
+static struct
+{
+  bool     init;
+  bool     enabled;
+  uint64_t deviceKey;
+  char     dir[PATH_MAX];
+
+  int      hits;
+  int      misses;
+  uint64_t time;
+}
+l_cache = { 0 };
 
 struct EGL_Shader
 {
@@ -98,6 +133,180 @@ bool egl_shaderLoad(EGL_Shader * this,
   return ret;
 }
 
+static uint64_t fnv1a(uint64_t hash, const void * data, size_t size)
+{
+  const uint8_t * p = (const uint8_t *)data;
+  for(size_t i = 0; i < size; ++i)
+  {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void programCacheInit(void)
+{
+  if (l_cache.init)
+    return;
+
+  l_cache.init = true;
+  if (!option_get_bool("egl", "programCache"))
+    return;
+
+  /* the context is created as ES 2.0 where program binaries are only an
+   * extension, the drivers usually provide a 3.x context regardless */
+  int major = 0;
+  const char * version = (const char *)glGetString(GL_VERSION);
+  if (!version || sscanf(version, "OpenGL ES %d.", &major) != 1 || major < 3)
+  {
+    DEBUG_INFO("OpenGL ES 3.0 is not available, program cache disabled");
+    return;
+  }
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats <= 0)
+  {
+    DEBUG_INFO("Program binaries are not supported, program cache disabled");
+    return;
+  }
+
+  // a binary is only valid for the exact driver that produced it
+  const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  uint64_t key = 0xcbf29ce484222325ULL;
+  for(int i = 0; i < ARRAY_LENGTH(strings); ++i)
+  {
+    const char * str = (const char *)glGetString(strings[i]);
+    if (str)
+      key = fnv1a(key, str, strlen(str) + 1);
+  }
+  l_cache.deviceKey = key;
+
+  snprintf(l_cache.dir, sizeof(l_cache.dir), "%s/programs", lgDataDir());
+  if (mkdir(l_cache.dir, S_IRWXU) < 0 && errno != EEXIST)
+  {
+    DEBUG_WARN("Failed to create %s, program cache disabled", l_cache.dir);
+    return;
+  }
+
+  l_cache.enabled = true;
+}
+
+static void programCachePath(char * path, size_t size, uint64_t key)
+{
+  snprintf(path, size, "%s/%016" PRIx64 ".bin", l_cache.dir, key);
+}
+
+static bool programCacheLoad(EGL_Shader * this, uint64_t key)
+{
+  char path[PATH_MAX];
+  programCachePath(path, sizeof(path), key);
+
+  FILE * fp = fopen(path, "rb");
+  if (!fp)
+    return false;
+
+  bool   ret  = false;
+  void * data = NULL;
+
+  ProgramCacheHeader header;
+  if (fread(&header, sizeof(header), 1, fp) != 1 ||
+      header.magic   != PROGRAM_CACHE_MAGIC      ||
+      header.version != PROGRAM_CACHE_VERSION    ||
+      header.key     != key)
+    goto invalid;
+
+  data = malloc(header.length);
+  if (!data)
+  {
+    DEBUG_ERROR("out of memory");
+    goto exit;
+  }
+
+  if (fread(data, header.length, 1, fp) != 1)
+    goto invalid;
+
+  this->shader = glCreateProgram();
+  glProgramBinary(this->shader, header.format, data, header.length);
+
+  GLint result = GL_FALSE;
+  glGetProgramiv(this->shader, GL_LINK_STATUS, &result);
+  if (result == GL_FALSE)
+  {
+    // the driver can reject binaries at any time, ie after an update
+    glDeleteProgram(this->shader);
+    goto invalid;
+  }
+
+  ret = true;
+  goto exit;
+
+invalid:
+  DEBUG_INFO("Discarding stale program binary: %s", path);
+  unlink(path);
+
+exit:
+  free(data);
+  fclose(fp);
+  return ret;
+}
+
+static void programCacheStore(EGL_Shader * this, uint64_t key)
+{
+  GLint length = 0;
+  glGetProgramiv(this->shader, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  void * data = malloc(length);
+  if (!data)
+  {
+    DEBUG_ERROR("out of memory");
+    return;
+  }
+
+  GLenum format;
+  glGetProgramBinary(this->shader, length, &length, &format, data);
+  if (length <= 0)
+    goto exit;
+
+  ProgramCacheHeader header =
+  {
+    .magic   = PROGRAM_CACHE_MAGIC,
+    .version = PROGRAM_CACHE_VERSION,
+    .key     = key,
+    .format  = format,
+    .length  = length
+  };
+
+  char path[PATH_MAX];
+  char tmp [PATH_MAX + 4];
+  programCachePath(path, sizeof(path), key);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+  // write to a temporary file so that a partial binary is never loaded
+  FILE * fp = fopen(tmp, "wb");
+  if (!fp)
+  {
+    DEBUG_WARN("Failed to create %s", tmp);
+    goto exit;
+  }
+
+  bool ok =
+    fwrite(&header, sizeof(header), 1, fp) == 1 &&
+    fwrite(data   , length        , 1, fp) == 1;
+  ok = fclose(fp) == 0 && ok;
+
+  if (!ok || rename(tmp, path) < 0)
+  {
+    DEBUG_WARN("Failed to write %s", path);
+    unlink(tmp);
+  }
+
+exit:
+  free(data);
+}
+
 static bool shaderCompile(EGL_Shader * this, const char * vertex_code,
     size_t vertex_size, const char * fragment_code, size_t fragment_size)
 {
@@ -173,6 +382,10 @@ static bool shaderCompile(EGL_Shader * this, const char * vertex_code,
   }
 
   this->shader = glCreateProgram();
+  if (l_cache.enabled)
+    glProgramParameteri(this->shader, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+        GL_TRUE);
+
   glAttachShader(this->shader, vertexShader  );
   glAttachShader(this->shader, fragmentShader);
   glLinkProgram(this->shader);
@@ -343,16 +556,63 @@ bool egl_shaderCompile(EGL_Shader * this, const char * vertex_code,
     fragment_size = processedLen;
   }
 
+  if (this->hasShader)
+  {
+    glDeleteProgram(this->shader);
+    this->hasShader = false;
+  }
+
+  programCacheInit();
+  const uint64_t start = nanotime();
+
+  uint64_t key = 0;
+  if (l_cache.enabled)
+  {
+    const uint32_t version = PROGRAM_CACHE_VERSION;
+    key = fnv1a(l_cache.deviceKey, &version, sizeof(version));
+    key = fnv1a(key, &vertex_size  , sizeof(vertex_size  ));
+    key = fnv1a(key, vertex_code   , vertex_size          );
+    key = fnv1a(key, &fragment_size, sizeof(fragment_size));
+    key = fnv1a(key, fragment_code , fragment_size        );
+
+    if (programCacheLoad(this, key))
+    {
+      this->hasShader = true;
+      result          = true;
+      ++l_cache.hits;
+      l_cache.time += nanotime() - start;
+      goto exit;
+    }
+  }
+
   result = shaderCompile(this,
       vertex_code  , vertex_size,
       fragment_code, fragment_size);
 
+  if (result)
+  {
+    ++l_cache.misses;
+    if (l_cache.enabled)
+      programCacheStore(this, key);
+    l_cache.time += nanotime() - start;
+  }
+
 exit:
   free(processed);
   free(newCode);
   return result;
 }
 
+void egl_shaderLogStats(void)
+{
+  DEBUG_INFO("Shader programs: %d cached, %d compiled in %.2f ms",
+      l_cache.hits, l_cache.misses, l_cache.time / 1e6);
+
+  l_cache.hits   = 0;
+  l_cache.misses = 0;
+  l_cache.time   = 0;
+}
+
 void egl_shaderSetUniforms(EGL_Shader * this, EGL_Uniform * uniforms, int count)
 {
   egl_shaderFreeUniforms(this);
@@ -110,6 +110,10 @@ bool egl_shaderCompile(EGL_Shader * model, const char * vertex_code,
     size_t vertex_size, const char * fragment_code, size_t fragment_size,
     bool useDMA, const EGL_ShaderDefine * defines);
 
+/* logs and resets the number of programs loaded from the program cache and
+ * compiled from source, and the total time spent doing so */
+void egl_shaderLogStats(void);
+
 void egl_shaderSetUniforms(EGL_Shader * shader, EGL_Uniform * uniforms,
     int count);
 void egl_shaderFreeUniforms(EGL_Shader * shader);
@@ -0,0 +1,20 @@
+// unpacks the pixel at outputPos from a 24-bit frame packed into the 32-bit
+// texture sampler1, the result is in the channel order of the frame
+vec4 unpack24bit(uvec2 outputPos)
+{
+  uint fst = outputPos.x * 3u / 4u;
+  vec4 color_0 = texelFetch(sampler1, ivec2(fst, outputPos.y), 0);
+
+  uint snd = (outputPos.x * 3u + 1u) / 4u;
+  vec4 color_1 = texelFetch(sampler1, ivec2(snd, outputPos.y), 0);
+
+  uint trd = (outputPos.x * 3u + 2u) / 4u;
+  vec4 color_2 = texelFetch(sampler1, ivec2(trd, outputPos.y), 0);
+
+  return vec4(
+    color_0.barg[outputPos.x % 4u],
+    color_1.gbar[outputPos.x % 4u],
+    color_2.rgba[outputPos.x % 4u],
+    1.0
+  );
+}
@@ -10,13 +10,23 @@ out vec4  fragColor;
 uniform sampler2D sampler1;
 uniform vec3      uConfig;
 
+#ifdef UNPACK_24BIT
+// fused with the 24-bit conversion, sampler1 holds the packed frame
+uniform vec2      uUnpackedSize;
+#include "convert_24bit.h"
+#endif
+
 void main()
 {
   float pixelSize = uConfig.x;
   float vOffset   = uConfig.y;
   float hOffset   = uConfig.z;
 
+#ifdef UNPACK_24BIT
+  vec2 inRes  = uUnpackedSize;
+#else
   vec2 inRes  = vec2(textureSize(sampler1, 0));
+#endif
   ivec2 point = ivec2(
     (floor((fragCoord * inRes) / pixelSize) * pixelSize) +
     pixelSize / 2.0f
@@ -25,5 +35,9 @@ void main()
   point.x += int(pixelSize * hOffset);
   point.y += int(pixelSize * vOffset);
 
+#ifdef UNPACK_24BIT
+  fragColor = unpack24bit(uvec2(point)).UNPACK_24BIT;
+#else
   fragColor = texelFetch(sampler1, point, 0);
+#endif
 }
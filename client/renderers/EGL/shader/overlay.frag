@@ -0,0 +1,13 @@
+#version 300 es
+precision highp float;
+
+in  vec2 uv;
+out vec4 color;
+
+uniform sampler2D sampler1;
+
+void main()
+{
+  // the overlay is stored with premultiplied alpha
+  color = texture(sampler1, uv);
+}
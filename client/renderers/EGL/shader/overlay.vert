@@ -0,0 +1,13 @@
+#version 300 es
+precision highp float;
+
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec2 vertexUV;
+
+out vec2 uv;
+
+void main()
+{
+  gl_Position = vec4(vertexPosition_modelspace, 1.0);
+  uv          = vertexUV;
+}
@@ -32,7 +32,7 @@ extern const EGL_TextureOps EGL_TextureBufferStream;
 
 static void egl_texBuffer_cleanup(TextureBuffer * this)
 {
-  egl_texUtilFreeBuffers(this->buf, this->texCount);
+  egl_texUtilFreeBuffers(this->buf, this->bufCount);
 
   if (this->tex[0])
     glDeleteTextures(this->texCount, this->tex);
@@ -42,6 +42,13 @@ static void egl_texBuffer_cleanup(TextureBuffer * this)
     glDeleteSync(this->sync);
     this->sync = 0;
   }
+
+  for(int i = 0; i < EGL_TEX_BUFFER_MAX; ++i)
+    if (this->release[i])
+    {
+      glDeleteSync(this->release[i]);
+      this->release[i] = 0;
+    }
 }
 
 // common functions
@@ -65,6 +72,7 @@ bool egl_texBufferInit(EGL_Texture ** texture, EGL_TexType type,
     this = UPCAST(TextureBuffer, *texture);
 
   this->texCount = 1;
+  this->bufCount = 1;
   return true;
 }
 
@@ -102,6 +110,7 @@ bool egl_texBufferSetup(EGL_Texture * texture, const EGL_TexSetup * setup)
 
   glBindTexture(GL_TEXTURE_2D, 0);
   this->rIndex = -1;
+  this->ready  = -1;
 
   return true;
 }
@@ -166,6 +175,7 @@ bool egl_texBufferStreamInit(EGL_Texture ** texture, EGL_TexType type,
       DEBUG_UNREACHABLE();
   }
 
+  this->bufCount = this->texCount;
   LG_LOCK_INIT(this->copyLock);
   return true;
 }
@@ -176,7 +186,7 @@ bool egl_texBufferStreamSetup(EGL_Texture * texture, const EGL_TexSetup * setup)
     return false;
 
   TextureBuffer * this = UPCAST(TextureBuffer, texture);
-  return egl_texUtilGenBuffers(&texture->format, this->buf, this->texCount);
+  return egl_texUtilGenBuffers(&texture->format, this->buf, this->bufCount);
 }
 
 static bool egl_texBufferStreamUpdate(EGL_Texture * texture,
@@ -218,10 +228,46 @@ static bool egl_texBufferStreamUpdate(EGL_Texture * texture,
   return true;
 }
 
+static EGL_TexStatus egl_texBufferStreamProcessAsync(TextureBuffer * this)
+{
+  LG_LOCK(this->copyLock);
+  const bool pending = this->ready != -1;
+  LG_UNLOCK(this->copyLock);
+
+  if (!pending)
+    return EGL_TEX_STATUS_OK;
+
+  /* fence the draws that sampled the outgoing texture so the uploader does not
+   * overwrite it while they are still in flight */
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+
+  LG_LOCK(this->copyLock);
+  const int released = this->rIndex;
+  this->rIndex = this->ready;
+  this->ready  = -1;
+  if (released >= 0)
+  {
+    if (this->release[released])
+      glDeleteSync(this->release[released]);
+    this->release[released] = fence;
+    fence = 0;
+  }
+  LG_UNLOCK(this->copyLock);
+
+  if (fence)
+    glDeleteSync(fence);
+
+  return EGL_TEX_STATUS_OK;
+}
+
 EGL_TexStatus egl_texBufferStreamProcess(EGL_Texture * texture)
 {
   TextureBuffer * this = UPCAST(TextureBuffer, texture);
 
+  if (this->async)
+    return egl_texBufferStreamProcessAsync(this);
+
   LG_LOCK(this->copyLock);
 
   GLuint          tex    = this->tex[this->bufIndex];
@@ -230,7 +276,7 @@ EGL_TexStatus egl_texBufferStreamProcess(EGL_Texture * texture)
   if (buffer->updated && this->sync == 0)
   {
     this->rIndex = this->bufIndex;
-    if (++this->bufIndex == this->texCount)
+    if (++this->bufIndex == this->bufCount)
       this->bufIndex = 0;
   }
 
@@ -260,6 +306,81 @@ EGL_TexStatus egl_texBufferStreamProcess(EGL_Texture * texture)
   return EGL_TEX_STATUS_OK;
 }
 
+/**
+ * Async mode transfers the PBO into a texture on the calling thread instead of
+ * the render thread. The caller must have a GL context that shares with the
+ * render context current. The transfer is waited on before it is published,
+ * so the render thread only ever swaps in a completed texture and never blocks
+ * on an upload.
+ *
+ * Three textures are used: the one being displayed, the most recently
+ * completed one (if not yet picked up), and the upload target.
+ */
+bool egl_texBufferStreamUpload(EGL_Texture * texture)
+{
+  TextureBuffer * this   = UPCAST(TextureBuffer, texture);
+  EGL_TexBuffer * buffer = &this->buf[this->bufIndex];
+
+  DEBUG_ASSERT(this->async);
+
+  LG_LOCK(this->copyLock);
+  int target = 0;
+  while(target == this->rIndex || target == this->ready)
+    ++target;
+
+  GLsync release = this->release[target];
+  this->release[target] = 0;
+  LG_UNLOCK(this->copyLock);
+
+  if (release)
+  {
+    glWaitSync(release, 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync(release);
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo);
+  glBindTexture(GL_TEXTURE_2D, this->tex[target]);
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, texture->format.stride);
+  glTexSubImage2D(GL_TEXTURE_2D,
+      0, 0, 0,
+      texture->format.width,
+      texture->format.height,
+      texture->format.format,
+      texture->format.dataType,
+      (const void *)0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  const GLenum status = glClientWaitSync(
+      sync, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000); //100ms
+  glDeleteSync(sync);
+
+  switch(status)
+  {
+    case GL_ALREADY_SIGNALED:
+    case GL_CONDITION_SATISFIED:
+      break;
+
+    case GL_TIMEOUT_EXPIRED:
+      DEBUG_WARN_RATELIMIT(1000,
+          "Timed out waiting for the upload, frame dropped");
+      return true;
+
+    default:
+      DEBUG_GL_ERROR("glClientWaitSync failed");
+      return false;
+  }
+
+  LG_LOCK(this->copyLock);
+  buffer->updated = false;
+  this->ready     = target;
+  LG_UNLOCK(this->copyLock);
+
+  return true;
+}
+
 EGL_TexStatus egl_texBufferStreamGet(EGL_Texture * texture, GLuint * tex,
     EGL_PixelFormat * fmt)
 {
@@ -268,6 +389,12 @@ EGL_TexStatus egl_texBufferStreamGet(EGL_Texture * texture, GLuint * tex,
   if (this->rIndex == -1)
     return EGL_TEX_STATUS_NOTREADY;
 
+  if (this->async)
+  {
+    *tex = this->tex[this->rIndex];
+    return EGL_TEX_STATUS_OK;
+  }
+
   if (this->sync)
   {
     switch(glClientWaitSync(
@@ -24,7 +24,7 @@
 #include "texture_util.h"
 #include "common/locking.h"
 
-#define EGL_TEX_BUFFER_MAX 2
+#define EGL_TEX_BUFFER_MAX 3
 
 typedef struct TextureBuffer
 {
@@ -32,6 +32,7 @@ typedef struct TextureBuffer
   bool free;
 
   int           texCount;
+  int           bufCount;
   GLuint        tex[EGL_TEX_BUFFER_MAX];
   EGL_TexBuffer buf[EGL_TEX_BUFFER_MAX];
   int           bufFree;
@@ -39,6 +40,11 @@ typedef struct TextureBuffer
   LG_Lock       copyLock;
   int           bufIndex;
   int           rIndex;
+
+  /* async uploads, see egl_texBufferStreamUpload */
+  bool          async;
+  int           ready;
+  GLsync        release[EGL_TEX_BUFFER_MAX];
 }
 TextureBuffer;
 
@@ -56,5 +62,6 @@ bool egl_texBufferStreamInit(EGL_Texture ** texture_, EGL_TexType type,
 bool egl_texBufferStreamSetup(EGL_Texture * texture_,
     const EGL_TexSetup * setup);
 EGL_TexStatus egl_texBufferStreamProcess(EGL_Texture * texture_);
+bool egl_texBufferStreamUpload(EGL_Texture * texture_);
 EGL_TexStatus egl_texBufferStreamGet(EGL_Texture * texture_, GLuint * tex,
     EGL_PixelFormat * fmt);
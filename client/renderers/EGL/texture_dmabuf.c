@@ -79,7 +79,7 @@ static void egl_texDMABUFCleanup(EGL_Texture * texture)
     this->images[i].texIndex = -1;
   }
 
-  egl_texUtilFreeBuffers(parent->buf, parent->texCount);
+  egl_texUtilFreeBuffers(parent->buf, parent->bufCount);
 
   if (parent->tex[0])
     glDeleteTextures(parent->texCount, parent->tex);
@@ -22,6 +22,7 @@
 
 #include "texture_buffer.h"
 #include "common/debug.h"
+#include "common/option.h"
 #include "common/KVMFR.h"
 #include "common/rects.h"
 
@@ -55,6 +56,15 @@ static bool egl_texFBInit(EGL_Texture ** texture, EGL_TexType type,
   for (int i = 0; i < EGL_TEX_BUFFER_MAX; ++i)
     this->damage[i].count = -1;
 
+  /* the frame thread performs the transfer itself, the single PBO is always
+   * idle again by the time the next frame is copied into it */
+  if (option_get_bool("egl", "asyncUpload"))
+  {
+    this->base.async    = true;
+    this->base.texCount = 3;
+    this->base.bufCount = 1;
+  }
+
   return true;
 }
 
@@ -168,6 +178,9 @@ static bool egl_texFBUpdate(EGL_Texture * texture, const EGL_TexUpdate * update)
 
   LG_UNLOCK(parent->copyLock);
 
+  if (parent->async)
+    return egl_texBufferStreamUpload(texture);
+
   return true;
 }
 
@@ -34,7 +34,9 @@
 #include "common/debug.h"
 #include "common/option.h"
 #include "common/framebuffer.h"
+#include "common/KVMFR.h"
 #include "common/locking.h"
+#include "common/rects.h"
 #include "gl_dynprocs.h"
 #include "util.h"
 
@@ -100,6 +102,12 @@ struct OpenGL_Options
   bool amdPinnedMem;
 };
 
+struct TexDamage
+{
+  int             count;
+  FrameDamageRect rects[KVMFR_MAX_DAMAGE_RECTS];
+};
+
 struct Inst
 {
   LG_Renderer base;
@@ -126,6 +134,7 @@ struct Inst
   size_t              texPos;
   float               scaleX, scaleY;
   const FrameBuffer * frame;
+  struct TexDamage    frameDamage;
 
   uint64_t          drawStart;
   bool              hasBuffers;
@@ -144,6 +153,7 @@ struct Inst
   bool              hasTextures, hasFrames;
   GLuint            frames[BUFFER_COUNT];
   GLsync            fences[BUFFER_COUNT];
+  struct TexDamage  texDamage[BUFFER_COUNT];
   GLuint            textures[TEXTURE_COUNT];
 
   LG_Lock           mouseLock;
@@ -397,6 +407,22 @@ bool opengl_onFrame(LG_Renderer * renderer, const FrameBuffer * frame, int dmaFd
 
   LG_LOCK(this->frameLock);
   this->frame = frame;
+
+  /* if the previous frame was not consumed yet its damage must be carried over
+   * as the buffers have not seen it either */
+  struct TexDamage * fd = &this->frameDamage;
+  if (!atomic_load_explicit(&this->frameUpdate, memory_order_acquire))
+    fd->count = 0;
+
+  if (!damage || damageCount == 0 || fd->count < 0 ||
+      fd->count + damageCount > KVMFR_MAX_DAMAGE_RECTS)
+    fd->count = -1;
+  else
+  {
+    memcpy(fd->rects + fd->count, damage, damageCount * sizeof(*damage));
+    fd->count += damageCount;
+  }
+
   atomic_store_explicit(&this->frameUpdate, true, memory_order_release);
   LG_UNLOCK(this->frameLock);
 
@@ -891,6 +917,10 @@ static enum ConfigStatus configure(struct Inst * this)
     g_gl_dynProcs.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
   }
 
+  // the new textures have no content, the first upload to each must be full
+  for(int i = 0; i < BUFFER_COUNT; ++i)
+    this->texDamage[i].count = -1;
+
   // create the frame textures
   glGenTextures(BUFFER_COUNT, this->frames);
   if (check_gl_error("glGenTextures"))
@@ -1157,6 +1187,87 @@ static bool opengl_bufferFn(void * opaque, const void * data, size_t size)
   return true;
 }
 
+/**
+ * Upload only the damaged regions of the frame into the bound PBO and texture.
+ * Each row that is covered by any of the rects is streamed into the PBO once,
+ * then the rects are copied into the texture from it.
+ *
+ * Must be called with frameLock held, which is released before the texture
+ * is updated.
+ */
+static bool uploadDamage(struct Inst * this, const struct TexDamage * damage,
+    int bpp)
+{
+  const size_t    height    = this->format.dataHeight;
+  const size_t    pitch     = this->format.pitch;
+  const size_t    linewidth = this->format.dataWidth * bpp;
+  const uint8_t * src       = framebuffer_get_buffer(this->frame);
+
+  bool rows[height];
+  memset(rows, 0, sizeof(rows));
+  for(int i = 0; i < damage->count; ++i)
+  {
+    const FrameDamageRect * rect = damage->rects + i;
+    const size_t y2 = min((size_t)rect->y + rect->height, height);
+    for(size_t y = rect->y; y < y2; ++y)
+      rows[y] = true;
+  }
+
+  for(size_t y = 0; y < height;)
+  {
+    if (!rows[y])
+    {
+      ++y;
+      continue;
+    }
+
+    size_t y2 = y + 1;
+    while(y2 < height && rows[y2])
+      ++y2;
+
+    if (!framebuffer_wait(this->frame, (y2 - 1) * pitch + linewidth))
+    {
+      LG_UNLOCK(this->frameLock);
+      return false;
+    }
+
+    // the PBO rows are tightly packed, only runs of rows with the same pitch
+    // can be uploaded in a single call
+    if (pitch == linewidth)
+      g_gl_dynProcs.glBufferSubData(GL_PIXEL_UNPACK_BUFFER, y * linewidth,
+          (y2 - y) * linewidth, src + y * pitch);
+    else
+      for(size_t row = y; row < y2; ++row)
+        g_gl_dynProcs.glBufferSubData(GL_PIXEL_UNPACK_BUFFER, row * linewidth,
+            linewidth, src + row * pitch);
+
+    y = y2;
+  }
+
+  LG_UNLOCK(this->frameLock);
+
+  if (check_gl_error("glBufferSubData"))
+    return false;
+
+  for(int i = 0; i < damage->count; ++i)
+  {
+    const FrameDamageRect * rect = damage->rects + i;
+    glTexSubImage2D(
+      GL_TEXTURE_2D,
+      0,
+      rect->x,
+      rect->y,
+      rect->width,
+      rect->height,
+      this->vboFormat,
+      this->dataFormat,
+      (void*)(uintptr_t)(rect->y * linewidth + rect->x * bpp)
+    );
+  }
+
+  return !check_gl_error("glTexSubImage2D");
+}
+
 static bool drawFrame(struct Inst * this)
 {
   if (g_gl_dynProcs.glIsSync(this->fences[this->texWIndex]))
@@ -1167,11 +1278,11 @@ static bool drawFrame(struct Inst * this)
         break;
 
       case GL_CONDITION_SATISFIED:
-        DEBUG_WARN("Had to wait for the sync");
+        DEBUG_WARN_RATELIMIT(1000, "Had to wait for the sync");
         break;
 
       case GL_TIMEOUT_EXPIRED:
-        DEBUG_WARN("Timeout expired, DMA transfers are too slow!");
+        DEBUG_WARN_RATELIMIT(1000, "Timeout expired, DMA transfers are too slow!");
         break;
 
       case GL_WAIT_FAILED:
@@ -1202,45 +1313,91 @@ static bool drawFrame(struct Inst * this)
   glPixelStorei(GL_UNPACK_ALIGNMENT , bpp < 4 ? 1 : bpp);
   glPixelStorei(GL_UNPACK_ROW_LENGTH, this->format.frameWidth);
 
-  this->texPos = 0;
-  framebuffer_read_fn(
-    this->frame,
-    this->format.dataHeight,
-    this->format.dataWidth,
-    bpp,
-    this->format.pitch,
-    opengl_bufferFn,
-    this
-  );
+  /* the texture being written to is missing the damage of every frame since
+   * it was last written, see texture_framebuffer.c in the EGL renderer */
+  const struct TexDamage * frameDamage = &this->frameDamage;
+  struct TexDamage       * damage      = this->texDamage + this->texWIndex;
+  const bool damageAll = frameDamage->count < 0 || damage->count < 0 ||
+    damage->count + frameDamage->count > KVMFR_MAX_DAMAGE_RECTS;
 
-  LG_UNLOCK(this->frameLock);
+  if (!damageAll)
+  {
+    memcpy(damage->rects + damage->count, frameDamage->rects,
+      frameDamage->count * sizeof(FrameDamageRect));
+    damage->count += frameDamage->count;
+    damage->count  = rectsMergeOverlapping(damage->rects, damage->count);
+  }
 
-  // update the texture
-  glTexSubImage2D(
-    GL_TEXTURE_2D,
-    0,
-    0,
-    0,
-    this->format.frameWidth ,
-    this->format.frameHeight,
-    this->vboFormat,
-    this->dataFormat,
-    (void*)0
-  );
-  if (check_gl_error("glTexSubImage2D"))
+  for(int i = 0; i < BUFFER_COUNT; ++i)
   {
-    DEBUG_ERROR(
-      "texWIndex: %u, "
-      "width: %u, "
-      "height: %u, "
-      "vboFormat: %x, "
-      "texSize: %lu",
-      this->texWIndex,
-      this->format.frameWidth,
+    struct TexDamage * d = this->texDamage + i;
+    if (i == this->texWIndex)
+      continue;
+
+    if (frameDamage->count >= 0 && d->count >= 0 &&
+        d->count + frameDamage->count <= KVMFR_MAX_DAMAGE_RECTS)
+    {
+      memcpy(d->rects + d->count, frameDamage->rects,
+        frameDamage->count * sizeof(FrameDamageRect));
+      d->count += frameDamage->count;
+    }
+    else
+      d->count = -1;
+  }
+
+  if (!damageAll)
+  {
+    // releases frameLock
+    if (!uploadDamage(this, damage, bpp))
+      damage->count = -1;
+    else
+      damage->count = 0;
+  }
+  else
+  {
+    this->texPos = 0;
+    framebuffer_read_fn(
+      this->frame,
+      this->format.dataHeight,
+      this->format.dataWidth,
+      bpp,
+      this->format.pitch,
+      opengl_bufferFn,
+      this
+    );
+
+    LG_UNLOCK(this->frameLock);
+
+    // update the texture
+    glTexSubImage2D(
+      GL_TEXTURE_2D,
+      0,
+      0,
+      0,
+      this->format.frameWidth ,
       this->format.frameHeight,
       this->vboFormat,
-      this->texSize
+      this->dataFormat,
+      (void*)0
     );
+    if (check_gl_error("glTexSubImage2D"))
+    {
+      DEBUG_ERROR(
+        "texWIndex: %u, "
+        "width: %u, "
+        "height: %u, "
+        "vboFormat: %x, "
+        "texSize: %lu",
+        this->texWIndex,
+        this->format.frameWidth,
+        this->format.frameHeight,
+        this->vboFormat,
+        this->texSize
+      );
+      damage->count = -1;
+    }
+    else
+      damage->count = 0;
   }
 
   // unbind the buffer
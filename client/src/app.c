@@ -26,6 +26,8 @@
 #include "clipboard.h"
 #include "render_queue.h"
 #include "evdev.h"
+#include "input.h"
+#include "motion.h"
 
 #include "kb.h"
 
@@ -231,6 +233,7 @@ void app_clipboardData(const LG_ClipboardData type, uint8_t * data, size_t size)
 
   purespice_clipboardData(g_state.cbType, data, (uint32_t)size);
   g_state.cbXfer -= size;
+  metrics_add(g_state.metrics.cbToGuest, size);
 }
 
 void app_clipboardRequest(const LG_ClipboardReplyFn replyFn, void * opaque)
@@ -283,7 +286,8 @@ void app_handleButtonPress(int button)
   if (!core_inputEnabled() || !g_cursor.inView)
     return;
 
-  if (!purespice_mousePress(button))
+  motion_flush();
+  if (!input_mousePress(button))
     DEBUG_ERROR("app_handleButtonPress: failed to send message");
 }
 
@@ -302,7 +306,8 @@ void app_handleButtonRelease(int button)
   if (!core_inputEnabled())
     return;
 
-  if (!purespice_mouseRelease(button))
+  motion_flush();
+  if (!input_mouseRelease(button))
     DEBUG_ERROR("app_handleButtonRelease: failed to send message");
 }
 
@@ -366,7 +371,7 @@ void app_handleKeyPressInternal(int sc)
     if (!ps2)
       return;
 
-    if (purespice_keyDown(ps2))
+    if (input_keyDown(sc))
       g_state.keyDown[sc] = true;
     else
     {
@@ -412,7 +417,7 @@ void app_handleKeyReleaseInternal(int sc)
   if (!ps2)
     return;
 
-  if (purespice_keyUp(ps2))
+  if (input_keyUp(sc))
     g_state.keyDown[sc] = false;
   else
   {
@@ -504,6 +509,19 @@ void app_handleMouseBasic(void)
   struct DoublePoint guest;
   util_localCurToGuest(&guest);
 
+  /* the shared memory input queue can position the cursor directly */
+  const int px = round(util_clamp(guest.x, 0, g_state.srcSize.x));
+  const int py = round(util_clamp(guest.y, 0, g_state.srcSize.y));
+  if (px == g_cursor.projected.x && py == g_cursor.projected.y)
+    return;
+
+  if (input_mousePosition(px, py))
+  {
+    g_cursor.projected.x = px;
+    g_cursor.projected.y = py;
+    return;
+  }
+
   int x = (int) round(util_clamp(guest.x, 0, g_state.srcSize.x) -
       g_cursor.projected.x);
   int y = (int) round(util_clamp(guest.y, 0, g_state.srcSize.y) -
@@ -515,7 +533,7 @@ void app_handleMouseBasic(void)
   g_cursor.projected.x += x;
   g_cursor.projected.y += y;
 
-  if (!purespice_mouseMotion(x, y))
+  if (!input_mouseMotion(x, y))
     DEBUG_ERROR("failed to send mouse motion message");
 }
 
@@ -886,6 +904,52 @@ bool app_overlayNeedsRender(void)
   return result;
 }
 
+static inline uint64_t hashBytes(uint64_t hash, const void * data, size_t size)
+{
+  // FNV-1a over 64-bit words, good enough to detect changes
+  const uint8_t * src = data;
+  uint64_t value;
+  for(; size >= sizeof(value); size -= sizeof(value), src += sizeof(value))
+  {
+    memcpy(&value, src, sizeof(value));
+    hash = (hash ^ value) * 0x100000001b3ULL;
+  }
+
+  if (!size)
+    return hash;
+
+  value = 0;
+  memcpy(&value, src, size);
+  return (hash ^ value) * 0x100000001b3ULL;
+}
+
+static uint64_t hashDrawData(const ImDrawData * data)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hashBytes(hash, &data->DisplaySize, sizeof(data->DisplaySize));
+
+  for(int i = 0; i < data->CmdListsCount; ++i)
+  {
+    const ImDrawList * list = data->CmdLists.Data[i];
+    hash = hashBytes(hash, list->VtxBuffer.Data,
+        list->VtxBuffer.Size * sizeof(*list->VtxBuffer.Data));
+    hash = hashBytes(hash, list->IdxBuffer.Data,
+        list->IdxBuffer.Size * sizeof(*list->IdxBuffer.Data));
+
+    for(int j = 0; j < list->CmdBuffer.Size; ++j)
+    {
+      const ImDrawCmd * cmd = list->CmdBuffer.Data + j;
+      hash = hashBytes(hash, &cmd->ClipRect , sizeof(cmd->ClipRect ));
+      hash = hashBytes(hash, &cmd->TextureId, sizeof(cmd->TextureId));
+      hash = hashBytes(hash, &cmd->VtxOffset, sizeof(cmd->VtxOffset));
+      hash = hashBytes(hash, &cmd->IdxOffset, sizeof(cmd->IdxOffset));
+      hash = hashBytes(hash, &cmd->ElemCount, sizeof(cmd->ElemCount));
+    }
+  }
+
+  return hash;
+}
+
 int app_renderOverlay(struct Rect * rects, int maxRects)
 {
   int  totalRects  = 0;
@@ -986,9 +1050,19 @@ render_again:
     goto render_again;
   }
 
+  const uint64_t hash = totalRects || totalDamage ?
+    hashDrawData(igGetDrawData()) : 0;
+  g_state.overlayChanged = hash != g_state.overlayHash;
+  g_state.overlayHash    = hash;
+
   return totalDamage ? -1 : totalRects;
 }
 
+bool app_overlayChanged(void)
+{
+  return g_state.overlayChanged;
+}
+
 void app_freeOverlays(void)
 {
   struct Overlay * overlay;
@@ -25,13 +25,17 @@
 #include "common/array.h"
 #include "common/util.h"
 #include "common/ringbuffer.h"
+#include "common/audioring.h"
+#include "common/resampler.h"
+#include "common/sampleconv.h"
 
 #include "dynamic/audiodev.h"
 
 #include <float.h>
 #include <math.h>
-#include <samplerate.h>
 #include <stdalign.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <string.h>
 
 typedef enum
@@ -58,10 +62,30 @@ typedef struct
 }
 PlaybackDeviceData;
 
+typedef struct
+{
+  int     periodFrames;
+  int64_t nextTime;
+  int64_t nextPosition;
+}
+PlaybackDeviceTick;
+
+/* The latest two device ticks, published by the device thread under a sequence
+ * lock. The Spice thread only needs the freshest pair to interpolate the device
+ * position, even after a long KEEP_ALIVE period where it has not looked */
+typedef struct
+{
+  atomic_uint        seq;
+  PlaybackDeviceTick last;
+  PlaybackDeviceTick next;
+}
+PlaybackDeviceTiming;
+
 typedef struct
 {
   float * framesIn;
   float * framesOut;
+  int     framesInSize;
   int     framesOutSize;
 
   int     periodFrames;
@@ -82,7 +106,7 @@ typedef struct
 
   double  ratioIntegral;
 
-  SRC_STATE * src;
+  Resampler resampler;
 }
 PlaybackSpiceData;
 
@@ -102,11 +126,19 @@ typedef struct
     int         deviceMaxPeriodFrames;
     int         deviceStartFrames;
     int         targetStartFrames;
-    RingBuffer  buffer;
-    RingBuffer  deviceTiming;
+    AudioRing   buffer;
+
+    PlaybackDeviceTiming deviceTiming;
 
     RingBuffer  timings;
     GraphHandle graph;
+    RingBuffer  offsetErrors;
+    GraphHandle offsetErrorGraph;
+    RingBuffer  ratios;
+    GraphHandle ratioGraph;
+
+    FILE      * statsLog;
+    int64_t     statsStart;
 
     /* These two structs contain data specifically for use in the device and
      * Spice data threads respectively. Keep them on separate cache lines to
@@ -139,14 +171,6 @@ AudioState;
 
 static AudioState audio = { 0 };
 
-typedef struct
-{
-  int     periodFrames;
-  int64_t nextTime;
-  int64_t nextPosition;
-}
-PlaybackDeviceTick;
-
 static void playbackStop(void);
 
 void audio_init(void)
@@ -198,23 +222,61 @@ static void playbackStop(void)
 
   audio.playback.state = STREAM_STATE_STOP;
   audio.audioDev->playback.stop();
-  ringbuffer_free(&audio.playback.buffer);
-  ringbuffer_free(&audio.playback.deviceTiming);
-  audio.playback.spiceData.src = src_delete(audio.playback.spiceData.src);
+  audioring_free(&audio.playback.buffer);
+  resampler_free(&audio.playback.spiceData.resampler);
 
-  if (audio.playback.spiceData.framesIn)
-  {
-    free(audio.playback.spiceData.framesIn);
-    free(audio.playback.spiceData.framesOut);
-    audio.playback.spiceData.framesIn = NULL;
-    audio.playback.spiceData.framesOut = NULL;
-  }
+  free(audio.playback.spiceData.framesIn);
+  free(audio.playback.spiceData.framesOut);
+  audio.playback.spiceData.framesIn      = NULL;
+  audio.playback.spiceData.framesOut     = NULL;
+  audio.playback.spiceData.framesInSize  = 0;
+  audio.playback.spiceData.framesOutSize = 0;
 
   if (audio.playback.timings)
   {
     app_unregisterGraph(audio.playback.graph);
+    app_unregisterGraph(audio.playback.offsetErrorGraph);
+    app_unregisterGraph(audio.playback.ratioGraph);
     ringbuffer_free(&audio.playback.timings);
+    ringbuffer_free(&audio.playback.offsetErrors);
+    ringbuffer_free(&audio.playback.ratios);
+  }
+
+  if (audio.playback.statsLog)
+  {
+    fclose(audio.playback.statsLog);
+    audio.playback.statsLog = NULL;
+  }
+}
+
+static bool allocFrameBuffers(int frames, int channels)
+{
+  PlaybackSpiceData * spiceData = &audio.playback.spiceData;
+
+  free(spiceData->framesIn);
+  free(spiceData->framesOut);
+
+  /* the output needs headroom for the resampling ratio which is never more
+   * than a fraction of a percent */
+  spiceData->framesInSize  = frames;
+  spiceData->framesOutSize = frames + frames / 10 + 1;
+  spiceData->framesIn      = malloc(frames * channels * sizeof(float));
+  spiceData->framesOut     =
+    malloc(spiceData->framesOutSize * channels * sizeof(float));
+
+  if (!spiceData->framesIn || !spiceData->framesOut)
+  {
+    DEBUG_ERROR("Failed to allocate the playback buffers");
+    free(spiceData->framesIn);
+    free(spiceData->framesOut);
+    spiceData->framesIn      = NULL;
+    spiceData->framesOut     = NULL;
+    spiceData->framesInSize  = 0;
+    spiceData->framesOutSize = 0;
+    return false;
   }
+
+  return true;
 }
 
 static int playbackPullFrames(uint8_t * dst, int frames)
@@ -233,12 +295,12 @@ static int playbackPullFrames(uint8_t * dst, int frames)
       /* If necessary, slew backwards to play silence until we reach the target
        * startup latency. This avoids underrunning the buffer if the audio
        * device starts earlier than required. */
-      int offset = ringbuffer_getCount(audio.playback.buffer) -
+      int offset = audioring_getCount(audio.playback.buffer) -
         audio.playback.targetStartFrames;
       if (offset < 0)
       {
         data->nextPosition += offset;
-        ringbuffer_consume(audio.playback.buffer, NULL, offset);
+        audioring_consume(audio.playback.buffer, NULL, offset);
       }
 
       audio.playback.state = STREAM_STATE_RUN;
@@ -280,7 +342,7 @@ static int playbackPullFrames(uint8_t * dst, int frames)
         // Clock error is too high; slew the read pointer and reset the timing
         // parameters to avoid getting too far out of sync
         int slewFrames = round(error * audio.playback.sampleRate);
-        ringbuffer_consume(audio.playback.buffer, NULL, slewFrames);
+        audioring_consume(audio.playback.buffer, NULL, slewFrames);
 
         data->periodSec     = (double) frames / audio.playback.sampleRate;
         data->nextTime      = now + llrint(data->periodSec * 1.0e9);
@@ -295,15 +357,24 @@ static int playbackPullFrames(uint8_t * dst, int frames)
       }
     }
 
-    PlaybackDeviceTick tick =
+    // this is the only writer so the current tick can be read back directly
+    PlaybackDeviceTiming * timing = &audio.playback.deviceTiming;
+    const unsigned seq = atomic_load_explicit(&timing->seq,
+        memory_order_relaxed);
+    atomic_store_explicit(&timing->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    timing->last = timing->next;
+    timing->next = (PlaybackDeviceTick)
     {
       .periodFrames = data->periodFrames,
       .nextTime     = data->nextTime,
       .nextPosition = data->nextPosition
     };
-    ringbuffer_push(audio.playback.deviceTiming, &tick);
 
-    ringbuffer_consume(audio.playback.buffer, dst, frames);
+    atomic_store_explicit(&timing->seq, seq + 2, memory_order_release);
+
+    audioring_consume(audio.playback.buffer, dst, frames);
   }
   else
     frames = 0;
@@ -313,7 +384,7 @@ static int playbackPullFrames(uint8_t * dst, int frames)
   {
     int stopTimeSec = 30;
     int stopTimeFrames = stopTimeSec * audio.playback.sampleRate;
-    if (ringbuffer_getCount(audio.playback.buffer) <= -stopTimeFrames)
+    if (audioring_getCount(audio.playback.buffer) <= -stopTimeFrames)
       playbackStop();
   }
 
@@ -335,19 +406,29 @@ void audio_playbackStart(int channels, int sampleRate, PSAudioFormat format,
   if (audio.playback.state != STREAM_STATE_STOP)
     playbackStop();
 
-  int srcError;
-  audio.playback.spiceData.src = src_new(SRC_SINC_FASTEST, channels, &srcError);
-  if (!audio.playback.spiceData.src)
+  /* Spice typically sends 10ms periods, preallocate enough for 100ms so that
+   * the buffers never need to be reallocated during playback */
+  const int periodFrames = sampleRate / 10;
+  audio.playback.spiceData.resampler = resampler_new(channels, periodFrames);
+  if (!audio.playback.spiceData.resampler)
+  {
+    DEBUG_ERROR("Failed to create resampler");
+    return;
+  }
+
+  if (!allocFrameBuffers(periodFrames, channels))
   {
-    DEBUG_ERROR("Failed to create resampler: %s", src_strerror(srcError));
+    resampler_free(&audio.playback.spiceData.resampler);
     return;
   }
 
   const int bufferFrames = sampleRate;
-  audio.playback.buffer = ringbuffer_newUnbounded(bufferFrames,
+  audio.playback.buffer = audioring_new(bufferFrames,
       channels * sizeof(float));
 
-  audio.playback.deviceTiming = ringbuffer_new(16, sizeof(PlaybackDeviceTick));
+  audio.playback.deviceTiming.seq = 0;
+  audio.playback.deviceTiming.last.nextTime = INT64_MIN;
+  audio.playback.deviceTiming.next.nextTime = INT64_MIN;
 
   lastChannels   = channels;
   lastSampleRate = sampleRate;
@@ -391,6 +472,28 @@ void audio_playbackStart(int channels, int sampleRate, PSAudioFormat format,
   audio.playback.timings = ringbuffer_new(1200, sizeof(float));
   audio.playback.graph   = app_registerGraph("PLAYBACK",
       audio.playback.timings, 0.0f, 200.0f, audioGraphFormatFn);
+
+  // expose the latency controller state so the buffer latency can be tuned
+  audio.playback.offsetErrors     = ringbuffer_new(1200, sizeof(float));
+  audio.playback.offsetErrorGraph = app_registerGraph("PLAYBACK ERR",
+      audio.playback.offsetErrors, -20.0f, 20.0f, audioGraphFormatFn);
+  audio.playback.ratios           = ringbuffer_new(1200, sizeof(float));
+  audio.playback.ratioGraph       = app_registerGraph("PLAYBACK PPM",
+      audio.playback.ratios, -500.0f, 500.0f, audioGraphFormatFn);
+
+  if (g_params.audioStatsLog)
+  {
+    audio.playback.statsLog = fopen(g_params.audioStatsLog, "w");
+    if (!audio.playback.statsLog)
+      DEBUG_WARN("Failed to open the audio stats log: %s",
+          g_params.audioStatsLog);
+    else
+    {
+      fprintf(audio.playback.statsLog,
+          "time_ms,target_ms,latency_ms,offset_error_ms,ratio_ppm\n");
+      audio.playback.statsStart = nanotime();
+    }
+  }
 }
 
 void audio_playbackStop(void)
@@ -407,13 +510,7 @@ void audio_playbackStop(void)
       audio.playback.state = STREAM_STATE_KEEP_ALIVE;
 
       // Reset the resampler so it is safe to use for the next playback
-      int error = src_reset(audio.playback.spiceData.src);
-      if (error)
-      {
-        DEBUG_ERROR("Failed to reset resampler: %s", src_strerror(error));
-        playbackStop();
-      }
-
+      resampler_reset(audio.playback.spiceData.resampler);
       break;
     }
 
@@ -460,6 +557,27 @@ void audio_playbackMute(bool mute)
   audio.audioDev->playback.mute(mute);
 }
 
+static void readDeviceTiming(PlaybackDeviceTick * last,
+    PlaybackDeviceTick * next)
+{
+  PlaybackDeviceTiming * timing = &audio.playback.deviceTiming;
+  unsigned seq;
+
+  for(;;)
+  {
+    seq = atomic_load_explicit(&timing->seq, memory_order_acquire);
+    if (seq & 1)
+      continue;
+
+    *last = timing->last;
+    *next = timing->next;
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&timing->seq, memory_order_relaxed) == seq)
+      return;
+  }
+}
+
 static double computeDevicePosition(int64_t curTime)
 {
   // Interpolate to calculate the current device position
@@ -486,43 +604,29 @@ void audio_playbackData(uint8_t * data, size_t size)
 
   if (periodChanged)
   {
-    if (spiceData->framesIn)
-    {
-      free(spiceData->framesIn);
-      free(spiceData->framesOut);
-    }
-    spiceData->periodFrames  = frames;
-    spiceData->framesIn      = malloc(frames * audio.playback.stride);
-    if (!spiceData->framesIn)
-    {
-      DEBUG_ERROR("Failed to malloc framesIn");
-      playbackStop();
-      return;
-    }
-
-    spiceData->framesOutSize = round(frames * 1.1);
-    spiceData->framesOut     =
-      malloc(spiceData->framesOutSize * audio.playback.stride);
-    if (!spiceData->framesOut)
+    spiceData->periodFrames = frames;
+    if (frames > spiceData->framesInSize &&
+        !allocFrameBuffers(frames, audio.playback.channels))
     {
-      DEBUG_ERROR("Failed to malloc framesOut");
       playbackStop();
       return;
     }
   }
 
-  src_short_to_float_array((int16_t *) data, spiceData->framesIn,
+  sampleconv_s16ToFloat((int16_t *) data, spiceData->framesIn,
     frames * audio.playback.channels);
 
   // Receive timing information from the audio device thread
-  PlaybackDeviceTick deviceTick;
-  while (ringbuffer_consume(audio.playback.deviceTiming, &deviceTick, 1))
+  PlaybackDeviceTick devLast, devNext;
+  readDeviceTiming(&devLast, &devNext);
+
+  if (devNext.nextTime != INT64_MIN)
   {
-    spiceData->devPeriodFrames = deviceTick.periodFrames;
-    spiceData->devLastTime     = spiceData->devNextTime;
-    spiceData->devLastPosition = spiceData->devNextPosition;
-    spiceData->devNextTime     = deviceTick.nextTime;
-    spiceData->devNextPosition = deviceTick.nextPosition;
+    spiceData->devPeriodFrames = devNext.periodFrames;
+    spiceData->devLastTime     = devLast.nextTime;
+    spiceData->devLastPosition = devLast.nextPosition;
+    spiceData->devNextTime     = devNext.nextTime;
+    spiceData->devNextPosition = devNext.nextPosition;
   }
 
   /* Determine the target latency. This is made up of the maximum audio device
@@ -612,17 +716,14 @@ void audio_playbackData(uint8_t * data, size_t size)
         // If starting a new playback we need to allow a little extra time for
         // the resampler startup latency
         if (audio.playback.state == STREAM_STATE_KEEP_ALIVE)
-        {
-          int resamplerLatencyFrames = 20;
-          targetPosition += resamplerLatencyFrames;
-        }
+          targetPosition += resampler_getLatency();
 
         slewFrames = round(targetPosition - spiceData->nextPosition);
       }
       else
         slewFrames = round(error * audio.playback.sampleRate);
 
-      ringbuffer_append(audio.playback.buffer, NULL, slewFrames);
+      audioring_append(audio.playback.buffer, NULL, slewFrames);
 
       curTime     = now;
       curPosition = spiceData->nextPosition + slewFrames;
@@ -679,35 +780,12 @@ void audio_playbackData(uint8_t * data, size_t size)
   double piOutput = kp * offsetError + ki * spiceData->ratioIntegral;
   double ratio = 1.0 + piOutput;
 
-  int consumed = 0;
-  while (consumed < frames)
-  {
-    SRC_DATA srcData =
-    {
-      .data_in           = spiceData->framesIn +
-        consumed * audio.playback.channels,
-      .data_out          = spiceData->framesOut,
-      .input_frames      = frames - consumed,
-      .output_frames     = spiceData->framesOutSize,
-      .input_frames_used = 0,
-      .output_frames_gen = 0,
-      .end_of_input      = 0,
-      .src_ratio         = ratio
-    };
-
-    int error = src_process(spiceData->src, &srcData);
-    if (error)
-    {
-      DEBUG_ERROR("Resampling failed: %s", src_strerror(error));
-      return;
-    }
+  int generated = resampler_process(spiceData->resampler,
+    spiceData->framesIn, frames,
+    spiceData->framesOut, spiceData->framesOutSize, ratio);
 
-    ringbuffer_append(audio.playback.buffer, spiceData->framesOut,
-      srcData.output_frames_gen);
-
-    consumed += srcData.input_frames_used;
-    spiceData->nextPosition += srcData.output_frames_gen;
-  }
+  audioring_append(audio.playback.buffer, spiceData->framesOut, generated);
+  spiceData->nextPosition += generated;
 
   if (audio.playback.state == STREAM_STATE_SETUP_SPICE)
   {
@@ -738,6 +816,19 @@ void audio_playbackData(uint8_t * data, size_t size)
   const float latency = latencyFrames * 1000.0 / audio.playback.sampleRate;
   ringbuffer_push(audio.playback.timings, &latency);
   app_invalidateGraph(audio.playback.graph);
+
+  const float offsetErrorMs = offsetError * 1000.0 / audio.playback.sampleRate;
+  const float ratioPpm      = (ratio - 1.0) * 1.0e6;
+  ringbuffer_push(audio.playback.offsetErrors, &offsetErrorMs);
+  ringbuffer_push(audio.playback.ratios      , &ratioPpm     );
+  app_invalidateGraph(audio.playback.offsetErrorGraph);
+  app_invalidateGraph(audio.playback.ratioGraph);
+
+  if (audio.playback.statsLog)
+    fprintf(audio.playback.statsLog, "%.3f,%.3f,%.3f,%.3f,%.3f\n",
+        (now - audio.playback.statsStart) * 1.0e-6,
+        targetLatencyFrames * 1000.0 / audio.playback.sampleRate,
+        latency, offsetErrorMs, ratioPpm);
 }
 
 bool audio_supportsRecord(void)
@@ -71,6 +71,7 @@ void cb_spiceData(const PSDataType type, uint8_t * buffer, uint32_t size)
   if (!g_params.clipboardToLocal)
     return;
 
+  metrics_add(g_state.metrics.cbFromGuest, size);
   if (type == SPICE_DATA_TEXT)
   {
     // dos2unix
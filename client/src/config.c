@@ -103,6 +103,20 @@ static struct Option options[] =
     .type          = OPTION_TYPE_BOOL,
     .value.x_bool  = true
   },
+  {
+    .module         = "app",
+    .name           = "timingsLog",
+    .description    = "Write per frame upload and render timings to this CSV file",
+    .type           = OPTION_TYPE_STRING,
+    .value.x_string = NULL,
+  },
+  {
+    .module         = "app",
+    .name           = "metricsFile",
+    .description    = "Write performance metrics to this file in the Prometheus text format",
+    .type           = OPTION_TYPE_STRING,
+    .value.x_string = NULL,
+  },
 
   // window options
   {
@@ -310,6 +324,27 @@ static struct Option options[] =
     .type           = OPTION_TYPE_BOOL,
     .value.x_bool   = false,
   },
+  {
+    .module         = "win",
+    .name           = "vrr",
+    .description    = "Present frames as soon as they arrive for variable refresh rate displays",
+    .type           = OPTION_TYPE_BOOL,
+    .value.x_bool   = false,
+  },
+  {
+    .module         = "win",
+    .name           = "vrrMin",
+    .description    = "The minimum refresh rate of the display in Hz, slower frames are repeated",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 48,
+  },
+  {
+    .module         = "win",
+    .name           = "vrrMax",
+    .description    = "The maximum refresh rate of the display in Hz (0 = no limit)",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 0,
+  },
   {
     .module         = "win",
     .name           = "requestActivation",
@@ -431,6 +466,20 @@ static struct Option options[] =
     .type           = OPTION_TYPE_INT,
     .value.x_int    = 200
   },
+  {
+    .module         = "input",
+    .name           = "mouseRate",
+    .description    = "Maximum rate in Hz to send captured mouse motion at, excess motion is combined (0 = every event)",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 1000
+  },
+  {
+    .module         = "input",
+    .name           = "sharedMemory",
+    .description    = "Send input over the shared memory when the host supports it instead of SPICE",
+    .type           = OPTION_TYPE_BOOL,
+    .value.x_bool   = true
+  },
 
   // spice options
   {
@@ -544,6 +593,13 @@ static struct Option options[] =
     .type           = OPTION_TYPE_INT,
     .value.x_int    = 13
   },
+  {
+    .module         = "audio",
+    .name           = "statsLog",
+    .description    = "Log the playback latency controller state to this CSV file",
+    .type           = OPTION_TYPE_STRING,
+    .value.x_string = NULL
+  },
   {
     .module         = "audio",
     .name           = "micDefault",
@@ -669,6 +725,8 @@ bool config_load(int argc, char * argv[])
   g_params.cursorPollInterval   = option_get_int   ("app"  , "cursorPollInterval");
   g_params.framePollInterval    = option_get_int   ("app"  , "framePollInterval" );
   g_params.allowDMA             = option_get_bool  ("app"  , "allowDMA"          );
+  g_params.timingsLog           = option_get_string("app"  , "timingsLog"        );
+  g_params.metricsFile          = option_get_string("app"  , "metricsFile"       );
 
   g_params.windowTitle            = option_get_string("win", "title"             );
   g_params.appId                  = option_get_string("win", "appId"             );
@@ -692,6 +750,9 @@ bool config_load(int argc, char * argv[])
   g_params.uiFont                 = option_get_string("win", "uiFont"            );
   g_params.uiSize                 = option_get_int   ("win", "uiSize"            );
   g_params.jitRender              = option_get_bool  ("win", "jitRender"         );
+  g_params.vrr                    = option_get_bool  ("win", "vrr"               );
+  g_params.vrrMin                 = option_get_int   ("win", "vrrMin"            );
+  g_params.vrrMax                 = option_get_int   ("win", "vrrMax"            );
   g_params.requestActivation      = option_get_bool  ("win", "requestActivation" );
   g_params.disableWaitingMessage  = option_get_bool  ("win", "disableWaitingMessage");
 
@@ -702,6 +763,19 @@ bool config_load(int argc, char * argv[])
     return false;
   }
 
+  if (g_params.vrr && g_params.jitRender)
+  {
+    DEBUG_WARN("win:vrr and win:jitRender can't be used simultaneously");
+    return false;
+  }
+
+  if (g_params.vrr && (g_params.vrrMin < 1 ||
+      (g_params.vrrMax > 0 && g_params.vrrMax < g_params.vrrMin)))
+  {
+    DEBUG_WARN("win:vrrMin must be at least 1 and no more than win:vrrMax");
+    return false;
+  }
+
   switch(option_get_int("win", "rotate"))
   {
     case 0  : g_params.winRotate = LG_ROTATE_0  ; break;
@@ -730,7 +804,15 @@ bool config_load(int argc, char * argv[])
     g_params.mouseRedraw = true;
   }
 
+  if (g_params.vrr && !g_params.mouseRedraw)
+  {
+    DEBUG_WARN("win:vrr is enabled, forcing input:mouseRedraw");
+    g_params.mouseRedraw = true;
+  }
+
   g_params.helpMenuDelayUs = option_get_int("input", "helpMenuDelay") * (uint64_t) 1000;
+  g_params.shmInput        = option_get_bool("input", "sharedMemory");
+  g_params.mouseRate       = option_get_int ("input", "mouseRate"   );
 
   g_params.minimizeOnFocusLoss = option_get_bool("win", "minimizeOnFocusLoss");
   g_params.setGuestRes         = option_get_bool("win", "setGuestRes"        );
@@ -765,6 +847,7 @@ bool config_load(int argc, char * argv[])
 
   g_params.audioPeriodSize = option_get_int("audio", "periodSize");
   g_params.audioBufferLatency = option_get_int("audio", "bufferLatency");
+  g_params.audioStatsLog      = option_get_string("audio", "statsLog");
   g_params.micShowIndicator   = option_get_bool("audio", "micShowIndicator");
   g_params.audioSyncVolume = option_get_bool("audio", "syncVolume");
 
@@ -23,6 +23,8 @@
 #include "app.h"
 #include "util.h"
 #include "kb.h"
+#include "input.h"
+#include "motion.h"
 #include "message.h"
 #include "message.h"
 
@@ -129,6 +131,9 @@ void core_setGrabQuiet(bool enable)
   if (g_cursor.grab == enable)
     return;
 
+  // deliver any captured motion before the mode changes
+  motion_flush();
+
   g_cursor.grab = enable;
   g_cursor.acc.x = 0.0;
   g_cursor.acc.y = 0.0;
@@ -471,8 +476,7 @@ void core_handleMouseGrabbed(double ex, double ey)
   if (x == 0 && y == 0)
     return;
 
-  if (!purespice_mouseMotion(x, y))
-    DEBUG_ERROR("failed to send mouse motion message");
+  motion_push(x, y);
 }
 
 void core_handleMouseNormal(double ex, double ey)
@@ -485,9 +489,9 @@ void core_handleMouseNormal(double ex, double ey)
       // wiggle the mouse when the guest has not provided any information, we need
       // to do this because windows doesn't enable a cursor at all until it has
       // been moved for the first time.
-      if (!purespice_mouseMotion(1, 1))
+      if (!input_mouseMotion(1, 1))
         DEBUG_ERROR("failed to send mouse motion message");
-      if (!purespice_mouseMotion(-1, -1))
+      if (!input_mouseMotion(-1, -1))
         DEBUG_ERROR("failed to send mouse motion message");
     }
     return;
@@ -711,7 +715,7 @@ fallback:
     g_cursor.guest.y += y;
   }
 
-  if (!purespice_mouseMotion(x, y))
+  if (!input_mouseMotion(x, y))
     DEBUG_ERROR("failed to send mouse motion message");
 }
 
@@ -42,6 +42,8 @@ void egl_dynProcsInit(void)
     eglGetProcAddress("glDebugMessageCallbackKHR");
   g_egl_dynProcs.glBufferStorageEXT = (PFNGLBUFFERSTORAGEEXTPROC)
     eglGetProcAddress("glBufferStorageEXT");
+  g_egl_dynProcs.glGetQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)
+    eglGetProcAddress("glGetQueryObjectui64vEXT");
   g_egl_dynProcs.eglCreateImage = (PFNEGLCREATEIMAGEPROC)
     eglGetProcAddress("eglCreateImage");
   g_egl_dynProcs.eglDestroyImage = (PFNEGLDESTROYIMAGEPROC)
@@ -0,0 +1,292 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "fontcache.h"
+
+#include "common/debug.h"
+#include "common/event.h"
+#include "common/locking.h"
+#include "common/thread.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// enough for the scales of a few displays and one being built
+#define FONT_CACHE_SIZE 4
+
+struct FontAtlas
+{
+  float         scale;
+  ImFontAtlas * atlas;
+  ImFont      * large;
+  uint64_t      lastUsed;
+};
+
+static struct
+{
+  ImGuiIO          * io;
+  ImFontAtlas      * ownAtlas;
+  const char       * fontName;
+  const ImWchar    * ranges;
+  float              uiSize;
+  FontCacheReadyFn   readyFn;
+
+  LG_Lock            lock;
+  struct FontAtlas   cache[FONT_CACHE_SIZE];
+  struct FontAtlas * current;
+  uint64_t           useCount;
+
+  // the scale waiting to be built and the one being built, zero if none
+  float              request;
+  float              building;
+
+  LGThread         * thread;
+  LGEvent          * event;
+  atomic_bool        running;
+}
+fc = { 0 };
+
+static bool buildAtlas(float scale, struct FontAtlas * out)
+{
+  ImFontAtlas * atlas = ImFontAtlas_ImFontAtlas();
+  if (!atlas)
+  {
+    DEBUG_ERROR("out of memory");
+    return false;
+  }
+
+  const float size = fc.uiSize * scale;
+  ImFont * large = NULL;
+  if (!ImFontAtlas_AddFontFromFileTTF(atlas, fc.fontName, size, NULL,
+        fc.ranges) ||
+      !(large = ImFontAtlas_AddFontFromFileTTF(atlas, fc.fontName,
+        1.3f * size, NULL, fc.ranges)) ||
+      !ImFontAtlas_Build(atlas))
+  {
+    DEBUG_ERROR("Failed to build the font atlas for scale %.2f: %s",
+        scale, fc.fontName);
+    ImFontAtlas_destroy(atlas);
+    return false;
+  }
+
+  /* the renderers upload the atlas as RGBA, convert it here too so that this
+   * does not happen on the render thread either */
+  unsigned char * pixels;
+  int width, height, bpp;
+  ImFontAtlas_GetTexDataAsRGBA32(atlas, &pixels, &width, &height, &bpp);
+
+  out->scale    = scale;
+  out->atlas    = atlas;
+  out->large    = large;
+  out->lastUsed = 0;
+  return true;
+}
+
+// must be called with the lock held
+static struct FontAtlas * findLocked(float scale)
+{
+  for(int i = 0; i < FONT_CACHE_SIZE; ++i)
+    if (fc.cache[i].atlas && fc.cache[i].scale == scale)
+      return &fc.cache[i];
+  return NULL;
+}
+
+// must be called with the lock held, evicts the least recently used atlas
+static struct FontAtlas * insertLocked(const struct FontAtlas * atlas)
+{
+  struct FontAtlas * slot = NULL;
+  for(int i = 0; i < FONT_CACHE_SIZE; ++i)
+  {
+    struct FontAtlas * entry = &fc.cache[i];
+    if (!entry->atlas)
+    {
+      slot = entry;
+      break;
+    }
+
+    if (entry != fc.current && (!slot || entry->lastUsed < slot->lastUsed))
+      slot = entry;
+  }
+
+  if (slot->atlas)
+    ImFontAtlas_destroy(slot->atlas);
+
+  *slot = *atlas;
+  return slot;
+}
+
+// must be called with the lock held
+static void useLocked(struct FontAtlas * entry)
+{
+  entry->lastUsed = ++fc.useCount;
+  if (entry == fc.current)
+    return;
+
+  fc.io->Fonts = entry->atlas;
+  fc.current   = entry;
+}
+
+static int buildThread(void * opaque)
+{
+  while(atomic_load(&fc.running))
+  {
+    if (!lgWaitEvent(fc.event, TIMEOUT_INFINITE))
+      continue;
+
+    for(;;)
+    {
+      LG_LOCK(fc.lock);
+      const float scale = fc.request;
+      fc.request  = 0.0f;
+      fc.building = scale;
+      LG_UNLOCK(fc.lock);
+
+      if (scale == 0.0f || !atomic_load(&fc.running))
+        break;
+
+      struct FontAtlas built;
+      const bool ok = buildAtlas(scale, &built);
+
+      LG_LOCK(fc.lock);
+      if (ok && !findLocked(scale))
+        insertLocked(&built);
+      else if (ok)
+        ImFontAtlas_destroy(built.atlas);
+      fc.building = 0.0f;
+      LG_UNLOCK(fc.lock);
+
+      if (ok && fc.readyFn)
+        fc.readyFn();
+    }
+  }
+
+  return 0;
+}
+
+bool fontCache_init(ImGuiIO * io, const char * fontName,
+    const ImWchar * ranges, float uiSize, FontCacheReadyFn readyFn)
+{
+  fc.io       = io;
+  fc.ownAtlas = io->Fonts;
+  fc.fontName = fontName;
+  fc.ranges   = ranges;
+  fc.uiSize   = uiSize;
+  fc.readyFn  = readyFn;
+  LG_LOCK_INIT(fc.lock);
+
+  fc.event = lgCreateEvent(true, 0);
+  if (!fc.event)
+  {
+    DEBUG_ERROR("Failed to create the font cache event");
+    return false;
+  }
+
+  atomic_store(&fc.running, true);
+  if (!lgCreateThread("FontCache", buildThread, NULL, &fc.thread))
+  {
+    DEBUG_ERROR("Failed to create the font cache thread");
+    atomic_store(&fc.running, false);
+    return false;
+  }
+
+  return true;
+}
+
+void fontCache_free(void)
+{
+  if (fc.thread)
+  {
+    atomic_store(&fc.running, false);
+    lgSignalEvent(fc.event);
+    lgJoinThread(fc.thread, NULL);
+    fc.thread = NULL;
+  }
+
+  if (fc.event)
+  {
+    lgFreeEvent(fc.event);
+    fc.event = NULL;
+  }
+
+  if (!fc.io)
+    return;
+
+  // the context frees its own atlas, it must not be left one of ours
+  fc.io->Fonts = fc.ownAtlas;
+  fc.current   = NULL;
+
+  for(int i = 0; i < FONT_CACHE_SIZE; ++i)
+    if (fc.cache[i].atlas)
+    {
+      ImFontAtlas_destroy(fc.cache[i].atlas);
+      fc.cache[i].atlas = NULL;
+    }
+
+  LG_LOCK_FREE(fc.lock);
+  fc.io = NULL;
+}
+
+bool fontCache_use(float scale, bool wait)
+{
+  LG_LOCK(fc.lock);
+  struct FontAtlas * entry = findLocked(scale);
+  if (entry)
+  {
+    useLocked(entry);
+    LG_UNLOCK(fc.lock);
+    return true;
+  }
+
+  if (!wait)
+  {
+    if (fc.request != scale && fc.building != scale)
+    {
+      fc.request = scale;
+      lgSignalEvent(fc.event);
+    }
+    LG_UNLOCK(fc.lock);
+    return false;
+  }
+  LG_UNLOCK(fc.lock);
+
+  struct FontAtlas built;
+  if (!buildAtlas(scale, &built))
+    return false;
+
+  LG_LOCK(fc.lock);
+  entry = findLocked(scale);
+  if (entry)
+    ImFontAtlas_destroy(built.atlas);
+  else
+    entry = insertLocked(&built);
+  useLocked(entry);
+  LG_UNLOCK(fc.lock);
+  return true;
+}
+
+ImFont * fontCache_getLarge(void)
+{
+  return fc.current ? fc.current->large : NULL;
+}
+
+float fontCache_getScale(void)
+{
+  return fc.current ? fc.current->scale : 0.0f;
+}
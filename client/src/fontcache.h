@@ -0,0 +1,55 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_FONTCACHE_
+#define _H_LG_FONTCACHE_
+
+#include <stdbool.h>
+
+#include "cimgui.h"
+
+/* ImGui font atlases are built on a background thread and cached by the
+ * window scale they were built for, so that a change of scale does not stall
+ * the render thread while the fonts are rasterized. Until the atlas for a new
+ * scale is ready the previous one stays in use. */
+
+typedef void (*FontCacheReadyFn)(void);
+
+/* `ranges` must remain valid until fontCache_free, `readyFn` is called from
+ * the build thread when an atlas that was requested becomes available */
+bool fontCache_init(ImGuiIO * io, const char * fontName,
+    const ImWchar * ranges, float uiSize, FontCacheReadyFn readyFn);
+
+// restores the context's own atlas and frees the cached ones
+void fontCache_free(void);
+
+/* switches `io->Fonts` to the atlas for `scale` and returns true, or if it has
+ * not been built yet starts building it and returns false. If `wait` is set
+ * the atlas is built before returning instead. This must be called from the
+ * render thread outside of an ImGui frame. */
+bool fontCache_use(float scale, bool wait);
+
+// the large font of the atlas in use
+ImFont * fontCache_getLarge(void);
+
+// the scale the atlas in use was built for, zero if there is none
+float fontCache_getScale(void);
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "input.h"
+#include "main.h"
+#include "kb.h"
+#include "util.h"
+
+#include "common/debug.h"
+#include "common/locking.h"
+
+#include <purespice.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+
+static struct
+{
+  LG_Lock           lock;
+  KVMFRInputQueue * queue;
+
+  /* what is held down through the queue, this is released through the queue
+   * before it is dropped as the host may inject to a different device than
+   * SPICE would and the release would otherwise be lost */
+  bool              keys[KEY_MAX];
+  uint32_t          buttons;
+
+  // the display refresh rate in mHz reported to the host
+  uint32_t          displayRate;
+}
+input = { 0 };
+
+static bool pushEventLocked(KVMFRInputType type, int code, int x, int y);
+
+void input_init(void)
+{
+  LG_LOCK_INIT(input.lock);
+}
+
+void input_setQueue(KVMFRInputQueue * queue)
+{
+  LG_LOCK(input.lock);
+  if (input.queue && input.queue != queue)
+  {
+    for(int sc = 0; sc < KEY_MAX; ++sc)
+      if (input.keys[sc])
+        pushEventLocked(KVMFR_INPUT_KEY, sc, 0, linux_to_ps2[sc]);
+
+    for(int button = 0; button < 32; ++button)
+      if (input.buttons & (1U << button))
+        pushEventLocked(KVMFR_INPUT_BUTTON, button, 0, 0);
+  }
+
+  input.queue = queue;
+  memset(input.keys, 0, sizeof(input.keys));
+  input.buttons = 0;
+  if (queue)
+    queue->displayRate = input.displayRate;
+  LG_UNLOCK(input.lock);
+
+  if (queue)
+    DEBUG_INFO("Using the shared memory input queue");
+}
+
+void input_setDisplayRate(unsigned int mHz)
+{
+  LG_LOCK(input.lock);
+  input.displayRate = mHz;
+  if (input.queue)
+    input.queue->displayRate = mHz;
+  LG_UNLOCK(input.lock);
+}
+
+static bool pushEventLocked(KVMFRInputType type, int code, int x, int y)
+{
+  KVMFRInputQueue * queue = input.queue;
+  if (!queue)
+    return false;
+
+  const uint32_t wpos = queue->wpos;
+  if (wpos - queue->rpos >= KVMFR_INPUT_QUEUE_LEN)
+  {
+    DEBUG_WARN_RATELIMIT(1000, "Input queue is full, falling back to SPICE");
+    return false;
+  }
+
+  queue->events[wpos % KVMFR_INPUT_QUEUE_LEN] = (KVMFRInputEvent)
+  {
+    .type = type,
+    .code = code,
+    .x    = x,
+    .y    = y
+  };
+
+  // the event must be visible before the host sees the new write position
+  atomic_thread_fence(memory_order_release);
+  queue->wpos = wpos + 1;
+
+  if (type == KVMFR_INPUT_KEY)
+    input.keys[code] = x;
+  else if (type == KVMFR_INPUT_BUTTON && code < 32)
+  {
+    if (x)
+      input.buttons |=  (1U << code);
+    else
+      input.buttons &= ~(1U << code);
+  }
+
+  return true;
+}
+
+static bool pushEvent(KVMFRInputType type, int code, int x, int y)
+{
+  LG_LOCK(input.lock);
+  bool ret = pushEventLocked(type, code, x, y);
+  LG_UNLOCK(input.lock);
+  return ret;
+}
+
+bool input_mouseMotion(int x, int y)
+{
+  if (pushEvent(KVMFR_INPUT_MOTION, 0, x, y))
+    return true;
+
+  return purespice_mouseMotion(x, y);
+}
+
+bool input_mousePress(int button)
+{
+  if (pushEvent(KVMFR_INPUT_BUTTON, button, 1, 0))
+    return true;
+
+  return purespice_mousePress(button);
+}
+
+bool input_mouseRelease(int button)
+{
+  if (pushEvent(KVMFR_INPUT_BUTTON, button, 0, 0))
+    return true;
+
+  return purespice_mouseRelease(button);
+}
+
+bool input_mousePosition(double x, double y)
+{
+  if (!g_state.haveSrcSize || g_state.srcSize.x < 2 || g_state.srcSize.y < 2)
+    return false;
+
+  return pushEvent(KVMFR_INPUT_POSITION, 0,
+      round(util_clamp(x / (g_state.srcSize.x - 1), 0.0, 1.0) *
+        KVMFR_INPUT_ABS_MAX),
+      round(util_clamp(y / (g_state.srcSize.y - 1), 0.0, 1.0) *
+        KVMFR_INPUT_ABS_MAX));
+}
+
+/* the PS/2 scancode is sent alongside the evdev code as it is what windows
+ * guests need to synthesize the key */
+bool input_keyDown(int sc)
+{
+  const uint32_t ps2 = linux_to_ps2[sc];
+  if (pushEvent(KVMFR_INPUT_KEY, sc, 1, ps2))
+    return true;
+
+  return purespice_keyDown(ps2);
+}
+
+bool input_keyUp(int sc)
+{
+  const uint32_t ps2 = linux_to_ps2[sc];
+  if (pushEvent(KVMFR_INPUT_KEY, sc, 0, ps2))
+    return true;
+
+  return purespice_keyUp(ps2);
+}
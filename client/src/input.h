@@ -0,0 +1,53 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_INPUT_
+#define _H_LG_INPUT_
+
+#include <stdbool.h>
+
+#include "common/KVMFR.h"
+
+/* Input for the guest is written to the KVMFR input queue in the shared memory
+ * when the host provides one, which avoids the latency of the SPICE protocol
+ * stack. If there is no queue, or it is full, SPICE is used instead. */
+
+void input_init(void);
+
+// sets the queue advertised by the host, or NULL when the session ends
+void input_setQueue(KVMFRInputQueue * queue);
+
+/* reports the refresh rate of the display in mHz to the host so it does not
+ * capture faster than it can be shown, zero if unknown */
+void input_setDisplayRate(unsigned int mHz);
+
+bool input_mouseMotion(int x, int y);
+bool input_mousePress(int button);
+bool input_mouseRelease(int button);
+
+/* positions the cursor at `x`, `y` in guest pixels, there is no SPICE fallback
+ * for this so false is returned if the queue is unavailable */
+bool input_mousePosition(double x, double y);
+
+// `sc` is a linux evdev key code
+bool input_keyDown(int sc);
+bool input_keyUp(int sc);
+
+#endif
@@ -32,6 +32,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <math.h>
 #include <stdatomic.h>
@@ -66,6 +67,10 @@
 #include "util.h"
 #include "render_queue.h"
 #include "evdev.h"
+#include "input.h"
+#include "motion.h"
+#include "vrr.h"
+#include "fontcache.h"
 
 // forwards
 static int renderThread(void * unused);
@@ -140,6 +145,12 @@ static bool fpsTimerFn(void * unused)
   atomic_store_explicit(&g_state.fps, fps, memory_order_relaxed);
   atomic_store_explicit(&g_state.ups, ups, memory_order_relaxed);
 
+  // the window may have moved to a display with a different refresh rate
+  unsigned int refreshRate;
+  if (!app_getProp(LG_DS_REFRESH_RATE, &refreshRate))
+    refreshRate = 0;
+  input_setDisplayRate(refreshRate);
+
   return true;
 }
 
@@ -164,11 +175,26 @@ static bool tickTimerFn(void * unused)
   return true;
 }
 
+struct RenderTimes
+{
+  uint64_t start;
+  uint64_t swap;
+};
+
 static void preSwapCallback(void * udata)
 {
-  const uint64_t * renderStart = (const uint64_t *)udata;
+  struct RenderTimes * times = (struct RenderTimes *)udata;
+  times->swap = nanotime();
   ringbuffer_push(g_state.renderDuration,
-      &(float) {(nanotime() - *renderStart) * 1e-6f});
+      &(float) {(times->swap - times->start) * 1e-6f});
+  metrics_observe(g_state.metrics.render, times->swap - times->start);
+}
+
+static void fontCacheReady(void)
+{
+  // apply the new atlas through the resize path as the renderers upload it there
+  atomic_fetch_add(&g_state.lgrResize, 1);
+  app_invalidateWindow(false);
 }
 
 static int renderThread(void * unused)
@@ -195,6 +221,9 @@ static int renderThread(void * unused)
   }
 
   app_initOverlays();
+  if (g_params.vrr)
+    vrr_init();
+
   LGTimer * tickTimer;
   if (!lgCreateTimer(1000 / TICK_RATE, tickTimerFn, NULL, &tickTimer))
   {
@@ -234,6 +263,11 @@ static int renderThread(void * unused)
       if (pending > 0)
         atomic_fetch_sub(&g_state.pendingCount, 1);
     }
+    else if (g_params.vrr)
+    {
+      app_handleRenderEvent(microtime());
+      vrr_waitFrame(g_state.frameEvent);
+    }
     else if (g_params.fpsMin != 0)
     {
       app_handleRenderEvent(microtime());
@@ -262,16 +296,16 @@ static int renderThread(void * unused)
         .x = g_state.windowScale,
         .y = g_state.windowScale,
       };
-      g_state.io->FontGlobalScale = 1.0f / g_state.windowScale;
-
-      ImFontAtlas_Clear(g_state.io->Fonts);
-      ImFontAtlas_AddFontFromFileTTF(g_state.io->Fonts, g_state.fontName,
-        g_params.uiSize * g_state.windowScale, NULL, g_state.fontRange.Data);
-      g_state.fontLarge = ImFontAtlas_AddFontFromFileTTF(g_state.io->Fonts,
-        g_state.fontName, 1.3f * g_params.uiSize * g_state.windowScale, NULL, g_state.fontRange.Data);
-      if (!ImFontAtlas_Build(g_state.io->Fonts))
+
+      /* the previous atlas stays in use while the one for a new scale is
+       * built, only the first has to be waited for */
+      const bool haveFonts = fontCache_getScale() != 0.0f;
+      if (!fontCache_use(g_state.windowScale, !haveFonts) && !haveFonts)
         DEBUG_FATAL("Failed to build font atlas: %s (%s)", g_params.uiFont, g_state.fontName);
 
+      g_state.fontLarge           = fontCache_getLarge();
+      g_state.io->FontGlobalScale = 1.0f / fontCache_getScale();
+
       if (g_state.lgr)
         RENDERER(onResize, g_state.windowW, g_state.windowH,
             g_state.windowScale, g_state.dstRect, g_params.winRotate);
@@ -286,13 +320,14 @@ static int renderThread(void * unused)
 
     const bool invalidate = atomic_exchange(&g_state.invalidateWindow, false);
 
-    const uint64_t renderStart = nanotime();
+    struct RenderTimes times = { .start = nanotime() };
+    const uint64_t renderStart = times.start;
     LG_LOCK(g_state.lgrLock);
 
     renderQueue_process();
 
     if (unlikely(!RENDERER(render, g_params.winRotate, newFrame, invalidate,
-          preSwapCallback, (void *)&renderStart)))
+          preSwapCallback, (void *)&times)))
     {
       LG_UNLOCK(g_state.lgrLock);
       break;
@@ -302,6 +337,11 @@ static int renderThread(void * unused)
     const uint64_t t     = nanotime();
     const uint64_t delta = t - g_state.lastRenderTime;
 
+    // renderers that did not swap have nothing to report for the present
+    if (times.swap)
+      metrics_observe(g_state.metrics.present, t - times.swap);
+    metrics_inc(g_state.metrics.renders);
+
     g_state.lastRenderTime = t;
     atomic_fetch_add_explicit(&g_state.renderCount, 1, memory_order_relaxed);
 
@@ -310,6 +350,12 @@ static int renderThread(void * unused)
       const float fdelta = (float)delta / 1e6f;
       ringbuffer_push(g_state.renderTimings, &fdelta);
     }
+
+    /* includes the swap, which is where the frame is finished when headless */
+    if (unlikely(g_state.timingsLog))
+      fprintf(g_state.timingsLog, "%" PRIu64 ",render,%.3f,%.3f\n",
+          t / 1000, (t - renderStart) * 1e-6,
+          g_state.lastRenderTimeValid ? delta * 1e-6 : 0.0);
     g_state.lastRenderTimeValid = true;
 
     const uint64_t now = microtime();
@@ -330,6 +376,8 @@ static int renderThread(void * unused)
 
   g_state.state = APP_STATE_SHUTDOWN;
 
+  vrr_free();
+
   if (g_state.overlays)
   {
     app_freeOverlays();
@@ -793,6 +841,7 @@ int main_frameThread(void * unused)
     }
 
     FrameBuffer * fb = (FrameBuffer *)(((uint8_t*)frame) + frame->offset);
+    const uint64_t uploadStart = nanotime();
     if (!RENDERER(onFrame, fb, g_state.useDMA ? dma->fd : -1,
           frame->damageRects, frame->damageRectsCount))
     {
@@ -801,6 +850,7 @@ int main_frameThread(void * unused)
       g_state.state = APP_STATE_SHUTDOWN;
       break;
     }
+    const uint64_t uploadTime = nanotime() - uploadStart;
 
     overlaySplash_show(false);
 
@@ -822,8 +872,18 @@ int main_frameThread(void * unused)
     const uint64_t delta  = t - g_state.lastFrameTime;
     g_state.lastFrameTime = t;
 
+    metrics_observe(g_state.metrics.upload, uploadTime);
+    metrics_inc(g_state.metrics.frames);
     if (g_state.lastFrameTimeValid)
+    {
       ringbuffer_push(g_state.uploadTimings, &(float) { delta * 1e-6f });
+      metrics_observe(g_state.metrics.frameInterval, delta);
+    }
+
+    if (g_state.timingsLog)
+      fprintf(g_state.timingsLog, "%" PRIu64 ",upload,%.3f,%.3f\n",
+          t / 1000, uploadTime * 1e-6,
+          g_state.lastFrameTimeValid ? delta * 1e-6 : 0.0);
     g_state.lastFrameTimeValid = true;
 
     atomic_fetch_add_explicit(&g_state.frameCount, 1, memory_order_relaxed);
@@ -1067,7 +1127,7 @@ int spiceThread(void * arg)
       if (g_state.keyDown[scancode])
       {
         g_state.keyDown[scancode] = false;
-        purespice_keyUp(scancode);
+        input_keyUp(scancode);
       }
   }
 
@@ -1198,6 +1258,10 @@ static int lg_run(void)
   ImFontGlyphRangesBuilder_BuildRanges(rangeBuilder, &g_state.fontRange);
   ImFontGlyphRangesBuilder_destroy(rangeBuilder);
 
+  if (!fontCache_init(g_state.io, g_state.fontName, g_state.fontRange.Data,
+        g_params.uiSize, fontCacheReady))
+    return -1;
+
   // initialize metrics ringbuffers
   g_state.renderTimings  = ringbuffer_new(256, sizeof(float));
   g_state.uploadTimings  = ringbuffer_new(256, sizeof(float));
@@ -1206,6 +1270,39 @@ static int lg_run(void)
   overlayGraph_register("UPLOAD", g_state.uploadTimings , 0.0f, 50.0f, NULL);
   overlayGraph_register("RENDER", g_state.renderDuration, 0.0f, 10.0f, NULL);
 
+  if (g_params.timingsLog)
+  {
+    g_state.timingsLog = fopen(g_params.timingsLog, "w");
+    if (!g_state.timingsLog)
+      DEBUG_WARN("Failed to open the timings log: %s", g_params.timingsLog);
+    else
+      fputs("time_us,type,duration_ms,interval_ms\n", g_state.timingsLog);
+  }
+
+  g_state.metrics.render        = metrics_histogram("lg_client_render_seconds",
+      "Time taken to render a frame before it is presented");
+  g_state.metrics.present       = metrics_histogram("lg_client_present_seconds",
+      "Time taken to present a rendered frame");
+  g_state.metrics.renders       = metrics_counter("lg_client_renders_total",
+      "Frames rendered to the window");
+  g_state.metrics.upload        = metrics_histogram("lg_client_upload_seconds",
+      "Time taken to upload a frame from the guest to the renderer");
+  g_state.metrics.frameInterval = metrics_histogram(
+      "lg_client_frame_interval_seconds",
+      "Time between frames received from the guest");
+  g_state.metrics.frames        = metrics_counter("lg_client_frames_total",
+      "Frames received from the guest");
+  g_state.metrics.cbToGuest     = metrics_counter(
+      "lg_client_clipboard_sent_bytes_total",
+      "Clipboard data sent to the guest");
+  g_state.metrics.cbFromGuest   = metrics_counter(
+      "lg_client_clipboard_received_bytes_total",
+      "Clipboard data received from the guest");
+
+  if (g_params.metricsFile &&
+      !metrics_startExport(g_params.metricsFile, 1000))
+    DEBUG_WARN("Failed to start exporting metrics to %s", g_params.metricsFile);
+
   // unknown guest OS at this time
   g_state.guestOS = KVMFR_OS_OTHER;
 
@@ -1378,6 +1475,9 @@ static int lg_run(void)
   if (g_params.noScreensaver)
     g_state.ds->inhibitIdle();
 
+  if (g_params.vrr && g_state.ds->setVRR)
+    g_state.ds->setVRR(true);
+
   // ensure renderer viewport is aware of the current window size
   core_updatePositionInfo();
 
@@ -1598,6 +1698,7 @@ restart:
   DEBUG_INFO("Version  : %s", udata->hostver);
 
   /* parse the kvmfr records from the userdata */
+  KVMFRInputQueue * inputQueue = NULL;
   udataSize -= sizeof(*udata);
   uint8_t * p = (uint8_t *)(udata + 1);
   while(udataSize >= sizeof(KVMFRRecord))
@@ -1725,6 +1826,22 @@ restart:
         break;
       }
 
+      case KVMFR_RECORD_INPUT:
+      {
+        KVMFRRecord_Input * input = (KVMFRRecord_Input *)p;
+        if (record->size < sizeof(*input) ||
+            input->size < sizeof(KVMFRInputQueue) ||
+            (uint64_t)input->offset + input->size > g_state.shm.size)
+        {
+          DEBUG_WARN("The input queue record is invalid");
+          break;
+        }
+
+        inputQueue = (KVMFRInputQueue *)
+          ((uint8_t *)g_state.shm.mem + input->offset);
+        break;
+      }
+
       default:
         DEBUG_WARN("Unhandled KVMFRecord type: %d", record->type);
         break;
@@ -1744,6 +1861,10 @@ restart:
 
   g_state.kvmfrFeatures = udata->features;
 
+  if (g_params.shmInput && inputQueue &&
+      (g_state.kvmfrFeatures & KVMFR_FEATURE_INPUT))
+    input_setQueue(inputQueue);
+
   LG_LOCK_INIT(g_state.pointerQueueLock);
   if (!core_startCursorThread() || !core_startFrameThread())
   {
@@ -1764,6 +1885,8 @@ restart:
     g_state.ds->wait(100);
   }
 
+  input_setQueue(NULL);
+
   if (g_state.state == APP_STATE_RESTART)
   {
     lgSignalEvent(e_startup);
@@ -1785,6 +1908,8 @@ static void lg_shutdown(void)
 {
   g_state.state = APP_STATE_SHUTDOWN;
 
+  motion_free();
+
   if (t_spice)
     lgJoinThread(t_spice, NULL);
 
@@ -1841,6 +1966,15 @@ static void lg_shutdown(void)
   ringbuffer_free(&g_state.uploadTimings);
   ringbuffer_free(&g_state.renderDuration);
 
+  if (g_state.timingsLog)
+  {
+    fclose(g_state.timingsLog);
+    g_state.timingsLog = NULL;
+  }
+
+  metrics_stopExport();
+
+  fontCache_free();
   free(g_state.fontName);
   ImVector_ImWchar_UnInit(&g_state.fontRange);
   igDestroyContext(NULL);
@@ -1880,6 +2014,10 @@ int main(int argc, char * argv[])
   if (!lgMessage_init())
     return -1;
 
+  input_init();
+  if (!motion_init())
+    return -1;
+
   g_state.bindings = ll_new();
 
   g_state.overlays = ll_new();
@@ -1911,6 +2049,7 @@ int main(int argc, char * argv[])
   const int ret = lg_run();
   lg_shutdown();
   lgMessage_deinit();
+  lgLockStatsDump();
 
   config_free();
 
@@ -33,6 +33,7 @@
 #include "common/ringbuffer.h"
 #include "common/event.h"
 #include "common/ll.h"
+#include "common/metrics.h"
 
 #include <purespice.h>
 #include <lgmp/client.h>
@@ -72,6 +73,8 @@ struct AppState
   bool             modSuper;
   uint64_t         lastImGuiFrame;
   bool             renderImGuiTwice;
+  uint64_t         overlayHash;
+  bool             overlayChanged;
   bool             exclusiveEvdev;
 
   struct LG_DisplayServerOps * ds;
@@ -141,6 +144,20 @@ struct AppState
   RingBuffer            renderTimings;
   RingBuffer            renderDuration;
   RingBuffer            uploadTimings;
+  FILE                * timingsLog;
+
+  struct
+  {
+    LGMetric * render;
+    LGMetric * present;
+    LGMetric * renders;
+    LGMetric * upload;
+    LGMetric * frameInterval;
+    LGMetric * frames;
+    LGMetric * cbToGuest;
+    LGMetric * cbFromGuest;
+  }
+  metrics;
 
   atomic_uint_least64_t pendingCount;
   atomic_uint_least64_t renderCount, frameCount;
@@ -200,15 +217,22 @@ struct AppParams
   bool                 overlayDim;
   bool                 alwaysShowCursor;
   uint64_t             helpMenuDelayUs;
+  bool                 shmInput;
+  int                  mouseRate;
   const char *         uiFont;
   int                  uiSize;
   bool                 jitRender;
+  bool                 vrr;
+  int                  vrrMin;
+  int                  vrrMax;
   bool                 requestActivation;
   bool                 disableWaitingMessage;
 
   unsigned int         cursorPollInterval;
   unsigned int         framePollInterval;
   bool                 allowDMA;
+  const char         * timingsLog;
+  const char         * metricsFile;
 
   bool                 forceRenderer;
   unsigned int         forceRendererIndex;
@@ -226,6 +250,7 @@ struct AppParams
 
   int                  audioPeriodSize;
   int                  audioBufferLatency;
+  const char         * audioStatsLog;
   bool                 micShowIndicator;
   enum MicDefaultState micDefaultState;
   bool                 audioSyncVolume;
@@ -0,0 +1,180 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "motion.h"
+#include "main.h"
+#include "input.h"
+
+#include "common/debug.h"
+#include "common/event.h"
+#include "common/locking.h"
+#include "common/thread.h"
+#include "common/time.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+
+static struct
+{
+  LG_Lock    lock;
+  uint64_t   period;
+  LGThread * thread;
+  LGEvent  * event;
+  atomic_bool running;
+
+  int        x, y;
+  bool       pending;
+  uint64_t   lastSend;
+
+  uint64_t   eventsIn;
+  uint64_t   messagesOut;
+}
+motion = { 0 };
+
+// must be called with the lock held
+static void sendLocked(uint64_t now)
+{
+  if (motion.x || motion.y)
+  {
+    if (!input_mouseMotion(motion.x, motion.y))
+      DEBUG_ERROR("failed to send mouse motion message");
+    ++motion.messagesOut;
+  }
+
+  motion.x        = 0;
+  motion.y        = 0;
+  motion.pending  = false;
+  motion.lastSend = now;
+}
+
+static int motionThread(void * opaque)
+{
+  while(atomic_load(&motion.running))
+  {
+    if (!lgWaitEvent(motion.event, TIMEOUT_INFINITE))
+      continue;
+
+    for(;;)
+    {
+      LG_LOCK(motion.lock);
+      if (!motion.pending)
+      {
+        LG_UNLOCK(motion.lock);
+        break;
+      }
+
+      const uint64_t now = nanotime();
+      const uint64_t due = motion.lastSend + motion.period;
+      if (now >= due)
+      {
+        sendLocked(now);
+        LG_UNLOCK(motion.lock);
+        break;
+      }
+
+      LG_UNLOCK(motion.lock);
+      nsleep(due - now);
+    }
+  }
+
+  return 0;
+}
+
+bool motion_init(void)
+{
+  LG_LOCK_INIT(motion.lock);
+
+  if (g_params.mouseRate <= 0)
+    return true;
+
+  motion.period = 1000000000ULL / g_params.mouseRate;
+  motion.event  = lgCreateEvent(true, 0);
+  if (!motion.event)
+  {
+    DEBUG_ERROR("Failed to create the motion event");
+    return false;
+  }
+
+  atomic_store(&motion.running, true);
+  if (!lgCreateThread("motionThread", motionThread, NULL, &motion.thread))
+  {
+    DEBUG_ERROR("Failed to create the motion thread");
+    lgFreeEvent(motion.event);
+    motion.event = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void motion_free(void)
+{
+  if (motion.thread)
+  {
+    atomic_store(&motion.running, false);
+    lgSignalEvent(motion.event);
+    lgJoinThread(motion.thread, NULL);
+    motion.thread = NULL;
+  }
+
+  if (motion.event)
+  {
+    lgFreeEvent(motion.event);
+    motion.event = NULL;
+  }
+
+  if (motion.eventsIn)
+    DEBUG_INFO("Mouse motion: %" PRIu64 " events sent as %" PRIu64
+        " messages (%.1f%%)", motion.eventsIn, motion.messagesOut,
+        motion.messagesOut * 100.0 / motion.eventsIn);
+
+  LG_LOCK_FREE(motion.lock);
+}
+
+void motion_push(int x, int y)
+{
+  bool signal = false;
+
+  LG_LOCK(motion.lock);
+  ++motion.eventsIn;
+  motion.x += x;
+  motion.y += y;
+
+  const uint64_t now = motion.period ? nanotime() : 0;
+  if (!motion.thread || now - motion.lastSend >= motion.period)
+    sendLocked(now);
+  else if (!motion.pending)
+  {
+    motion.pending = true;
+    signal         = true;
+  }
+  LG_UNLOCK(motion.lock);
+
+  if (signal)
+    lgSignalEvent(motion.event);
+}
+
+void motion_flush(void)
+{
+  LG_LOCK(motion.lock);
+  if (motion.pending)
+    sendLocked(nanotime());
+  LG_UNLOCK(motion.lock);
+}
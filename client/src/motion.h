@@ -0,0 +1,40 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_MOTION_
+#define _H_LG_MOTION_
+
+#include <stdbool.h>
+
+/* Coalesces captured mouse motion so that high polling rate mice do not flood
+ * the guest with a message per event. Motion is sent immediately when nothing
+ * has been sent for a period of input:mouseRate, otherwise it is accumulated
+ * and sent once the period has passed. */
+
+bool motion_init(void);
+void motion_free(void);
+
+void motion_push(int x, int y);
+
+/* sends any accumulated motion now, this must be done before anything that
+ * depends on the cursor position such as a button press */
+void motion_flush(void);
+
+#endif
@@ -24,16 +24,35 @@
 #include "../main.h"
 
 #include "common/debug.h"
+#include "common/option.h"
+#include "common/time.h"
 #include "overlay_utils.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 struct GraphState
 {
   bool show;
   struct ll * graphs;
+
+  // the graphs are only sampled at this interval so the overlay can be cached
+  uint64_t interval;
+  uint64_t lastSample;
 };
 
 static struct GraphState gs = {0};
 
+struct BufferMetrics
+{
+  float min;
+  float max;
+  float sum;
+  float avg;
+  float freq;
+  float last;
+};
+
 struct OverlayGraph
 {
   const char *  name;
@@ -42,6 +61,12 @@ struct OverlayGraph
   float         min;
   float         max;
   GraphFormatFn formatFn;
+
+  // the values shown, sampled from `buffer`
+  float              * values;
+  int                  length;
+  int                  start;
+  struct BufferMetrics metrics;
 };
 
 
@@ -67,16 +92,33 @@ static void configCallback(void * udata, int * id)
 static void showTimingKeybind(int sc, void * opaque)
 {
   gs.show ^= true;
+  gs.lastSample = 0;
   app_invalidateWindow(false);
 }
 
 static void graphs_earlyInit(void)
 {
+  static struct Option options[] =
+  {
+    {
+      .module         = "win",
+      .name           = "graphRate",
+      .description    = "The rate in Hz the timing graphs are updated at (0 = every frame)",
+      .type           = OPTION_TYPE_INT,
+      .value.x_int    = 10,
+    },
+    { 0 }
+  };
+  option_register(options);
+
   gs.graphs = ll_new();
 }
 
 static bool graphs_init(void ** udata, const void * params)
 {
+  const int rate = option_get_int("win", "graphRate");
+  gs.interval = rate > 0 ? 1000000000ULL / rate : 0;
+
   app_overlayConfigRegister("Performance Metrics", configCallback, NULL);
   app_registerKeybind(0, 'T', showTimingKeybind, NULL,
       "Show frame timing information");
@@ -87,21 +129,14 @@ static void graphs_free(void * udata)
 {
   struct OverlayGraph * graph;
   while(ll_shift(gs.graphs, (void **)&graph))
+  {
+    free(graph->values);
     free(graph);
+  }
   ll_free(gs.graphs);
   gs.graphs = NULL;
 }
 
-struct BufferMetrics
-{
-  float min;
-  float max;
-  float sum;
-  float avg;
-  float freq;
-  float last;
-};
-
 static bool rbCalcMetrics(int index, void * value_, void * udata_)
 {
   float * value = value_;
@@ -126,6 +161,37 @@ static bool rbCalcMetrics(int index, void * value_, void * udata_)
   return true;
 }
 
+static void sampleGraph(struct OverlayGraph * graph)
+{
+  const int length = ringbuffer_getLength(graph->buffer);
+  if (length > graph->length || !graph->values)
+  {
+    float * values = realloc(graph->values, max(length, 1) * sizeof(float));
+    if (!values)
+    {
+      DEBUG_ERROR("out of memory");
+      return;
+    }
+    graph->values = values;
+  }
+
+  memcpy(graph->values, ringbuffer_getValues(graph->buffer),
+      length * sizeof(float));
+  graph->length = length;
+  graph->start  = ringbuffer_getStart(graph->buffer);
+
+  struct BufferMetrics metrics = {};
+  ringbuffer_forEach(graph->buffer, rbCalcMetrics, &metrics, false);
+
+  if (metrics.sum > 0.0f)
+  {
+    metrics.avg  = metrics.sum / ringbuffer_getCount(graph->buffer);
+    metrics.freq = 1000.0f / metrics.avg;
+  }
+
+  graph->metrics = metrics;
+}
+
 static int graphs_render(void * udata, bool interactive,
     struct Rect * windowRects, int maxRects)
 {
@@ -170,20 +236,20 @@ static int graphs_render(void * udata, bool interactive,
   const float height = (winSize.y / graphCount)
     - igGetStyle()->ItemSpacing.y;
 
+  const uint64_t now = nanotime();
+  const bool sample = now - gs.lastSample >= gs.interval;
+  if (sample)
+    gs.lastSample = now;
+
   ll_forEachNL(gs.graphs, item, graph)
   {
     if (!graph->enabled)
       continue;
 
-    struct BufferMetrics metrics = {};
-    ringbuffer_forEach(graph->buffer, rbCalcMetrics, &metrics, false);
-
-    if (metrics.sum > 0.0f)
-    {
-      metrics.avg  = metrics.sum / ringbuffer_getCount(graph->buffer);
-      metrics.freq = 1000.0f / metrics.avg;
-    }
+    if (sample || !graph->values)
+      sampleGraph(graph);
 
+    const struct BufferMetrics metrics = graph->metrics;
     const char * title;
     if (graph->formatFn)
       title = graph->formatFn(graph->name,
@@ -199,9 +265,9 @@ static int graphs_render(void * udata, bool interactive,
 
     igPlotLines_FloatPtr(
         (void *)graph,
-        (float *)ringbuffer_getValues(graph->buffer),
-        ringbuffer_getLength(graph->buffer),
-        ringbuffer_getStart (graph->buffer),
+        graph->values,
+        graph->length,
+        graph->start,
         title,
         graph->min,
         graph->max,
@@ -240,6 +306,10 @@ GraphHandle overlayGraph_register(const char * name, RingBuffer buffer,
   graph->min      = min;
   graph->max      = max;
   graph->formatFn = formatFn;
+  graph->values   = NULL;
+  graph->length   = 0;
+  graph->start    = 0;
+  graph->metrics  = (struct BufferMetrics){0};
   ll_push(gs.graphs, graph);
   return graph;
 }
@@ -250,6 +320,7 @@ void overlayGraph_unregister(GraphHandle handle)
     return;
 
   ll_removeData(gs.graphs, handle);
+  free(handle->values);
   free(handle);
 
   if (gs.show)
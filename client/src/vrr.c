@@ -0,0 +1,173 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "vrr.h"
+#include "main.h"
+#include "app.h"
+
+#include "common/debug.h"
+#include "common/ringbuffer.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+// the weight of the guest frame interval moving average in samples
+#define FRAME_WEIGHT 8
+
+struct VRRState
+{
+  // all times are in nanoseconds on CLOCK_MONOTONIC
+  uint64_t minInterval; // from win:vrrMax, 0 if unlimited
+  uint64_t maxInterval; // from win:vrrMin
+
+  uint64_t lastPresent;
+  uint64_t lastFrame;
+  uint64_t frameCount;
+  uint64_t frameInterval;
+
+  // the number of times each guest frame is presented
+  int lfcMultiple;
+
+  // cadence statistics
+  uint64_t frames;
+  uint64_t repeats;
+  uint64_t held;
+
+  RingBuffer  intervals;
+  GraphHandle graph;
+};
+
+static struct VRRState vrr = { 0 };
+
+static inline uint64_t monotonicTime(void)
+{
+  // lgWaitEventAbs waits on CLOCK_MONOTONIC, nanotime uses the raw clock
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char * vrrGraphFormatFn(const char * name,
+    float min, float max, float avg, float freq, float last)
+{
+  static char title[64];
+  snprintf(title, sizeof(title),
+      "%s: %5.1f Hz min:%4.2f max:%4.2f LFC:x%d",
+      name, freq, min, max, vrr.lfcMultiple);
+  return title;
+}
+
+void vrr_init(void)
+{
+  vrr.maxInterval = 1000000000ULL / max(1, g_params.vrrMin);
+  vrr.minInterval = g_params.vrrMax > 0 ?
+    1000000000ULL / g_params.vrrMax : 0;
+
+  vrr.lastPresent = monotonicTime();
+  vrr.lfcMultiple = 1;
+
+  vrr.intervals = ringbuffer_new(256, sizeof(float));
+  vrr.graph     = app_registerGraph("VRR", vrr.intervals, 0.0f, 50.0f,
+      vrrGraphFormatFn);
+
+  DEBUG_INFO("Using VRR presentation, %d - %d Hz", g_params.vrrMin,
+      g_params.vrrMax);
+}
+
+void vrr_free(void)
+{
+  if (!vrr.intervals)
+    return;
+
+  DEBUG_INFO("VRR: %" PRIu64 " frames, %" PRIu64 " LFC repeats, "
+      "%" PRIu64 " held back by win:vrrMax", vrr.frames, vrr.repeats, vrr.held);
+
+  app_unregisterGraph(vrr.graph);
+  ringbuffer_free(&vrr.intervals);
+}
+
+static uint64_t lfcInterval(void)
+{
+  /* present each frame enough times to keep the refresh rate above the
+   * minimum, evenly spaced over the expected guest frame interval */
+  if (!vrr.frameInterval || vrr.frameInterval <= vrr.maxInterval)
+  {
+    vrr.lfcMultiple = 1;
+    return vrr.maxInterval;
+  }
+
+  vrr.lfcMultiple = (vrr.frameInterval + vrr.maxInterval - 1) /
+    vrr.maxInterval;
+
+  return max(vrr.frameInterval / vrr.lfcMultiple, vrr.minInterval);
+}
+
+bool vrr_waitFrame(LGEvent * frameEvent)
+{
+  const uint64_t deadline = vrr.lastPresent + lfcInterval();
+  struct timespec ts =
+  {
+    .tv_sec  = deadline / 1000000000ULL,
+    .tv_nsec = deadline % 1000000000ULL
+  };
+
+  const bool signalled = lgWaitEventAbs(frameEvent, &ts);
+  uint64_t now = monotonicTime();
+
+  // the event is also signalled for cursor updates, only time guest frames
+  const uint64_t frameCount =
+    atomic_load_explicit(&g_state.frameCount, memory_order_relaxed);
+  if (frameCount != vrr.frameCount)
+  {
+    if (vrr.lastFrame)
+    {
+      const uint64_t interval = now - vrr.lastFrame;
+      vrr.frameInterval = vrr.frameInterval ?
+        (int64_t)vrr.frameInterval +
+        ((int64_t)interval - (int64_t)vrr.frameInterval) / FRAME_WEIGHT :
+        interval;
+    }
+
+    vrr.frameCount = frameCount;
+    vrr.lastFrame  = now;
+    ++vrr.frames;
+  }
+
+  if (!signalled)
+    ++vrr.repeats;
+
+  // never present faster than the display can refresh
+  if (vrr.minInterval && now < vrr.lastPresent + vrr.minInterval)
+  {
+    nsleep(vrr.lastPresent + vrr.minInterval - now);
+    now = monotonicTime();
+    ++vrr.held;
+  }
+
+  const float interval = (now - vrr.lastPresent) / 1e6f;
+  ringbuffer_push(vrr.intervals, &interval);
+
+  vrr.lastPresent = now;
+  return !signalled;
+}
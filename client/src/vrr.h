@@ -0,0 +1,40 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_VRR_
+#define _H_LG_VRR_
+
+#include <stdbool.h>
+
+#include "common/event.h"
+
+/* Presentation for variable refresh rate displays, frames are presented as
+ * soon as they arrive, no faster than win:vrrMax. When the guest frame rate
+ * drops below win:vrrMin each frame is presented multiple times (low framerate
+ * compensation) so the display stays within its refresh range. */
+
+void vrr_init(void);
+void vrr_free(void);
+
+/* waits on `frameEvent` until the next frame should be presented, returns true
+ * if this is a repeat for low framerate compensation */
+bool vrr_waitFrame(LGEvent * frameEvent);
+
+#endif
@@ -57,7 +57,8 @@ typedef uint32_t KVMFRCursorFlags;
 enum
 {
   KVMFR_FEATURE_SETCURSORPOS = 0x1,
-  KVMFR_FEATURE_WINDOWSIZE   = 0x2
+  KVMFR_FEATURE_WINDOWSIZE   = 0x2,
+  KVMFR_FEATURE_INPUT        = 0x4
 };
 
 typedef uint32_t KVMFRFeatureFlags;
@@ -91,7 +92,8 @@ KVMFRRecord;
 enum
 {
   KVMFR_RECORD_VMINFO = 1,
-  KVMFR_RECORD_OSINFO
+  KVMFR_RECORD_OSINFO,
+  KVMFR_RECORD_INPUT
 };
 
 typedef enum
@@ -122,6 +124,13 @@ typedef struct KVMFRRecord_OSInfo
 }
 KVMFRRecord_OSInfo;
 
+typedef struct KVMFRRecord_Input
+{
+  uint32_t offset; // offset of the KVMFRInputQueue from the start of the shm
+  uint32_t size;   // size of the KVMFRInputQueue in bytes
+}
+KVMFRRecord_Input;
+
 typedef struct KVMFRCursor
 {
   int16_t    x, y;        // cursor x & y position
@@ -185,6 +194,55 @@ typedef struct KVMFRWindowSize
 }
 KVMFRWindowSize;
 
+#define KVMFR_INPUT_QUEUE_LEN 256
+#define KVMFR_INPUT_ABS_MAX   0x7fff
+
+enum
+{
+  KVMFR_INPUT_MOTION,   // x & y are a relative movement
+  KVMFR_INPUT_POSITION, // x & y are in the range 0 to KVMFR_INPUT_ABS_MAX
+  KVMFR_INPUT_BUTTON,   // code is a KVMFR_BUTTON_*, x is non-zero if pressed
+  KVMFR_INPUT_KEY       // code is a linux evdev key code, x is non-zero if pressed
+};
+
+typedef uint16_t KVMFRInputType;
+
+// the same numbering as SPICE uses
+enum
+{
+  KVMFR_BUTTON_LEFT = 1,
+  KVMFR_BUTTON_MIDDLE,
+  KVMFR_BUTTON_RIGHT,
+  KVMFR_BUTTON_WHEEL_UP,
+  KVMFR_BUTTON_WHEEL_DOWN,
+  KVMFR_BUTTON_SIDE,
+  KVMFR_BUTTON_EXTRA
+};
+
+typedef struct KVMFRInputEvent
+{
+  KVMFRInputType type;
+  uint16_t       code;
+  int32_t        x, y;
+}
+KVMFRInputEvent;
+
+/* a single producer, single consumer ring of input events, the client writes
+ * an event and then advances `wpos`, the host processes it and then advances
+ * `rpos`, both wrap at 2^32 and are masked to index `events`.
+ *
+ * `displayRate` is written by the client with the refresh rate of the display
+ * it presents on in mHz, or zero if it is unknown, the host uses this to avoid
+ * capturing faster than the client can show the frames */
+typedef struct KVMFRInputQueue
+{
+  volatile uint32_t wpos;
+  volatile uint32_t rpos;
+  volatile uint32_t displayRate;
+  KVMFRInputEvent   events[KVMFR_INPUT_QUEUE_LEN];
+}
+KVMFRInputQueue;
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
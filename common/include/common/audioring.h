@@ -0,0 +1,60 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_AUDIORING_
+#define _H_LG_COMMON_AUDIORING_
+
+#include <stddef.h>
+
+/* A single producer, single consumer ring of audio frames.
+ *
+ * The producer and consumer positions live on their own cache lines, and each
+ * call moves a whole batch of frames with a single acquire of the other
+ * side's position and a single release of its own.
+ *
+ * Like an unbounded RingBuffer, the positions move independently so that
+ * the latency stays stable across an underrun or overrun. An underrun reads
+ * silence and the writer then skips the same number of frames. An overrun
+ * discards frames and the reader then gets silence in their place. A negative
+ * count seeks backwards.
+ *
+ * append may only be called from one thread and consume from one other
+ * thread. getCount is safe from either. */
+
+typedef struct AudioRing * AudioRing;
+
+// the capacity is rounded up to a power of two
+AudioRing audioring_new(int frames, size_t frameSize);
+void audioring_free(AudioRing * ring);
+
+// the number of frames buffered, negative while underrunning
+int audioring_getCount(const AudioRing ring);
+
+/* producer: appends `count` frames, or silence if `frames` is NULL. Returns
+ * the distance the write position moved, which is always `count` */
+int audioring_append(AudioRing ring, const void * frames, int count);
+
+/* consumer: reads `count` frames, padding with silence when there is not
+ * enough data. If `frames` is NULL the read position is moved without
+ * reading. Returns the distance the read position moved, which is always
+ * `count` */
+int audioring_consume(AudioRing ring, void * frames, int count);
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_CPUDISPATCH_
+#define _H_LG_COMMON_CPUDISPATCH_
+
+#include <stdbool.h>
+
+/* Selects the implementation of each SIMD kernel (framebuffer_write,
+ * rectCopyUnaligned, hdrconv_rgba16fToRGB10 and the sampleconv functions) from
+ * a single CPU tier.
+ *
+ * The tier defaults to the best one the CPU supports and may be forced with
+ * the LG_CPU_TIER environment variable (c, sse4.1, avx, avx2, avx512 or neon)
+ * for benchmarking. A kernel uses its implementation for the active tier, or the
+ * best one below it if it has none. The x86 tiers each imply those below them,
+ * NEON only falls back to C. */
+
+typedef enum CPUTier
+{
+  CPU_TIER_C,
+  CPU_TIER_SSE4_1,
+  CPU_TIER_AVX,    // Sandy Bridge and Ivy Bridge, AVX without AVX2
+  CPU_TIER_AVX2,   // also implies FMA and F16C
+  CPU_TIER_AVX512, // AVX-512 F and BW
+  CPU_TIER_NEON,
+
+  CPU_TIER_MAX
+}
+CPUTier;
+
+typedef void (*CPUDispatchFn)(void);
+
+typedef struct CPUDispatchImpl
+{
+  CPUTier       tier;
+  CPUDispatchFn fn;
+}
+CPUDispatchImpl;
+
+typedef struct CPUDispatchKernel
+{
+  const char            * name;
+  const CPUDispatchImpl * impls;
+  int                     count;
+
+  // points the kernel's public function pointer back at its resolver
+  void (*reset)(void);
+}
+CPUDispatchKernel;
+
+#define CPU_DISPATCH_IMPL(tier, fn) { (tier), (CPUDispatchFn)(fn) }
+
+// the kernels, defined alongside their implementations
+extern const CPUDispatchKernel framebuffer_writeKernel;
+extern const CPUDispatchKernel rectCopyUnalignedKernel;
+extern const CPUDispatchKernel hdrconv_rgba16fToRGB10Kernel;
+extern const CPUDispatchKernel sampleconv_s16ToFloatKernel;
+extern const CPUDispatchKernel sampleconv_floatToS16Kernel;
+
+const char * cpuDispatch_tierName(CPUTier tier);
+bool cpuDispatch_tierSupported(CPUTier tier);
+
+/* the tier in use, resolved on the first call */
+CPUTier cpuDispatch_getTier(void);
+
+/* forces `tier` and has every kernel resolve again on its next call. This is
+ * not thread safe, the kernels must not be in use */
+bool cpuDispatch_setTier(CPUTier tier);
+
+/* the implementation of `kernel` for the active tier, for use by the kernel's
+ * resolver */
+CPUDispatchFn cpuDispatch_select(const CPUDispatchKernel * kernel);
+
+/* the implementation of `kernel` for exactly `tier`, or NULL if there is none
+ * or it is unsupported by this CPU */
+CPUDispatchFn cpuDispatch_getImpl(const CPUDispatchKernel * kernel,
+    CPUTier tier);
+
+const CPUDispatchKernel * cpuDispatch_findKernel(const char * name);
+
+/* all of the registered kernels */
+const CPUDispatchKernel * const * cpuDispatch_getKernels(int * count);
+
+#endif
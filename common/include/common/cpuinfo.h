@@ -38,7 +38,9 @@ typedef struct
   bool aes;
   bool xsave, osxsave;
   bool avx, avx2;
+  bool f16c;
   bool bmi1, bmi2;
+  bool avx512f, avx512bw;
 }
 CPUInfoFeatures;
 
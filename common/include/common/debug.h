@@ -27,6 +27,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 #include <inttypes.h>
 #include "time.h"
 
@@ -46,6 +48,22 @@ extern const char ** debug_lookup;
 void debug_init(void);
 void debug_enableTracing(void);
 
+/* messages are written out asynchronously, this writes out everything queued
+ * so far and makes all further logging synchronous. Call it before the process
+ * is torn down abnormally, such as from a crash handler */
+void debug_flush(void);
+
+struct DebugRateLimit
+{
+  _Atomic(uint64_t) next;
+  atomic_uint       suppressed;
+};
+
+/* returns true at most once every `interval` ms for the given `limit`, with the
+ * number of calls that were suppressed since in `suppressed` */
+bool debug_rateLimit(struct DebugRateLimit * limit, unsigned int interval,
+    unsigned int * suppressed);
+
 // platform specific debug initialization
 void platform_debugInit(void);
 
@@ -113,12 +131,33 @@ void debug_trace(const char * file, unsigned int line, const char * function,
       fmt, ##__VA_ARGS__); \
 } while (0)
 
+#define DEBUG_PRINT_RATELIMIT(level, interval, fmt, ...) do { \
+  static struct DebugRateLimit _limit; \
+  unsigned int _suppressed; \
+  if (debug_rateLimit(&_limit, (interval), &_suppressed)) \
+  { \
+    if (_suppressed) \
+      DEBUG_PRINT(level, fmt " (%u more suppressed)", ##__VA_ARGS__, \
+          _suppressed); \
+    else \
+      DEBUG_PRINT(level, fmt, ##__VA_ARGS__); \
+  } \
+} while (0)
+
 #define DEBUG_BREAK() DEBUG_PRINT(DEBUG_LEVEL_INFO, "================================================================================")
 #define DEBUG_INFO(fmt, ...) DEBUG_PRINT(DEBUG_LEVEL_INFO, fmt, ##__VA_ARGS__)
 #define DEBUG_WARN(fmt, ...) DEBUG_PRINT(DEBUG_LEVEL_WARN, fmt, ##__VA_ARGS__)
 #define DEBUG_ERROR(fmt, ...) DEBUG_PRINT(DEBUG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
 #define DEBUG_TRACE(fmt, ...) DEBUG_PRINT(DEBUG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
 #define DEBUG_FIXME(fmt, ...) DEBUG_PRINT(DEBUG_LEVEL_FIXME, fmt, ##__VA_ARGS__)
+
+// for messages that may repeat every frame, at most one per `ms` is printed
+#define DEBUG_INFO_RATELIMIT(ms, fmt, ...) \
+  DEBUG_PRINT_RATELIMIT(DEBUG_LEVEL_INFO, ms, fmt, ##__VA_ARGS__)
+#define DEBUG_WARN_RATELIMIT(ms, fmt, ...) \
+  DEBUG_PRINT_RATELIMIT(DEBUG_LEVEL_WARN, ms, fmt, ##__VA_ARGS__)
+#define DEBUG_ERROR_RATELIMIT(ms, fmt, ...) \
+  DEBUG_PRINT_RATELIMIT(DEBUG_LEVEL_ERROR, ms, fmt, ##__VA_ARGS__)
 #define DEBUG_FATAL(fmt, ...) do { \
   DEBUG_BREAK(); \
   DEBUG_PRINT(DEBUG_LEVEL_FATAL, fmt, ##__VA_ARGS__); \
@@ -133,6 +172,7 @@ void debug_trace(const char * file, unsigned int line, const char * function,
   if (!(__VA_ARGS__)) \
   { \
     DEBUG_ASSERT_PRINT(__VA_ARGS__); \
+    debug_flush(); \
     abort(); \
   } \
 } while (0)
@@ -0,0 +1,62 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_HDRCONV_
+#define _H_LG_COMMON_HDRCONV_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common/framebuffer.h"
+
+/**
+ * Converts RGBA16F pixels to packed RGB10A2 (red in the low bits) halving the
+ * size of HDR frames.
+ *
+ * The source is expected to be linear scRGB (BT.709 primaries, 1.0 = 80 nits),
+ * the output uses BT.2020 primaries as expected by the client. If `pq` is set
+ * the output is SMPTE ST 2084 (PQ) encoded, otherwise it is linear and values
+ * above 1.0 are clipped.
+ *
+ * @param src   the source pixels, four halfs per pixel
+ * @param dst   the destination pixels
+ * @param count the number of pixels to convert
+ * @param pq    true to PQ encode the output
+ */
+extern void (*hdrconv_rgba16fToRGB10)(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq);
+
+/**
+ * Converts an RGBA16F image into the framebuffer as RGB10A2, advancing the
+ * write pointer as it goes so the client can start reading before the whole
+ * frame has been converted. The output pitch is `width * 4`.
+ *
+ * @param frame    the destination framebuffer
+ * @param src      the source image
+ * @param srcPitch the source row length in bytes
+ * @param width    the image width in pixels
+ * @param height   the image height in pixels
+ * @param pq       true to PQ encode the output
+ */
+bool hdrconv_writeFrame(FrameBuffer * frame, const void * restrict src,
+    size_t srcPitch, size_t width, size_t height, bool pq);
+
+#endif
@@ -22,24 +22,109 @@
 #define _H_LG_COMMON_LOCKING_
 
 #include "time.h"
+#include "util.h"
 
 #include <stdatomic.h>
+#include <stdint.h>
 
-#define LG_LOCK_MODE "Atomic"
-typedef atomic_flag LG_Lock;
-#define LG_LOCK_INIT(x) atomic_flag_clear(&(x))
-#define LG_LOCK(x) \
-  while(atomic_flag_test_and_set_explicit(&(x), memory_order_acquire)) { ; }
-#define LG_UNLOCK(x) \
-  atomic_flag_clear_explicit(&(x), memory_order_release);
+#if defined(__x86_64__) || defined(__i386__)
+  #define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+  #define CPU_RELAX() __asm__ volatile("yield")
+#else
+  #define CPU_RELAX()
+#endif
+
+/**
+ * An adaptive lock, an uncontended lock and unlock is a single atomic
+ * operation. A contended lock spins briefly before the thread is parked until
+ * the holder unlocks it, so a lock held for a long time (ie, `lgrLock` over a
+ * full render) does not burn a core.
+ *
+ * `state` is 0 when unlocked, 1 when locked and 2 when locked with threads
+ * that may be parked on it.
+ *
+ * When built with ENABLE_LOCK_STATS the acquire count, wait and hold times of
+ * each lock are recorded under the name it was initialized with and dumped by
+ * lgLockStatsDump.
+ */
+#define LG_LOCK_MODE "Adaptive"
+
+struct LG_LockStats;
+
+typedef struct LG_Lock
+{
+  _Atomic(uint32_t) state;
+#ifdef ENABLE_LOCK_STATS
+  struct LG_LockStats * stats;
+  uint64_t              lockedAt;
+#endif
+}
+LG_Lock;
+
+// platform specific slow paths
+void lgLockContended(LG_Lock * lock);
+void lgLockWake(LG_Lock * lock);
+
+#ifdef ENABLE_LOCK_STATS
+void lgLockInitStats(LG_Lock * lock, const char * name);
+void lgLockAcquired (LG_Lock * lock, uint64_t waitStart, bool contended);
+void lgLockReleased (LG_Lock * lock);
+void lgLockStatsDump(void);
+#else
+static inline void lgLockStatsDump(void) {}
+#endif
+
+static inline void lgLockInit(LG_Lock * lock, const char * name)
+{
+  atomic_init(&lock->state, 0);
+#ifdef ENABLE_LOCK_STATS
+  lgLockInitStats(lock, name);
+#else
+  (void)name;
+#endif
+}
+
+static inline void lgLock(LG_Lock * lock)
+{
+#ifdef ENABLE_LOCK_STATS
+  const uint64_t waitStart = nanotime();
+#endif
+
+  uint32_t expected = 0;
+  const bool acquired = atomic_compare_exchange_strong_explicit(&lock->state,
+      &expected, 1, memory_order_acquire, memory_order_relaxed);
+
+  if (unlikely(!acquired))
+    lgLockContended(lock);
+
+#ifdef ENABLE_LOCK_STATS
+  lgLockAcquired(lock, waitStart, !acquired);
+#endif
+}
+
+static inline void lgUnlock(LG_Lock * lock)
+{
+#ifdef ENABLE_LOCK_STATS
+  lgLockReleased(lock);
+#endif
+
+  if (unlikely(atomic_exchange_explicit(&lock->state, 0,
+          memory_order_release) == 2))
+    lgLockWake(lock);
+}
+
+#define LG_LOCK_INIT(x) lgLockInit(&(x), #x)
+#define LG_LOCK(x)      lgLock(&(x))
+#define LG_UNLOCK(x)    lgUnlock(&(x))
 #define LG_LOCK_FREE(x)
 
 #define INTERLOCKED_INC(x) atomic_fetch_add((x), 1)
 #define INTERLOCKED_DEC(x) atomic_fetch_sub((x), 1)
 
 #define INTERLOCKED_SECTION(lock, ...) \
-  LG_LOCK(lock) \
+  LG_LOCK(lock); \
   __VA_ARGS__ \
-  LG_UNLOCK(lock)
+  LG_UNLOCK(lock);
 
 #endif
@@ -0,0 +1,64 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_METRICS_
+#define _H_LG_COMMON_METRICS_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A process wide registry of named counters, gauges and histograms that can
+ * be updated from any thread without locking and exported in the Prometheus
+ * text format.
+ *
+ * Registering a name that already exists returns the existing metric, so
+ * call sites may register lazily. NULL is returned if the registry is full,
+ * all of the update functions accept NULL and do nothing. */
+
+typedef struct LGMetric LGMetric;
+
+LGMetric * metrics_counter  (const char * name, const char * help);
+LGMetric * metrics_gauge    (const char * name, const char * help);
+
+/* histograms take durations in nanoseconds and are exported in seconds, the
+ * buckets are log-linear with eight per power of two */
+LGMetric * metrics_histogram(const char * name, const char * help);
+
+void metrics_add    (LGMetric * metric, uint64_t value);
+void metrics_set    (LGMetric * metric, int64_t  value);
+void metrics_observe(LGMetric * metric, uint64_t ns);
+
+static inline void metrics_inc(LGMetric * metric)
+{
+  metrics_add(metric, 1);
+}
+
+/* writes all metrics in the Prometheus text format to `buffer`, returns the
+ * length that was needed, which may be larger than `size` */
+size_t metrics_format(char * buffer, size_t size);
+
+/* rewrites `path` with the current metrics every `intervalMs`, the file is
+ * replaced atomically so it is suitable for the node_exporter textfile
+ * collector */
+bool metrics_startExport(const char * path, unsigned int intervalMs);
+void metrics_stopExport(void);
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_RESAMPLER_
+#define _H_LG_COMMON_RESAMPLER_
+
+#include <stdbool.h>
+
+/* A small polyphase windowed-sinc resampler intended for ratios very close to
+ * 1.0, such as those used to correct for clock drift between two audio
+ * devices. It does not band limit for larger ratio changes and is not a
+ * general purpose sample rate converter. */
+typedef struct Resampler * Resampler;
+
+/**
+ * Creates a new resampler
+ *
+ * @param channels  the number of interleaved channels
+ * @param maxFrames the expected maximum number of input frames per call, larger
+ *                  inputs are processed in multiple passes
+ */
+Resampler resampler_new(int channels, int maxFrames);
+void resampler_free(Resampler * rs);
+
+/* Discards any buffered input and restarts from silence */
+void resampler_reset(Resampler rs);
+
+/* The delay introduced by the resampler in input frames */
+int resampler_getLatency(void);
+
+/**
+ * Resamples the input, all input frames are consumed.
+ *
+ * @param in        the interleaved input frames
+ * @param frames    the number of input frames
+ * @param out       the interleaved output buffer
+ * @param outFrames the size of the output buffer in frames, this must be at
+ *                  least `ceil(frames * ratio) + 1`
+ * @param ratio     the output to input sample rate ratio
+ *
+ * @returns the number of output frames generated
+ */
+int resampler_process(Resampler rs, const float * in, int frames,
+    float * out, int outFrames, double ratio);
+
+#endif
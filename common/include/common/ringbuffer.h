@@ -42,6 +42,11 @@ RingBuffer ringbuffer_new(int length, size_t valueSize);
 RingBuffer ringbuffer_newUnbounded(int length, size_t valueSize);
 
 void ringbuffer_free(RingBuffer * rb);
+
+/* Appends a value, if the buffer is bounded and full the oldest value is
+ * discarded first. As this moves the read pointer it is not safe to use while
+ * another thread is consuming from a bounded buffer, use ringbuffer_append
+ * instead */
 void ringbuffer_push(RingBuffer rb, const void * value);
 void ringbuffer_reset(RingBuffer rb);
 
@@ -0,0 +1,49 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _H_LG_COMMON_SAMPLECONV_
+#define _H_LG_COMMON_SAMPLECONV_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Converts interleaved signed 16-bit samples to floats in the range
+ * [-1.0, 1.0).
+ *
+ * @param src   the source samples
+ * @param dst   the destination buffer
+ * @param count the number of samples (frames * channels) to convert
+ */
+extern void (*sampleconv_s16ToFloat)(const int16_t * restrict src,
+    float * restrict dst, size_t count);
+
+/**
+ * Converts float samples to signed 16-bit samples, values outside of the
+ * range [-1.0, 1.0] are clamped.
+ *
+ * @param src   the source samples
+ * @param dst   the destination buffer
+ * @param count the number of samples (frames * channels) to convert
+ */
+extern void (*sampleconv_floatToS16)(const float * restrict src,
+    int16_t * restrict dst, size_t count);
+
+#endif
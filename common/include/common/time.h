@@ -140,4 +140,9 @@ typedef bool (*LGTimerFn)(void * udata);
 bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
     void * udata, LGTimer ** result);
 
+/* As lgCreateTimer but with a microsecond interval. The Windows
+ * implementation is limited to the resolution of SetTimer. */
+bool lgCreateTimerUS(const unsigned int intervalUS, LGTimerFn fn,
+    void * udata, LGTimer ** result);
+
 void lgTimerDestroy(LGTimer * timer);
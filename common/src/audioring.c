@@ -0,0 +1,219 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/audioring.h"
+#include "common/debug.h"
+#include "common/util.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+struct AudioRing
+{
+  uint32_t frames;
+  uint32_t mask;
+  uint32_t frameSize;
+
+  // written by the producer only
+  alignas(64) _Atomic(uint32_t) writePos;
+
+  // written by the consumer only
+  alignas(64) _Atomic(uint32_t) readPos;
+
+  alignas(64) uint8_t data[0];
+};
+
+static void * allocAligned(size_t size)
+{
+  size = ALIGN_TO(size, alignof(struct AudioRing));
+#ifdef _WIN32
+  return _aligned_malloc(size, alignof(struct AudioRing));
+#else
+  return aligned_alloc(alignof(struct AudioRing), size);
+#endif
+}
+
+static void freeAligned(void * ptr)
+{
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+AudioRing audioring_new(int frames, size_t frameSize)
+{
+  DEBUG_ASSERT(frames > 0 && frames <= (1 << 30));
+  DEBUG_ASSERT(frameSize > 0 && frameSize < UINT32_MAX);
+
+  /* a power of two keeps the index a mask and lets the positions wrap at
+   * 2^32 without a discontinuity */
+  uint32_t size = 1;
+  while(size < (uint32_t)frames)
+    size <<= 1;
+
+  const size_t bytes = sizeof(struct AudioRing) + (size_t)size * frameSize;
+  struct AudioRing * ring = allocAligned(bytes);
+  if (!ring)
+  {
+    DEBUG_ERROR("out of memory");
+    return NULL;
+  }
+  memset(ring, 0, bytes);
+
+  ring->frames    = size;
+  ring->mask      = size - 1;
+  ring->frameSize = frameSize;
+  atomic_store(&ring->writePos, 0);
+  atomic_store(&ring->readPos , 0);
+  return ring;
+}
+
+void audioring_free(AudioRing * ring)
+{
+  if (!*ring)
+    return;
+
+  freeAligned(*ring);
+  *ring = NULL;
+}
+
+int audioring_getCount(const AudioRing ring)
+{
+  const uint32_t writePos = atomic_load(&ring->writePos);
+  const uint32_t readPos  = atomic_load(&ring->readPos);
+  return (int32_t)(writePos - readPos);
+}
+
+/* copies `count` frames in or out at `pos`, splitting the copy where it wraps
+ * around the end of the ring */
+static void copyIn(AudioRing ring, uint32_t pos, const uint8_t * src,
+    uint32_t count)
+{
+  const uint32_t index = pos & ring->mask;
+  const uint32_t back  = min(count, ring->frames - index);
+  const uint32_t front = count - back;
+  uint8_t * dst = ring->data + (size_t)index * ring->frameSize;
+
+  if (src)
+  {
+    memcpy(dst       , src, (size_t)back  * ring->frameSize);
+    memcpy(ring->data, src + (size_t)back * ring->frameSize,
+        (size_t)front * ring->frameSize);
+  }
+  else
+  {
+    memset(dst       , 0, (size_t)back  * ring->frameSize);
+    memset(ring->data, 0, (size_t)front * ring->frameSize);
+  }
+}
+
+static void copyOut(AudioRing ring, uint32_t pos, uint8_t * dst,
+    uint32_t count)
+{
+  const uint32_t index = pos & ring->mask;
+  const uint32_t back  = min(count, ring->frames - index);
+  const uint32_t front = count - back;
+
+  memcpy(dst, ring->data + (size_t)index * ring->frameSize,
+      (size_t)back * ring->frameSize);
+  memcpy(dst + (size_t)back * ring->frameSize, ring->data,
+      (size_t)front * ring->frameSize);
+}
+
+int audioring_append(AudioRing ring, const void * frames, int count)
+{
+  const uint32_t writePos =
+    atomic_load_explicit(&ring->writePos, memory_order_relaxed);
+
+  if (count <= 0)
+  {
+    atomic_store_explicit(&ring->writePos, writePos + count,
+        memory_order_release);
+    return count;
+  }
+
+  const uint32_t readPos =
+    atomic_load_explicit(&ring->readPos, memory_order_acquire);
+
+  const uint8_t * src    = frames;
+  uint32_t        pos    = writePos;
+  int32_t         offset = (int32_t)(pos - readPos);
+  uint32_t        left   = count;
+
+  // the reader has already played silence here, skip to stay in sync
+  if (offset < 0)
+  {
+    const uint32_t skip = min(left, (uint32_t)-offset);
+    if (src)
+      src += (size_t)skip * ring->frameSize;
+    pos    += skip;
+    left   -= skip;
+    offset += skip;
+  }
+
+  // frames past the capacity are dropped, the reader gets silence for them
+  if (left && (uint32_t)offset < ring->frames)
+    copyIn(ring, pos, src, min(left, ring->frames - (uint32_t)offset));
+
+  atomic_store_explicit(&ring->writePos, writePos + count,
+      memory_order_release);
+  return count;
+}
+
+int audioring_consume(AudioRing ring, void * frames, int count)
+{
+  const uint32_t readPos =
+    atomic_load_explicit(&ring->readPos, memory_order_relaxed);
+
+  if (count <= 0)
+  {
+    atomic_store_explicit(&ring->readPos, readPos + count,
+        memory_order_release);
+    return count;
+  }
+
+  if (frames)
+  {
+    const uint32_t writePos =
+      atomic_load_explicit(&ring->writePos, memory_order_acquire);
+
+    const int32_t  offset = (int32_t)(writePos - readPos);
+    const uint32_t avail  = offset > 0 ? min((uint32_t)offset, ring->frames) : 0;
+    const uint32_t len    = min((uint32_t)count, avail);
+
+    uint8_t * dst = frames;
+    copyOut(ring, readPos, dst, len);
+    memset(dst + (size_t)len * ring->frameSize, 0,
+        (size_t)(count - len) * ring->frameSize);
+  }
+
+  atomic_store_explicit(&ring->readPos, readPos + count,
+      memory_order_release);
+  return count;
+}
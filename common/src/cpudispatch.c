@@ -0,0 +1,226 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/cpudispatch.h"
+#include "common/cpuinfo.h"
+#include "common/debug.h"
+#include "common/array.h"
+#include "common/util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+
+static const CPUDispatchKernel * const kernels[] =
+{
+  &framebuffer_writeKernel,
+  &rectCopyUnalignedKernel,
+  &hdrconv_rgba16fToRGB10Kernel,
+  &sampleconv_s16ToFloatKernel,
+  &sampleconv_floatToS16Kernel
+};
+
+static const char * tierNames[CPU_TIER_MAX] =
+{
+  [CPU_TIER_C     ] = "c",
+  [CPU_TIER_SSE4_1] = "sse4.1",
+  [CPU_TIER_AVX   ] = "avx",
+  [CPU_TIER_AVX2  ] = "avx2",
+  [CPU_TIER_AVX512] = "avx512",
+  [CPU_TIER_NEON  ] = "neon"
+};
+
+#define TIER_UNSET -1
+static atomic_int activeTier = TIER_UNSET;
+
+const char * cpuDispatch_tierName(CPUTier tier)
+{
+  if (tier < 0 || tier >= CPU_TIER_MAX)
+    return "invalid";
+  return tierNames[tier];
+}
+
+bool cpuDispatch_tierSupported(CPUTier tier)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const CPUInfoFeatures * f = cpuInfo_getFeatures();
+#endif
+
+  switch(tier)
+  {
+    case CPU_TIER_C:
+      return true;
+
+#if defined(__x86_64__) || defined(__i386__)
+    case CPU_TIER_AVX512:
+      if (!f->avx512f || !f->avx512bw)
+        return false;
+      // fallthrough
+
+    case CPU_TIER_AVX2:
+      if (!f->avx2 || !f->fma || !f->f16c)
+        return false;
+      // fallthrough
+
+    case CPU_TIER_AVX:
+      if (!f->avx)
+        return false;
+      // fallthrough
+
+    case CPU_TIER_SSE4_1:
+      return f->sse4_1;
+#endif
+
+#if defined(__aarch64__)
+    // Advanced SIMD is mandatory on AArch64
+    case CPU_TIER_NEON:
+      return true;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+static CPUTier bestTier(void)
+{
+  for(int tier = CPU_TIER_MAX - 1; tier > CPU_TIER_C; --tier)
+    if (cpuDispatch_tierSupported(tier))
+      return tier;
+  return CPU_TIER_C;
+}
+
+static CPUTier initialTier(void)
+{
+  const CPUTier best = bestTier();
+
+  const char * env = getenv("LG_CPU_TIER");
+  if (!env || !*env)
+    return best;
+
+  for(int tier = 0; tier < CPU_TIER_MAX; ++tier)
+  {
+    if (strcasecmp(env, tierNames[tier]) != 0)
+      continue;
+
+    if (!cpuDispatch_tierSupported(tier))
+    {
+      DEBUG_WARN("LG_CPU_TIER=%s is not supported by this CPU, using %s",
+          env, tierNames[best]);
+      return best;
+    }
+
+    return tier;
+  }
+
+  DEBUG_WARN("Unknown LG_CPU_TIER=%s, using %s", env, tierNames[best]);
+  return best;
+}
+
+CPUTier cpuDispatch_getTier(void)
+{
+  int tier = atomic_load_explicit(&activeTier, memory_order_acquire);
+  if (likely(tier != TIER_UNSET))
+    return tier;
+
+  const int resolved = initialTier();
+  if (atomic_compare_exchange_strong(&activeTier, &tier, resolved))
+  {
+    DEBUG_INFO("CPU dispatch tier: %s", tierNames[resolved]);
+    return resolved;
+  }
+
+  // another thread resolved it first
+  return tier;
+}
+
+bool cpuDispatch_setTier(CPUTier tier)
+{
+  if (tier < 0 || tier >= CPU_TIER_MAX || !cpuDispatch_tierSupported(tier))
+  {
+    DEBUG_ERROR("CPU tier %s is not supported", cpuDispatch_tierName(tier));
+    return false;
+  }
+
+  atomic_store_explicit(&activeTier, tier, memory_order_release);
+  for(int i = 0; i < ARRAY_LENGTH(kernels); ++i)
+    kernels[i]->reset();
+
+  return true;
+}
+
+static bool tierAllowed(CPUTier impl, CPUTier active)
+{
+  if (impl == CPU_TIER_C || impl == active)
+    return true;
+
+  if (impl == CPU_TIER_NEON || active == CPU_TIER_NEON)
+    return false;
+
+  return impl < active;
+}
+
+CPUDispatchFn cpuDispatch_select(const CPUDispatchKernel * kernel)
+{
+  const CPUTier active = cpuDispatch_getTier();
+  const CPUDispatchImpl * best = NULL;
+
+  for(int i = 0; i < kernel->count; ++i)
+  {
+    const CPUDispatchImpl * impl = kernel->impls + i;
+    if (!tierAllowed(impl->tier, active))
+      continue;
+
+    if (!best || impl->tier > best->tier)
+      best = impl;
+  }
+
+  DEBUG_ASSERT(best);
+  return best->fn;
+}
+
+CPUDispatchFn cpuDispatch_getImpl(const CPUDispatchKernel * kernel,
+    CPUTier tier)
+{
+  if (!cpuDispatch_tierSupported(tier))
+    return NULL;
+
+  for(int i = 0; i < kernel->count; ++i)
+    if (kernel->impls[i].tier == tier)
+      return kernel->impls[i].fn;
+
+  return NULL;
+}
+
+const CPUDispatchKernel * cpuDispatch_findKernel(const char * name)
+{
+  for(int i = 0; i < ARRAY_LENGTH(kernels); ++i)
+    if (strcmp(kernels[i]->name, name) == 0)
+      return kernels[i];
+
+  return NULL;
+}
+
+const CPUDispatchKernel * const * cpuDispatch_getKernels(int * count)
+{
+  *count = ARRAY_LENGTH(kernels);
+  return kernels;
+}
@@ -47,6 +47,7 @@ const CPUInfoFeatures * cpuInfo_getFeatures(void)
   if (likely(initialized))
     return &features;
 
+#if defined(__x86_64__) || defined(__i386__)
   int cpuid[4] = {0};
 
   // leaf1
@@ -72,6 +73,7 @@ const CPUInfoFeatures * cpuInfo_getFeatures(void)
   features.xsave   = cpuid[2] & (1 << 26);
   features.osxsave = cpuid[2] & (1 << 27);
   features.avx     = cpuid[2] & (1 << 28);
+  features.f16c    = cpuid[2] & (1 << 29);
 
   // leaf7
   asm volatile
@@ -84,9 +86,11 @@ const CPUInfoFeatures * cpuInfo_getFeatures(void)
     : "a" (7), "c" (0)
   );
 
-  features.avx2 = cpuid[1] & (1 << 5);
-  features.bmi1 = cpuid[2] & (1 << 3);
-  features.bmi2 = cpuid[2] & (1 << 8);
+  features.avx2     = cpuid[1] & (1 <<  5);
+  features.bmi1     = cpuid[2] & (1 <<  3);
+  features.bmi2     = cpuid[2] & (1 <<  8);
+  features.avx512f  = cpuid[1] & (1 << 16);
+  features.avx512bw = cpuid[1] & (1 << 30);
 
   if (features.osxsave && features.avx)
   {
@@ -99,12 +103,30 @@ const CPUInfoFeatures * cpuInfo_getFeatures(void)
       : "edx"
     );
 
-    if (!(xgetbv & 0x6))
+    if ((xgetbv & 0x6) != 0x6)
     {
       features.avx  = false;
       features.avx2 = false;
+      features.f16c = false;
     }
+
+    // opmask, upper ZMM0-15 and ZMM16-31 state
+    if ((xgetbv & 0xE6) != 0xE6)
+    {
+      features.avx512f  = false;
+      features.avx512bw = false;
+    }
+  }
+  else
+  {
+    features.avx      = false;
+    features.avx2     = false;
+    features.f16c     = false;
+    features.avx512f  = false;
+    features.avx512bw = false;
   }
+#endif
 
+  initialized = true;
   return &features;
 };
@@ -19,18 +19,239 @@
  */
 
 #include "common/debug.h"
+#include "common/event.h"
+#include "common/thread.h"
+#include "common/util.h"
 
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
+
+/* messages are formatted by the caller into a shared ring and written out by
+ * a background thread, so a slow terminal or journal can not stall the thread
+ * that logged. The ring is a bounded multi producer, multi consumer queue
+ * where each slot carries a sequence number, the crash handler may drain it
+ * at the same time as the writer thread */
+
+#define LOG_RING_SIZE 1024
+#define LOG_SLOT_SIZE 240
+#define LOG_BATCH     16384
+
+struct LogSlot
+{
+  _Atomic(size_t) seq;
+  unsigned int    len;
+  char          * heap;
+  char            text[LOG_SLOT_SIZE];
+};
+
+static struct
+{
+  struct LogSlot  slots[LOG_RING_SIZE];
+  _Atomic(size_t) head;
+  _Atomic(size_t) tail;
+
+  atomic_bool     async;
+  atomic_bool     running;
+  atomic_bool     pending;
+  atomic_uint     dropped;
+  LGEvent       * event;
+  LGThread      * thread;
+}
+logRing;
 
 static uint64_t startTime;
 static bool     traceEnabled = false;
 
+static void debug_write(const char * text, size_t len)
+{
+  fwrite(text, 1, len, stderr);
+}
+
+static bool debug_push(const char * text, size_t len)
+{
+  struct LogSlot * slot;
+  size_t pos = atomic_load_explicit(&logRing.head, memory_order_relaxed);
+  for(;;)
+  {
+    slot = &logRing.slots[pos % LOG_RING_SIZE];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0)
+    {
+      if (atomic_compare_exchange_weak_explicit(&logRing.head, &pos, pos + 1,
+            memory_order_relaxed, memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = atomic_load_explicit(&logRing.head, memory_order_relaxed);
+  }
+
+  if (len < LOG_SLOT_SIZE)
+  {
+    memcpy(slot->text, text, len);
+    slot->heap = NULL;
+  }
+  else
+  {
+    // rare long messages such as extension lists are moved to the heap
+    slot->heap = malloc(len);
+    if (slot->heap)
+      memcpy(slot->heap, text, len);
+    else
+      len = 0;
+  }
+  slot->len = len;
+
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+  return true;
+}
+
+/* appends the next message to `buffer` if there is room, returns false once
+ * the ring is empty or the batch is full */
+static bool debug_pop(char * buffer, size_t * offset)
+{
+  struct LogSlot * slot;
+  size_t pos = atomic_load_explicit(&logRing.tail, memory_order_relaxed);
+  for(;;)
+  {
+    slot = &logRing.slots[pos % LOG_RING_SIZE];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff < 0)
+      return false;
+
+    if (diff == 0)
+    {
+      if (!slot->heap && *offset + slot->len > LOG_BATCH)
+        return false;
+
+      if (atomic_compare_exchange_weak_explicit(&logRing.tail, &pos, pos + 1,
+            memory_order_relaxed, memory_order_relaxed))
+        break;
+    }
+    else
+      pos = atomic_load_explicit(&logRing.tail, memory_order_relaxed);
+  }
+
+  if (slot->heap)
+  {
+    debug_write(buffer, *offset);
+    debug_write(slot->heap, slot->len);
+    free(slot->heap);
+    *offset = 0;
+  }
+  else
+  {
+    memcpy(buffer + *offset, slot->text, slot->len);
+    *offset += slot->len;
+  }
+
+  atomic_store_explicit(&slot->seq, pos + LOG_RING_SIZE, memory_order_release);
+  return true;
+}
+
+static void debug_drain(char * buffer)
+{
+  size_t offset = 0;
+
+  for(;;)
+  {
+    if (!debug_pop(buffer, &offset))
+    {
+      if (offset == 0)
+        break;
+
+      debug_write(buffer, offset);
+      offset = 0;
+    }
+  }
+
+  unsigned int dropped = atomic_exchange(&logRing.dropped, 0);
+  if (dropped)
+    fprintf(stderr, "%s%u log messages were dropped%s\n",
+        debug_lookup[DEBUG_LEVEL_WARN], dropped,
+        debug_lookup[DEBUG_LEVEL_NONE]);
+
+  fflush(stderr);
+}
+
+static int debug_writerThread(void * opaque)
+{
+  static char buffer[LOG_BATCH];
+  while(atomic_load(&logRing.running))
+  {
+    /* producers only signal when they set the pending flag, and the flush
+     * signals after clearing running, so there is no need to poll */
+    lgWaitEvent(logRing.event, TIMEOUT_INFINITE);
+    atomic_exchange(&logRing.pending, false);
+    debug_drain(buffer);
+  }
+
+  // catch anything pushed while the ring was being switched off
+  debug_drain(buffer);
+  return 0;
+}
+
+static void debug_atexit(void)
+{
+  debug_flush();
+  lgJoinThread(logRing.thread, NULL);
+  logRing.thread = NULL;
+}
+
 void debug_init(void)
 {
   startTime = microtime();
   platform_debugInit();
+
+  if (logRing.event)
+    return;
+
+  for(size_t i = 0; i < LOG_RING_SIZE; ++i)
+    atomic_init(&logRing.slots[i].seq, i);
+
+  logRing.event = lgCreateEvent(true, 0);
+  if (!logRing.event)
+    return;
+
+  atomic_store(&logRing.running, true);
+  if (!lgCreateThread("LogWriter", debug_writerThread, NULL, &logRing.thread))
+  {
+    atomic_store(&logRing.running, false);
+    return;
+  }
+
+  atomic_store(&logRing.async, true);
+  atexit(debug_atexit);
+}
+
+void debug_flush(void)
+{
+  // anything logged after this point is written directly
+  if (!atomic_exchange(&logRing.async, false))
+    return;
+  atomic_thread_fence(memory_order_seq_cst);
+
+  /* the writer thread is not waited on as this may be called from a crash
+   * handler, the ring is safe to drain from both threads at once */
+  atomic_store(&logRing.running, false);
+  lgSignalEvent(logRing.event);
+
+  static char buffer[LOG_BATCH];
+  debug_drain(buffer);
+}
+
+/* a producer that saw async set may still be pushing when debug_flush clears
+ * it and performs its final drain, if that drain may have missed the message
+ * the producer drains the ring itself */
+static void debug_lateDrain(void)
+{
+  char buffer[LOG_BATCH];
+  debug_drain(buffer);
 }
 
 void debug_enableTracing(void)
@@ -38,6 +259,23 @@ void debug_enableTracing(void)
   traceEnabled = true;
 }
 
+bool debug_rateLimit(struct DebugRateLimit * limit, unsigned int interval,
+    unsigned int * suppressed)
+{
+  const uint64_t now  = microtime();
+  uint64_t       next = atomic_load_explicit(&limit->next, memory_order_relaxed);
+
+  if (now < next || !atomic_compare_exchange_strong(&limit->next, &next,
+        now + (uint64_t)interval * 1000ULL))
+  {
+    atomic_fetch_add_explicit(&limit->suppressed, 1, memory_order_relaxed);
+    return false;
+  }
+
+  *suppressed = atomic_exchange(&limit->suppressed, 0);
+  return true;
+}
+
 inline static void debug_levelVA(enum DebugLevel level, const char * file,
     unsigned int line, const char * function, const char * format, va_list va)
 {
@@ -54,7 +292,12 @@ inline static void debug_levelVA(enum DebugLevel level, const char * file,
   uint64_t sec     = elapsed / 1000000UL;
   uint64_t us      = elapsed % 1000000UL;
 
-  fprintf(stderr, "%02u:%02u:%02u.%03u %s %18s:%-4u | %-30s | ",
+  char   stack[1024];
+  char * text = stack;
+  int    len;
+
+  int prefix = snprintf(stack, sizeof(stack),
+      "%02u:%02u:%02u.%03u %s %18s:%-4u | %-30s | ",
       (unsigned)(sec / 60 / 60),
       (unsigned)(sec / 60 % 60),
       (unsigned)(sec % 60),
@@ -62,9 +305,53 @@ inline static void debug_levelVA(enum DebugLevel level, const char * file,
       debug_lookup[level],
       f,
       line, function);
+  if (prefix < 0)
+    return;
+  prefix = min(prefix, (int)sizeof(stack) - 1);
+
+  va_list copy;
+  va_copy(copy, va);
+  int msg = vsnprintf(stack + prefix, sizeof(stack) - prefix, format, copy);
+  va_end(copy);
+  if (msg < 0)
+    return;
+
+  const char * reset    = debug_lookup[DEBUG_LEVEL_NONE];
+  const int    resetLen = strlen(reset);
+  len = prefix + msg + resetLen + 1;
+
+  if ((size_t)len >= sizeof(stack))
+  {
+    text = malloc(len + 1);
+    if (!text)
+      return;
+
+    memcpy(text, stack, prefix);
+    vsnprintf(text + prefix, len + 1 - prefix, format, va);
+  }
+
+  memcpy(text + prefix + msg, reset, resetLen);
+  text[len - 1] = '\n';
+
+  if (level == DEBUG_LEVEL_FATAL)
+    debug_flush();
+
+  if (!atomic_load_explicit(&logRing.async, memory_order_acquire))
+    debug_write(text, len);
+  else if (!debug_push(text, len))
+    atomic_fetch_add_explicit(&logRing.dropped, 1, memory_order_relaxed);
+  else
+  {
+    // pairs with the fence in debug_flush
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&logRing.async, memory_order_relaxed))
+      debug_lateDrain();
+    else if (!atomic_exchange(&logRing.pending, true))
+      lgSignalEvent(logRing.event);
+  }
 
-  vfprintf(stderr, format, va);
-  fprintf(stderr, "%s\n", debug_lookup[DEBUG_LEVEL_NONE]);
+  if (text != stack)
+    free(text);
 }
 
 
@@ -19,19 +19,46 @@
  */
 
 #include "common/framebuffer.h"
-#include "common/cpuinfo.h"
+#include "common/cpudispatch.h"
 #include "common/debug.h"
-
-//#define FB_PROFILE
-#ifdef FB_PROFILE
-#include "common/runningavg.h"
-#endif
+#include "common/metrics.h"
+#include "common/time.h"
+#include "common/array.h"
 
 #include <string.h>
-#include <emmintrin.h>
-#include <smmintrin.h>
-#include <immintrin.h>
 #include <unistd.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static _Atomic(LGMetric *) readMetric  = NULL;
+static _Atomic(LGMetric *) writeMetric = NULL;
+
+static void observeRead(uint64_t start)
+{
+  LGMetric * m = atomic_load_explicit(&readMetric, memory_order_relaxed);
+  if (!m)
+  {
+    m = metrics_histogram("lg_framebuffer_read_seconds",
+        "Time taken to read a frame out of a framebuffer");
+    atomic_store_explicit(&readMetric, m, memory_order_relaxed);
+  }
+  metrics_observe(m, nanotime() - start);
+}
+
+static void observeWrite(uint64_t start)
+{
+  LGMetric * m = atomic_load_explicit(&writeMetric, memory_order_relaxed);
+  if (!m)
+  {
+    m = metrics_histogram("lg_framebuffer_write_seconds",
+        "Time taken to write a frame into a framebuffer");
+    atomic_store_explicit(&writeMetric, m, memory_order_relaxed);
+  }
+  metrics_observe(m, nanotime() - start);
+}
 
 bool framebuffer_wait(const FrameBuffer * frame, size_t size)
 {
@@ -52,13 +79,7 @@ bool framebuffer_wait(const FrameBuffer * frame, size_t size)
 bool framebuffer_read_linear(const FrameBuffer * frame, void * restrict dst,
     size_t size)
 {
-#ifdef FB_PROFILE
-  static RunningAvg ra = NULL;
-  static int raCount = 0;
-  const uint64_t ts = microtime();
-  if (!ra)
-    ra = runningavg_new(100);
-#endif
+  const uint64_t ts = nanotime();
 
   uint8_t * restrict d     = (uint8_t*)dst;
   uint_least32_t rp        = 0;
@@ -76,11 +97,7 @@ bool framebuffer_read_linear(const FrameBuffer * frame, void * restrict dst,
     d    += copy;
   }
 
-#ifdef FB_PROFILE
-  runningavg_push(ra, microtime() - ts);
-  if (++raCount % 100 == 0)
-    DEBUG_INFO("Average Copy Time: %.2fμs", runningavg_calc(ra));
-#endif
+  observeRead(ts);
 
   return true;
 }
@@ -91,13 +108,7 @@ bool framebuffer_read(const FrameBuffer * frame, void * restrict dst,
   if (dstpitch == pitch)
     return framebuffer_read_linear(frame, dst, height * pitch);
 
-#ifdef FB_PROFILE
-  static RunningAvg ra = NULL;
-  static int raCount = 0;
-  const uint64_t ts = microtime();
-  if (!ra)
-    ra = runningavg_new(100);
-#endif
+  const uint64_t ts = nanotime();
 
   uint8_t * restrict d     = (uint8_t*)dst;
   uint_least32_t rp        = 0;
@@ -114,11 +125,7 @@ bool framebuffer_read(const FrameBuffer * frame, void * restrict dst,
     d  += dstpitch;
   }
 
-#ifdef FB_PROFILE
-  runningavg_push(ra, microtime() - ts);
-  if (++raCount % 100 == 0)
-    DEBUG_INFO("Average Copy Time: %.2fμs", runningavg_calc(ra));
-#endif
+  observeRead(ts);
 
   return true;
 }
@@ -126,13 +133,7 @@ bool framebuffer_read(const FrameBuffer * frame, void * restrict dst,
 bool framebuffer_read_fn(const FrameBuffer * frame, size_t height, size_t width,
     size_t bpp, size_t pitch, FrameBufferReadFn fn, void * opaque)
 {
-#ifdef FB_PROFILE
-  static RunningAvg ra = NULL;
-  static int raCount = 0;
-  const uint64_t ts = microtime();
-  if (!ra)
-    ra = runningavg_new(100);
-#endif
+  const uint64_t ts = nanotime();
 
   uint_least32_t rp        = 0;
   size_t         y         = 0;
@@ -150,11 +151,7 @@ bool framebuffer_read_fn(const FrameBuffer * frame, size_t height, size_t width,
     ++y;
   }
 
-#ifdef FB_PROFILE
-  runningavg_push(ra, microtime() - ts);
-  if (++raCount % 100 == 0)
-    DEBUG_INFO("Average Copy Time: %.2fμs", runningavg_calc(ra));
-#endif
+  observeRead(ts);
 
   return true;
 }
@@ -167,16 +164,41 @@ void framebuffer_prepare(FrameBuffer * frame)
   atomic_store_explicit(&frame->wp, 0, memory_order_release);
 }
 
-static bool framebuffer_write_sse4_1(FrameBuffer * frame,
+static bool framebuffer_write_c(FrameBuffer * frame,
     const void * restrict src, size_t size)
 {
-#ifdef FB_PROFILE
-  static RunningAvg ra = NULL;
-  static int raCount = 0;
-  const uint64_t ts = microtime();
-  if (!ra)
-    ra = runningavg_new(100);
+  const uint64_t ts = nanotime();
+
+  const uint8_t * restrict s = (const uint8_t *)src;
+  size_t wp = 0;
+
+  /* copy in chunks */
+  while(size)
+  {
+    const size_t copy = size < FB_CHUNK_SIZE ? size : FB_CHUNK_SIZE;
+    memcpy(frame->data + wp, s + wp, copy);
+
+    size -= copy;
+    wp   += copy;
+    atomic_store_explicit(&frame->wp, wp, memory_order_release);
+  }
+
+  observeWrite(ts);
+
+  return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("sse4.1")
 #endif
+static bool framebuffer_write_sse4_1(FrameBuffer * frame,
+    const void * restrict src, size_t size)
+{
+  const uint64_t ts = nanotime();
 
   __m128i * restrict s = (__m128i *)src;
   __m128i * restrict d = (__m128i *)frame->data;
@@ -216,14 +238,15 @@ static bool framebuffer_write_sse4_1(FrameBuffer * frame,
 
   atomic_store_explicit(&frame->wp, wp, memory_order_release);
 
-#ifdef FB_PROFILE
-  runningavg_push(ra, microtime() - ts);
-  if (++raCount % 100 == 0)
-    DEBUG_INFO("Average Copy Time: %.2fμs", runningavg_calc(ra));
-#endif
+  observeWrite(ts);
 
   return true;
 }
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
 
 #ifdef __clang__
   #pragma clang attribute push (__attribute__((target("avx2"))), apply_to=function)
@@ -231,16 +254,10 @@ static bool framebuffer_write_sse4_1(FrameBuffer * frame,
   #pragma GCC push_options
   #pragma GCC target ("avx2")
 #endif
-bool framebuffer_write_avx2(FrameBuffer * frame,
+static bool framebuffer_write_avx2(FrameBuffer * frame,
     const void * restrict src, size_t size)
 {
-#ifdef FB_PROFILE
-    static RunningAvg ra = NULL;
-    static int raCount = 0;
-    const uint64_t ts = microtime();
-    if (!ra)
-        ra = runningavg_new(100);
-#endif
+  const uint64_t ts = nanotime();
 
   __m256i *restrict s = (__m256i *)src;
   __m256i *restrict d = (__m256i *)frame->data;
@@ -295,11 +312,80 @@ bool framebuffer_write_avx2(FrameBuffer * frame,
 
   atomic_store_explicit(&frame->wp, wp, memory_order_release);
 
-#ifdef FB_PROFILE
-  runningavg_push(ra, microtime() - ts);
-  if (++raCount % 100 == 0)
-    DEBUG_INFO("Average Copy Time: %.2fμs", runningavg_calc(ra));
+  observeWrite(ts);
+
+  return true;
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx512f,avx512bw,avx2"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx512f,avx512bw,avx2")
 #endif
+static bool framebuffer_write_avx512(FrameBuffer * frame,
+    const void * restrict src, size_t size)
+{
+  // the streaming loads and stores need 64 byte alignment
+  if (((uintptr_t)src | (uintptr_t)frame->data) & 63)
+    return framebuffer_write_avx2(frame, src, size);
+
+  const uint64_t ts = nanotime();
+
+  __m512i *restrict s = (__m512i *)src;
+  __m512i *restrict d = (__m512i *)frame->data;
+  size_t wp = 0;
+
+  _mm_mfence();
+
+  /* copy in chunks */
+  while (size > 255)
+  {
+    __m512i v1 = _mm512_stream_load_si512(s + 0);
+    __m512i v2 = _mm512_stream_load_si512(s + 1);
+    __m512i v3 = _mm512_stream_load_si512(s + 2);
+    __m512i v4 = _mm512_stream_load_si512(s + 3);
+
+    _mm512_stream_si512(d + 0, v1);
+    _mm512_stream_si512(d + 1, v2);
+    _mm512_stream_si512(d + 2, v3);
+    _mm512_stream_si512(d + 3, v4);
+
+    s    += 4;
+    d    += 4;
+    size -= 256;
+    wp   += 256;
+
+    if (wp % FB_CHUNK_SIZE == 0)
+    {
+      // the streaming stores are weakly ordered
+      _mm_sfence();
+      atomic_store_explicit(&frame->wp, wp, memory_order_release);
+    }
+  }
+
+  for(; size > 63; ++s, ++d)
+  {
+    _mm512_stream_si512(d, _mm512_stream_load_si512(s));
+    size -= 64;
+    wp   += 64;
+  }
+
+  if (size)
+  {
+    memcpy(frame->data + wp, s, size);
+    wp += size;
+  }
+
+  _mm_sfence();
+  atomic_store_explicit(&frame->wp, wp, memory_order_release);
+
+  observeWrite(ts);
 
   return true;
 }
@@ -308,14 +394,23 @@ bool framebuffer_write_avx2(FrameBuffer * frame,
 #else
   #pragma GCC pop_options
 #endif
+#endif
+
+static const CPUDispatchImpl framebuffer_writeImpls[] =
+{
+  CPU_DISPATCH_IMPL(CPU_TIER_C     , framebuffer_write_c     ),
+#if defined(__x86_64__) || defined(__i386__)
+  CPU_DISPATCH_IMPL(CPU_TIER_SSE4_1, framebuffer_write_sse4_1),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX2  , framebuffer_write_avx2  ),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX512, framebuffer_write_avx512),
+#endif
+};
 
 static bool _framebuffer_write(FrameBuffer * frame,
     const void * restrict src, size_t size)
 {
-  if (cpuInfo_getFeatures()->avx2)
-    framebuffer_write = &framebuffer_write_avx2;
-  else
-    framebuffer_write = &framebuffer_write_sse4_1;
+  framebuffer_write = (__typeof__(framebuffer_write))
+    cpuDispatch_select(&framebuffer_writeKernel);
 
   return framebuffer_write(frame, src, size);
 }
@@ -323,6 +418,19 @@ static bool _framebuffer_write(FrameBuffer * frame,
 bool (*framebuffer_write)(FrameBuffer * frame,
   const void * restrict src, size_t size) = &_framebuffer_write;
 
+static void framebuffer_writeReset(void)
+{
+  framebuffer_write = &_framebuffer_write;
+}
+
+const CPUDispatchKernel framebuffer_writeKernel =
+{
+  .name  = "framebuffer_write",
+  .impls = framebuffer_writeImpls,
+  .count = ARRAY_LENGTH(framebuffer_writeImpls),
+  .reset = framebuffer_writeReset
+};
+
 const uint8_t * framebuffer_get_buffer(const FrameBuffer * frame)
 {
   return frame->data;
@@ -0,0 +1,459 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/hdrconv.h"
+#include "common/array.h"
+#include "common/cpudispatch.h"
+
+#include <math.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// scRGB 1.0 is 80 nits, PQ 1.0 is 10000 nits
+#define SCRGB_TO_PQ (80.0f / 10000.0f)
+
+// PQ constants (SMPTE ST 2084)
+#define PQ_M1 (2610.0f / 16384.0f)
+#define PQ_M2 (2523.0f / 4096.0f * 128.0f)
+#define PQ_C1 (3424.0f / 4096.0f)
+#define PQ_C2 (2413.0f / 4096.0f * 32.0f)
+#define PQ_C3 (2392.0f / 4096.0f * 32.0f)
+
+// linear BT.709 to BT.2020 primaries
+static const float bt709to2020[3][3] =
+{
+  { 0.6274f, 0.3293f, 0.0433f },
+  { 0.0691f, 0.9195f, 0.0114f },
+  { 0.0164f, 0.0880f, 0.8956f }
+};
+
+// the alpha channel is always opaque
+#define RGB10_ALPHA 0xC0000000U
+
+static inline float halfToFloat(uint16_t h)
+{
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  const uint32_t exp  = (h >> 10) & 0x1F;
+  const uint32_t mant = h & 0x3FF;
+
+  union { uint32_t u; float f; } v;
+  if (exp == 0)
+  {
+    // zero or subnormal, mant * 2^-24
+    const float f = mant * (1.0f / 16777216.0f);
+    return sign ? -f : f;
+  }
+  else if (exp == 31)
+    v.u = sign | 0x7F800000 | (mant << 13);
+  else
+    v.u = sign | ((exp + 112) << 23) | (mant << 13);
+
+  return v.f;
+}
+
+static inline float pqEncode(float y)
+{
+  const float ym = powf(y, PQ_M1);
+  return powf((PQ_C1 + PQ_C2 * ym) / (1.0f + PQ_C3 * ym), PQ_M2);
+}
+
+static inline uint32_t toUNorm10(float v)
+{
+  // written so that NaN ends up as zero
+  if (!(v > 0.0f))
+    return 0;
+  if (v >= 1.0f)
+    return 1023;
+  return (uint32_t)(v * 1023.0f + 0.5f);
+}
+
+static void hdrconv_rgba16fToRGB10_c(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq)
+{
+  const float scale = pq ? SCRGB_TO_PQ : 1.0f;
+  for(size_t i = 0; i < count; ++i, src += 4)
+  {
+    const float r = halfToFloat(src[0]);
+    const float g = halfToFloat(src[1]);
+    const float b = halfToFloat(src[2]);
+
+    uint32_t out = RGB10_ALPHA;
+    for(int c = 0; c < 3; ++c)
+    {
+      float v = (
+        bt709to2020[c][0] * r +
+        bt709to2020[c][1] * g +
+        bt709to2020[c][2] * b) * scale;
+
+      if (pq)
+        v = v > 0.0f ? pqEncode(fminf(v, 1.0f)) : 0.0f;
+
+      out |= toUNorm10(v) << (c * 10);
+    }
+
+    dst[i] = out;
+  }
+}
+
+/* PQ encoded output indexed by the half float bits of the normalized linear
+ * input, inputs are clamped to [0, 1] (0x0000 - 0x3C00) before the lookup. The
+ * extra entry allows the gather to read 32 bits at the last index. */
+#define PQ_LUT_SIZE (0x3C00 + 2)
+static uint16_t pqLUT[PQ_LUT_SIZE];
+
+enum
+{
+  PQ_LUT_EMPTY,
+  PQ_LUT_BUILDING,
+  PQ_LUT_READY
+};
+static atomic_int pqLUTState = PQ_LUT_EMPTY;
+
+/* fills the table once, any other caller waits until it is complete */
+static void buildPQLUT(void)
+{
+  int state = PQ_LUT_EMPTY;
+  if (atomic_compare_exchange_strong(&pqLUTState, &state, PQ_LUT_BUILDING))
+  {
+    for(uint32_t h = 0; h <= 0x3C00; ++h)
+      pqLUT[h] = toUNorm10(pqEncode(halfToFloat(h)));
+    pqLUT[PQ_LUT_SIZE - 1] = 0;
+
+    atomic_store_explicit(&pqLUTState, PQ_LUT_READY, memory_order_release);
+    return;
+  }
+
+  while(atomic_load_explicit(&pqLUTState, memory_order_acquire) !=
+      PQ_LUT_READY) {}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx2,fma,f16c"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx2,fma,f16c")
+#endif
+/* converts two pixels into the low 32 bits of each 128-bit lane */
+static inline __m256i convert2(__m128i halfs, const __m256 m[3],
+    const __m256 scale, bool pq)
+{
+  const __m256 zero  = _mm256_setzero_ps();
+  const __m256 one   = _mm256_set1_ps(1.0f);
+  const __m256i mask = _mm256_set1_epi32(0x3FF);
+  const __m256i shl  = _mm256_setr_epi32(0, 10, 20, 0, 0, 10, 20, 0);
+
+  const __m256 v = _mm256_cvtph_ps(halfs);
+  const __m256 r = _mm256_permute_ps(v, 0x00);
+  const __m256 g = _mm256_permute_ps(v, 0x55);
+  const __m256 b = _mm256_permute_ps(v, 0xAA);
+
+  __m256 o = _mm256_mul_ps(r, m[0]);
+  o = _mm256_fmadd_ps(g, m[1], o);
+  o = _mm256_fmadd_ps(b, m[2], o);
+  o = _mm256_mul_ps(o, scale);
+
+  // max first so NaN becomes zero
+  o = _mm256_min_ps(_mm256_max_ps(o, zero), one);
+
+  __m256i q;
+  if (pq)
+  {
+    const __m256i idx = _mm256_cvtepu16_epi32(
+        _mm256_cvtps_ph(o, _MM_FROUND_TO_NEAREST_INT));
+    q = _mm256_and_si256(
+        _mm256_i32gather_epi32((const int *)pqLUT, idx, 2), mask);
+  }
+  else
+    q = _mm256_cvtps_epi32(_mm256_mul_ps(o, _mm256_set1_ps(1023.0f)));
+
+  // pack R, G & B of each pixel into every lane of its 128-bit half
+  q = _mm256_sllv_epi32(q, shl);
+  q = _mm256_or_si256(q, _mm256_shuffle_epi32(q, _MM_SHUFFLE(2, 3, 0, 1)));
+  q = _mm256_or_si256(q, _mm256_shuffle_epi32(q, _MM_SHUFFLE(1, 0, 3, 2)));
+  return q;
+}
+
+static void hdrconv_rgba16fToRGB10_avx2(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq)
+{
+  // matrix columns with zero in the alpha slot
+  const __m256 m[3] =
+  {
+    _mm256_setr_ps(
+      bt709to2020[0][0], bt709to2020[1][0], bt709to2020[2][0], 0.0f,
+      bt709to2020[0][0], bt709to2020[1][0], bt709to2020[2][0], 0.0f),
+    _mm256_setr_ps(
+      bt709to2020[0][1], bt709to2020[1][1], bt709to2020[2][1], 0.0f,
+      bt709to2020[0][1], bt709to2020[1][1], bt709to2020[2][1], 0.0f),
+    _mm256_setr_ps(
+      bt709to2020[0][2], bt709to2020[1][2], bt709to2020[2][2], 0.0f,
+      bt709to2020[0][2], bt709to2020[1][2], bt709to2020[2][2], 0.0f)
+  };
+
+  const __m256  scale = _mm256_set1_ps(pq ? SCRGB_TO_PQ : 1.0f);
+  const __m256i alpha = _mm256_set1_epi32((int)RGB10_ALPHA);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  size_t i = 0;
+  for(; i + 8 <= count; i += 8, src += 32)
+  {
+    const __m128i * s = (const __m128i *)src;
+    const __m256i p01 = convert2(_mm_loadu_si128(s + 0), m, scale, pq);
+    const __m256i p23 = convert2(_mm_loadu_si128(s + 1), m, scale, pq);
+    const __m256i p45 = convert2(_mm_loadu_si128(s + 2), m, scale, pq);
+    const __m256i p67 = convert2(_mm_loadu_si128(s + 3), m, scale, pq);
+
+    // [p0 p2 p4 p6 | p1 p3 p5 p7] then restore the pixel order
+    __m256i out = _mm256_blend_epi32(p01, p23, 0x22);
+    out = _mm256_blend_epi32(out, p45, 0x44);
+    out = _mm256_blend_epi32(out, p67, 0x88);
+    out = _mm256_permutevar8x32_epi32(out, order);
+    out = _mm256_or_si256(out, alpha);
+
+    _mm256_storeu_si256((__m256i *)(dst + i), out);
+  }
+
+  hdrconv_rgba16fToRGB10_c(src, dst + i, count - i, pq);
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx512f,avx512bw,avx2,fma,f16c"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx512f,avx512bw,avx2,fma,f16c")
+#endif
+/* converts four pixels into every 32 bits of each 128-bit lane */
+static inline __m512i convert4(__m256i halfs, const __m512 m[3],
+    const __m512 scale, bool pq)
+{
+  const __m512 zero  = _mm512_setzero_ps();
+  const __m512 one   = _mm512_set1_ps(1.0f);
+  const __m512i mask = _mm512_set1_epi32(0x3FF);
+  const __m512i shl  = _mm512_set4_epi32(0, 20, 10, 0);
+
+  const __m512 v = _mm512_cvtph_ps(halfs);
+  const __m512 r = _mm512_permute_ps(v, 0x00);
+  const __m512 g = _mm512_permute_ps(v, 0x55);
+  const __m512 b = _mm512_permute_ps(v, 0xAA);
+
+  __m512 o = _mm512_mul_ps(r, m[0]);
+  o = _mm512_fmadd_ps(g, m[1], o);
+  o = _mm512_fmadd_ps(b, m[2], o);
+  o = _mm512_mul_ps(o, scale);
+
+  // max first so NaN becomes zero
+  o = _mm512_min_ps(_mm512_max_ps(o, zero), one);
+
+  __m512i q;
+  if (pq)
+  {
+    const __m512i idx = _mm512_cvtepu16_epi32(
+        _mm512_cvtps_ph(o, _MM_FROUND_TO_NEAREST_INT));
+    q = _mm512_and_si512(
+        _mm512_i32gather_epi32(idx, (const int *)pqLUT, 2), mask);
+  }
+  else
+    q = _mm512_cvtps_epi32(_mm512_mul_ps(o, _mm512_set1_ps(1023.0f)));
+
+  q = _mm512_sllv_epi32(q, shl);
+  q = _mm512_or_si512(q, _mm512_shuffle_epi32(q, _MM_PERM_CDAB));
+  q = _mm512_or_si512(q, _mm512_shuffle_epi32(q, _MM_PERM_BADC));
+  return q;
+}
+
+static void hdrconv_rgba16fToRGB10_avx512(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq)
+{
+  const __m512 m[3] =
+  {
+    _mm512_set4_ps(0.0f,
+      bt709to2020[2][0], bt709to2020[1][0], bt709to2020[0][0]),
+    _mm512_set4_ps(0.0f,
+      bt709to2020[2][1], bt709to2020[1][1], bt709to2020[0][1]),
+    _mm512_set4_ps(0.0f,
+      bt709to2020[2][2], bt709to2020[1][2], bt709to2020[0][2])
+  };
+
+  const __m512  scale = _mm512_set1_ps(pq ? SCRGB_TO_PQ : 1.0f);
+  const __m512i alpha = _mm512_set1_epi32((int)RGB10_ALPHA);
+  const __m512i order = _mm512_setr_epi32(
+      0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+  size_t i = 0;
+  for(; i + 16 <= count; i += 16, src += 64)
+  {
+    const __m256i * s = (const __m256i *)src;
+    const __m512i p0 = convert4(_mm256_loadu_si256(s + 0), m, scale, pq);
+    const __m512i p1 = convert4(_mm256_loadu_si256(s + 1), m, scale, pq);
+    const __m512i p2 = convert4(_mm256_loadu_si256(s + 2), m, scale, pq);
+    const __m512i p3 = convert4(_mm256_loadu_si256(s + 3), m, scale, pq);
+
+    // lane k holds pixels k, k + 4, k + 8 & k + 12, then restore the order
+    __m512i out = _mm512_mask_blend_epi32(0x2222, p0, p1);
+    out = _mm512_mask_blend_epi32(0x4444, out, p2);
+    out = _mm512_mask_blend_epi32(0x8888, out, p3);
+    out = _mm512_permutexvar_epi32(order, out);
+    out = _mm512_or_si512(out, alpha);
+
+    _mm512_storeu_si512(dst + i, out);
+  }
+
+  hdrconv_rgba16fToRGB10_avx2(src, dst + i, count - i, pq);
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+#endif
+
+#if defined(__aarch64__)
+static void hdrconv_rgba16fToRGB10_neon(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq)
+{
+  const float32x4_t zero  = vdupq_n_f32(0.0f);
+  const float32x4_t one   = vdupq_n_f32(1.0f);
+  const float32x4_t scale = vdupq_n_f32(pq ? SCRGB_TO_PQ : 1.0f);
+
+  size_t i = 0;
+  for(; i + 4 <= count; i += 4, src += 16)
+  {
+    // deinterleave four pixels into R, G, B & A vectors
+    const uint16x4x4_t p = vld4_u16(src);
+    const float32x4_t r = vcvt_f32_f16(vreinterpret_f16_u16(p.val[0]));
+    const float32x4_t g = vcvt_f32_f16(vreinterpret_f16_u16(p.val[1]));
+    const float32x4_t b = vcvt_f32_f16(vreinterpret_f16_u16(p.val[2]));
+
+    uint32x4_t out = vdupq_n_u32(RGB10_ALPHA);
+    for(int c = 0; c < 3; ++c)
+    {
+      float32x4_t o = vmulq_n_f32(r, bt709to2020[c][0]);
+      o = vfmaq_n_f32(o, g, bt709to2020[c][1]);
+      o = vfmaq_n_f32(o, b, bt709to2020[c][2]);
+      o = vmulq_f32(o, scale);
+
+      // the NM variants return the number if either operand is NaN
+      o = vminnmq_f32(vmaxnmq_f32(o, zero), one);
+
+      uint32x4_t q;
+      if (pq)
+      {
+        uint16_t h[4];
+        vst1_u16(h, vreinterpret_u16_f16(vcvt_f16_f32(o)));
+
+        const uint32_t l[4] =
+          { pqLUT[h[0]], pqLUT[h[1]], pqLUT[h[2]], pqLUT[h[3]] };
+        q = vld1q_u32(l);
+      }
+      else
+        q = vcvtnq_u32_f32(vmulq_n_f32(o, 1023.0f));
+
+      out = vorrq_u32(out, vshlq_u32(q, vdupq_n_s32(c * 10)));
+    }
+
+    vst1q_u32(dst + i, out);
+  }
+
+  hdrconv_rgba16fToRGB10_c(src, dst + i, count - i, pq);
+}
+#endif
+
+static const CPUDispatchImpl hdrconv_rgba16fToRGB10Impls[] =
+{
+  CPU_DISPATCH_IMPL(CPU_TIER_C     , hdrconv_rgba16fToRGB10_c     ),
+#if defined(__x86_64__) || defined(__i386__)
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX2  , hdrconv_rgba16fToRGB10_avx2  ),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX512, hdrconv_rgba16fToRGB10_avx512),
+#elif defined(__aarch64__)
+  CPU_DISPATCH_IMPL(CPU_TIER_NEON  , hdrconv_rgba16fToRGB10_neon  ),
+#endif
+};
+
+static void _hdrconv_rgba16fToRGB10(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq)
+{
+  __typeof__(hdrconv_rgba16fToRGB10) fn = (__typeof__(fn))
+    cpuDispatch_select(&hdrconv_rgba16fToRGB10Kernel);
+
+  /* the SIMD implementations look up the PQ encoding, the table must be
+   * complete before other callers can reach them through the pointer */
+  if (fn != &hdrconv_rgba16fToRGB10_c)
+    buildPQLUT();
+
+  atomic_thread_fence(memory_order_release);
+  hdrconv_rgba16fToRGB10 = fn;
+  fn(src, dst, count, pq);
+}
+
+void (*hdrconv_rgba16fToRGB10)(const uint16_t * restrict src,
+    uint32_t * restrict dst, size_t count, bool pq) =
+  &_hdrconv_rgba16fToRGB10;
+
+static void hdrconv_rgba16fToRGB10Reset(void)
+{
+  hdrconv_rgba16fToRGB10 = &_hdrconv_rgba16fToRGB10;
+}
+
+const CPUDispatchKernel hdrconv_rgba16fToRGB10Kernel =
+{
+  .name  = "hdrconv_rgba16fToRGB10",
+  .impls = hdrconv_rgba16fToRGB10Impls,
+  .count = ARRAY_LENGTH(hdrconv_rgba16fToRGB10Impls),
+  .reset = hdrconv_rgba16fToRGB10Reset
+};
+
+bool hdrconv_writeFrame(FrameBuffer * frame, const void * restrict src,
+    size_t srcPitch, size_t width, size_t height, bool pq)
+{
+  uint8_t       * dst      = framebuffer_get_data(frame);
+  const uint8_t * s        = (const uint8_t *)src;
+  const size_t    dstPitch = width * 4;
+  size_t          wp       = 0;
+  size_t          lastWP   = 0;
+
+  for(size_t y = 0; y < height; ++y)
+  {
+    hdrconv_rgba16fToRGB10((const uint16_t *)s, (uint32_t *)(dst + wp),
+        width, pq);
+
+    s  += srcPitch;
+    wp += dstPitch;
+
+    if (wp - lastWP >= FB_CHUNK_SIZE)
+    {
+      framebuffer_set_write_ptr(frame, wp);
+      lastWP = wp;
+    }
+  }
+
+  framebuffer_set_write_ptr(frame, wp);
+  return true;
+}
@@ -0,0 +1,149 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/locking.h"
+
+#ifdef ENABLE_LOCK_STATS
+
+#include "common/debug.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_LOCK_STATS 64
+
+/* statistics are kept per name rather than per lock so that short lived locks,
+ * such as the one in each list or texture, are reported together */
+struct LG_LockStats
+{
+  const char      * name;
+  _Atomic(uint64_t) acquires;
+  _Atomic(uint64_t) contended;
+  _Atomic(uint64_t) waitNs, maxWaitNs;
+  _Atomic(uint64_t) holdNs, maxHoldNs;
+};
+
+static struct LG_LockStats stats[MAX_LOCK_STATS];
+static int                 statsCount = 0;
+static atomic_flag         statsLock  = ATOMIC_FLAG_INIT;
+static struct LG_LockStats overflow   = { .name = "(other)" };
+
+static inline void atomicMax(_Atomic(uint64_t) * value, uint64_t sample)
+{
+  uint64_t current = atomic_load_explicit(value, memory_order_relaxed);
+  while(sample > current &&
+      !atomic_compare_exchange_weak_explicit(value, &current, sample,
+        memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void lgLockInitStats(LG_Lock * lock, const char * name)
+{
+  lock->lockedAt = 0;
+  lock->stats    = NULL;
+
+  // the lock can't be used to protect itself
+  while(atomic_flag_test_and_set_explicit(&statsLock, memory_order_acquire))
+    CPU_RELAX();
+
+  for(int i = 0; i < statsCount; ++i)
+    if (strcmp(stats[i].name, name) == 0)
+    {
+      lock->stats = stats + i;
+      break;
+    }
+
+  if (!lock->stats)
+  {
+    if (statsCount < MAX_LOCK_STATS)
+    {
+      lock->stats       = stats + statsCount++;
+      lock->stats->name = name;
+    }
+    else
+      lock->stats = &overflow;
+  }
+
+  atomic_flag_clear_explicit(&statsLock, memory_order_release);
+}
+
+void lgLockAcquired(LG_Lock * lock, uint64_t waitStart, bool contended)
+{
+  const uint64_t now = nanotime();
+  lock->lockedAt = now;
+
+  // locks that were not initialized with LG_LOCK_INIT are not recorded
+  struct LG_LockStats * s = lock->stats;
+  if (!s)
+    return;
+
+  atomic_fetch_add_explicit(&s->acquires, 1, memory_order_relaxed);
+  if (!contended)
+    return;
+
+  const uint64_t wait = now - waitStart;
+  atomic_fetch_add_explicit(&s->contended, 1   , memory_order_relaxed);
+  atomic_fetch_add_explicit(&s->waitNs   , wait, memory_order_relaxed);
+  atomicMax(&s->maxWaitNs, wait);
+}
+
+void lgLockReleased(LG_Lock * lock)
+{
+  struct LG_LockStats * s = lock->stats;
+  if (!s)
+    return;
+
+  const uint64_t hold = nanotime() - lock->lockedAt;
+  atomic_fetch_add_explicit(&s->holdNs, hold, memory_order_relaxed);
+  atomicMax(&s->maxHoldNs, hold);
+}
+
+static void dumpStats(struct LG_LockStats * s)
+{
+  const uint64_t acquires = atomic_load(&s->acquires);
+  if (!acquires)
+    return;
+
+  DEBUG_INFO("%-40s %10llu %10llu %10.3f %10.3f %10.3f %10.3f",
+      s->name,
+      (unsigned long long)acquires,
+      (unsigned long long)atomic_load(&s->contended),
+      atomic_load(&s->waitNs   ) / 1e6,
+      atomic_load(&s->maxWaitNs) / 1e6,
+      atomic_load(&s->holdNs   ) / 1e6,
+      atomic_load(&s->maxHoldNs) / 1e6);
+}
+
+void lgLockStatsDump(void)
+{
+  DEBUG_INFO("Lock statistics (times in ms):");
+  DEBUG_INFO("%-40s %10s %10s %10s %10s %10s %10s",
+      "Lock", "Acquires", "Contended", "Wait", "Max Wait", "Hold", "Max Hold");
+
+  while(atomic_flag_test_and_set_explicit(&statsLock, memory_order_acquire))
+    CPU_RELAX();
+
+  for(int i = 0; i < statsCount; ++i)
+    dumpStats(stats + i);
+  dumpStats(&overflow);
+
+  atomic_flag_clear_explicit(&statsLock, memory_order_release);
+}
+
+#endif
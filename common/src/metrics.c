@@ -0,0 +1,372 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/metrics.h"
+#include "common/debug.h"
+#include "common/locking.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_METRICS 128
+
+// values up to 2^HIST_MAX_BITS ns (~18 minutes) are tracked, larger are clamped
+#define HIST_SUB_BITS 3
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 40
+#define HIST_BUCKETS  ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+// the exported bucket bounds, two per power of two from 1us to ~17s
+#define EXPORT_MIN_BITS 10
+#define EXPORT_MAX_BITS 34
+
+enum MetricType
+{
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM
+};
+
+struct LGMetric
+{
+  enum MetricType type;
+  const char *    name;
+  const char *    help;
+
+  _Atomic(uint64_t)   value;
+  _Atomic(uint64_t)   sum;
+  _Atomic(uint64_t) * buckets;
+};
+
+static struct
+{
+  LG_Lock      lock;
+  LGMetric     metrics[MAX_METRICS];
+  atomic_uint  count;
+
+  LGTimer    * timer;
+  char       * path;
+  char       * tmpPath;
+  char       * buffer;
+  size_t       bufferSize;
+}
+reg = { 0 };
+
+static LGMetric * metricsRegister(enum MetricType type, const char * name,
+    const char * help)
+{
+  LGMetric * ret = NULL;
+  LG_LOCK(reg.lock);
+
+  const unsigned count = atomic_load_explicit(&reg.count, memory_order_relaxed);
+  for(unsigned i = 0; i < count; ++i)
+    if (strcmp(reg.metrics[i].name, name) == 0)
+    {
+      if (reg.metrics[i].type == type)
+        ret = &reg.metrics[i];
+      else
+        DEBUG_ERROR("Metric %s registered again with a different type", name);
+      goto out;
+    }
+
+  if (count == MAX_METRICS)
+  {
+    DEBUG_ERROR("Too many metrics, %s will not be recorded", name);
+    goto out;
+  }
+
+  LGMetric * m = &reg.metrics[count];
+  if (type == METRIC_HISTOGRAM)
+  {
+    m->buckets = calloc(HIST_BUCKETS, sizeof(*m->buckets));
+    if (!m->buckets)
+    {
+      DEBUG_ERROR("out of memory");
+      goto out;
+    }
+  }
+
+  m->type = type;
+  m->name = name;
+  m->help = help;
+  ret     = m;
+
+  // publish the metric to metrics_format only once it is complete
+  atomic_store_explicit(&reg.count, count + 1, memory_order_release);
+
+out:
+  LG_UNLOCK(reg.lock);
+  return ret;
+}
+
+LGMetric * metrics_counter(const char * name, const char * help)
+{
+  return metricsRegister(METRIC_COUNTER, name, help);
+}
+
+LGMetric * metrics_gauge(const char * name, const char * help)
+{
+  return metricsRegister(METRIC_GAUGE, name, help);
+}
+
+LGMetric * metrics_histogram(const char * name, const char * help)
+{
+  return metricsRegister(METRIC_HISTOGRAM, name, help);
+}
+
+void metrics_add(LGMetric * metric, uint64_t value)
+{
+  if (metric)
+    atomic_fetch_add_explicit(&metric->value, value, memory_order_relaxed);
+}
+
+void metrics_set(LGMetric * metric, int64_t value)
+{
+  if (metric)
+    atomic_store_explicit(&metric->value, (uint64_t)value,
+        memory_order_relaxed);
+}
+
+static inline unsigned histIndex(uint64_t ns)
+{
+  if (ns < HIST_SUB)
+    return ns;
+
+  if (ns >= (1ULL << HIST_MAX_BITS))
+    return HIST_BUCKETS - 1;
+
+  const unsigned msb = 63 - __builtin_clzll(ns);
+  const unsigned sub = (ns >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1);
+  return (msb - HIST_SUB_BITS + 1) * HIST_SUB + sub;
+}
+
+// the exclusive upper bound of a bucket
+static inline uint64_t histBound(unsigned index)
+{
+  if (index < HIST_SUB)
+    return index + 1;
+
+  const unsigned msb = index / HIST_SUB + HIST_SUB_BITS - 1;
+  const unsigned sub = index % HIST_SUB;
+  return (1ULL << msb) + ((uint64_t)(sub + 1) << (msb - HIST_SUB_BITS));
+}
+
+void metrics_observe(LGMetric * metric, uint64_t ns)
+{
+  if (!metric)
+    return;
+
+  atomic_fetch_add_explicit(&metric->buckets[histIndex(ns)], 1,
+      memory_order_relaxed);
+  atomic_fetch_add_explicit(&metric->sum  , ns, memory_order_relaxed);
+  atomic_fetch_add_explicit(&metric->value, 1 , memory_order_relaxed);
+}
+
+struct Writer
+{
+  char * buffer;
+  size_t size;
+  size_t len;
+};
+
+static void writef(struct Writer * w, const char * fmt, ...)
+  __attribute__((format (printf, 2, 3)));
+
+static void writef(struct Writer * w, const char * fmt, ...)
+{
+  va_list va;
+  va_start(va, fmt);
+  const size_t avail = w->len < w->size ? w->size - w->len : 0;
+  const int    len   = vsnprintf(avail ? w->buffer + w->len : NULL, avail,
+      fmt, va);
+  va_end(va);
+
+  if (len > 0)
+    w->len += len;
+}
+
+static void formatHistogram(struct Writer * w, LGMetric * m)
+{
+  uint64_t count = 0;
+  unsigned index = 0;
+
+  for(unsigned bits = EXPORT_MIN_BITS; bits <= EXPORT_MAX_BITS; ++bits)
+    for(unsigned half = 0; half < 2; ++half)
+    {
+      // both bounds fall on the start of a bucket so the counts are exact
+      const uint64_t le = (1ULL << bits) + ((uint64_t)half << (bits - 1));
+      for(; index < HIST_BUCKETS && histBound(index) <= le; ++index)
+        count += atomic_load_explicit(&m->buckets[index],
+            memory_order_relaxed);
+
+      writef(w, "%s_bucket{le=\"%.9g\"} %" PRIu64 "\n",
+          m->name, le * 1e-9, count);
+    }
+
+  for(; index < HIST_BUCKETS; ++index)
+    count += atomic_load_explicit(&m->buckets[index], memory_order_relaxed);
+
+  // the count is taken from the buckets so it agrees with +Inf
+  writef(w, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", m->name, count);
+  writef(w, "%s_sum %.9f\n", m->name,
+      atomic_load_explicit(&m->sum, memory_order_relaxed) * 1e-9);
+  writef(w, "%s_count %" PRIu64 "\n", m->name, count);
+}
+
+size_t metrics_format(char * buffer, size_t size)
+{
+  static const char * typeStr[] =
+  {
+    [METRIC_COUNTER  ] = "counter",
+    [METRIC_GAUGE    ] = "gauge",
+    [METRIC_HISTOGRAM] = "histogram"
+  };
+
+  struct Writer w = { .buffer = buffer, .size = size };
+  const unsigned count = atomic_load_explicit(&reg.count, memory_order_acquire);
+
+  for(unsigned i = 0; i < count; ++i)
+  {
+    LGMetric * m = &reg.metrics[i];
+    if (m->help)
+      writef(&w, "# HELP %s %s\n", m->name, m->help);
+    writef(&w, "# TYPE %s %s\n", m->name, typeStr[m->type]);
+
+    const uint64_t value = atomic_load_explicit(&m->value,
+        memory_order_relaxed);
+    switch(m->type)
+    {
+      case METRIC_COUNTER:
+        writef(&w, "%s %" PRIu64 "\n", m->name, value);
+        break;
+
+      case METRIC_GAUGE:
+        writef(&w, "%s %" PRId64 "\n", m->name, (int64_t)value);
+        break;
+
+      case METRIC_HISTOGRAM:
+        formatHistogram(&w, m);
+        break;
+    }
+  }
+
+  if (size)
+    buffer[min(w.len, size - 1)] = '\0';
+
+  return w.len;
+}
+
+static bool exportTimerFn(void * udata)
+{
+  size_t len;
+  while((len = metrics_format(reg.buffer, reg.bufferSize)) >= reg.bufferSize)
+  {
+    char * buffer = realloc(reg.buffer, len + 4096);
+    if (!buffer)
+    {
+      DEBUG_ERROR("out of memory");
+      return true;
+    }
+    reg.buffer     = buffer;
+    reg.bufferSize = len + 4096;
+  }
+
+  FILE * fp = fopen(reg.tmpPath, "wb");
+  if (!fp)
+  {
+    DEBUG_WARN_RATELIMIT(60000, "Failed to open %s for writing",
+        reg.tmpPath);
+    return true;
+  }
+
+  const bool ok = fwrite(reg.buffer, 1, len, fp) == len;
+  if (fclose(fp) != 0 || !ok)
+  {
+    DEBUG_WARN_RATELIMIT(60000, "Failed to write %s", reg.tmpPath);
+    return true;
+  }
+
+#ifdef _WIN32
+  // rename does not replace an existing file on windows
+  remove(reg.path);
+#endif
+  if (rename(reg.tmpPath, reg.path) != 0)
+    DEBUG_WARN_RATELIMIT(60000, "Failed to replace %s", reg.path);
+
+  return true;
+}
+
+bool metrics_startExport(const char * path, unsigned int intervalMs)
+{
+  if (reg.timer)
+    return false;
+
+  const size_t len = strlen(path);
+  reg.path    = strdup(path);
+  reg.tmpPath = malloc(len + 5);
+  if (!reg.path || !reg.tmpPath)
+  {
+    DEBUG_ERROR("out of memory");
+    goto fail;
+  }
+  memcpy(reg.tmpPath      , path  , len);
+  memcpy(reg.tmpPath + len, ".tmp", 5);
+
+  if (!lgCreateTimer(intervalMs, exportTimerFn, NULL, &reg.timer))
+  {
+    DEBUG_ERROR("Failed to create the metrics export timer");
+    goto fail;
+  }
+
+  DEBUG_INFO("Exporting metrics to %s", path);
+  return true;
+
+fail:
+  free(reg.path);
+  free(reg.tmpPath);
+  reg.path    = NULL;
+  reg.tmpPath = NULL;
+  return false;
+}
+
+void metrics_stopExport(void)
+{
+  if (!reg.timer)
+    return;
+
+  lgTimerDestroy(reg.timer);
+  reg.timer = NULL;
+
+  // leave the final values behind
+  exportTimerFn(NULL);
+
+  free(reg.path);
+  free(reg.tmpPath);
+  free(reg.buffer);
+  reg.path       = NULL;
+  reg.tmpPath    = NULL;
+  reg.buffer     = NULL;
+  reg.bufferSize = 0;
+}
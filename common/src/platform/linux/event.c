@@ -21,22 +21,50 @@
 #include "common/event.h"
 
 #include "common/debug.h"
+#include "common/locking.h"
+#include "common/time.h"
 
 #include <stdlib.h>
-#include <pthread.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdatomic.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
+/* spinning is only worthwhile for events that are about to be signaled, the
+ * spin time requested by the caller is capped to this so that a long expected
+ * wait (ie, a frame period) does not burn a core */
+#define EVENT_MAX_SPIN_NS 100000ULL
+
+/**
+ * `signaled` doubles as the futex word. Signaling and waiting are lock free,
+ * the futex syscall is only made when there is a thread to wake or the event
+ * was not signaled within the spin time.
+ */
 struct LGEvent
 {
-  pthread_mutex_t mutex;
-  pthread_cond_t  cond;
-  atomic_int      waiting;
-  atomic_bool     signaled;
-  bool            autoReset;
+  _Atomic(uint32_t) signaled;
+  atomic_int        waiting;
+  bool              autoReset;
+  uint64_t          spinTime;
 };
 
+static inline long futexWait(_Atomic(uint32_t) * addr, uint32_t val,
+    const struct timespec * abstime)
+{
+  /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC timeout, unlike
+   * FUTEX_WAIT which is relative */
+  return syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, val, abstime,
+      NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static inline long futexWake(_Atomic(uint32_t) * addr, int count)
+{
+  return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
 LGEvent * lgCreateEvent(bool autoReset, unsigned int msSpinTime)
 {
   LGEvent * handle = calloc(1, sizeof(*handle));
@@ -46,32 +74,12 @@ LGEvent * lgCreateEvent(bool autoReset, unsigned int msSpinTime)
     return NULL;
   }
 
-  if (pthread_mutex_init(&handle->mutex, NULL) != 0)
-  {
-    DEBUG_ERROR("Failed to create the mutex");
-    free(handle);
-    return NULL;
-  }
-
-  pthread_condattr_t cattr;
-  pthread_condattr_init(&cattr);
-
-  if (pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC) != 0)
-  {
-    DEBUG_ERROR("Failed to set the condition clock to realtime");
-    pthread_mutex_destroy(&handle->mutex);
-    free(handle);
-    return NULL;
-  }
-
-  if (pthread_cond_init(&handle->cond, &cattr) != 0)
-  {
-    pthread_mutex_destroy(&handle->mutex);
-    free(handle);
-    return NULL;
-  }
-
   handle->autoReset = autoReset;
+
+  // spinning can only delay the signaling thread on a single CPU system
+  if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+    handle->spinTime =
+      min((uint64_t)msSpinTime * 1000000ULL, EVENT_MAX_SPIN_NS);
   return handle;
 }
 
@@ -82,63 +90,70 @@ void lgFreeEvent(LGEvent * handle)
   if (atomic_load_explicit(&handle->waiting, memory_order_acquire) != 0)
     DEBUG_ERROR("BUG: Freeing an event that still has threads waiting on it");
 
-  pthread_cond_destroy (&handle->cond );
-  pthread_mutex_destroy(&handle->mutex);
   free(handle);
 }
 
+// returns true if the event is signaled, consuming it if it is auto reset
+static inline bool tryConsume(LGEvent * handle)
+{
+  if (!handle->autoReset)
+    return atomic_load(&handle->signaled) != 0;
+
+  uint32_t expected = 1;
+  return atomic_compare_exchange_strong(&handle->signaled, &expected, 0);
+}
+
 bool lgWaitEventAbs(LGEvent * handle, struct timespec * ts)
 {
   DEBUG_ASSERT(handle);
 
-  bool ret   = true;
-  int  res;
+  if (tryConsume(handle))
+    return true;
 
-  if (pthread_mutex_lock(&handle->mutex) != 0)
+  if (handle->spinTime)
   {
-    DEBUG_ERROR("Failed to lock the mutex");
-    return false;
-  }
-
-  atomic_fetch_add_explicit(&handle->waiting, 1, memory_order_release);
-  while(ret && !atomic_load_explicit(&handle->signaled, memory_order_acquire))
-  {
-    if (!ts)
+    const uint64_t end = nanotime() + handle->spinTime;
+    do
     {
-      if ((res = pthread_cond_wait(&handle->cond, &handle->mutex)) != 0)
+      for(int i = 0; i < 64; ++i)
       {
-        DEBUG_ERROR("Failed to wait on the condition (err: %d)", res);
-        ret = false;
+        if (atomic_load_explicit(&handle->signaled, memory_order_relaxed) &&
+            tryConsume(handle))
+          return true;
+        CPU_RELAX();
       }
     }
-    else
+    while(nanotime() < end);
+  }
+
+  /* the signaler sets `signaled` before reading `waiting` and we increment
+   * `waiting` before reading `signaled` (both sequentially consistent), so at
+   * least one side always sees the other and a wakeup can not be lost */
+  bool ret = true;
+  atomic_fetch_add(&handle->waiting, 1);
+  while(!tryConsume(handle))
+  {
+    if (futexWait(&handle->signaled, 0, ts) == 0)
+      continue;
+
+    switch(errno)
     {
-      switch((res = pthread_cond_timedwait(&handle->cond, &handle->mutex, ts)))
-      {
-        case 0:
-          break;
+      case EAGAIN:
+      case EINTR:
+        continue;
 
-        case ETIMEDOUT:
-          ret = false;
-          break;
+      case ETIMEDOUT:
+        ret = tryConsume(handle);
+        break;
 
-        default:
-          ret = false;
-          DEBUG_ERROR("Timed wait failed (err: %d)", res);
-          break;
-      }
+      default:
+        DEBUG_ERROR("Futex wait failed (err: %d)", errno);
+        ret = false;
+        break;
     }
+    break;
   }
-
-  atomic_fetch_sub_explicit(&handle->waiting, 1, memory_order_release);
-  if (pthread_mutex_unlock(&handle->mutex) != 0)
-  {
-    DEBUG_ERROR("Failed to unlock the mutex");
-    return false;
-  }
-
-  if (ret && handle->autoReset)
-    atomic_store_explicit(&handle->signaled, false, memory_order_release);
+  atomic_fetch_sub(&handle->waiting, 1);
 
   return ret;
 }
@@ -150,14 +165,7 @@ bool lgWaitEventNS(LGEvent * handle, unsigned int timeout)
 
   struct timespec ts;
   clock_gettime(CLOCK_MONOTONIC, &ts);
-  uint64_t nsec = ts.tv_nsec + timeout;
-  if(nsec > 1000000000UL)
-  {
-    ts.tv_nsec = nsec - 1000000000UL;
-    ++ts.tv_sec;
-  }
-  else
-    ts.tv_nsec = nsec;
+  tsAdd(&ts, timeout);
 
   return lgWaitEventAbs(handle, &ts);
 }
@@ -167,33 +175,26 @@ bool lgWaitEvent(LGEvent * handle, unsigned int timeout)
   if (timeout == TIMEOUT_INFINITE)
     return lgWaitEventAbs(handle, NULL);
 
-  return lgWaitEventNS(handle, timeout * 1000000U);
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  tsAdd(&ts, (uint64_t)timeout * 1000000ULL);
+
+  return lgWaitEventAbs(handle, &ts);
 }
 
 bool lgSignalEvent(LGEvent * handle)
 {
   DEBUG_ASSERT(handle);
 
-  if (pthread_mutex_lock(&handle->mutex) != 0)
+  if (atomic_exchange(&handle->signaled, 1) == 0 &&
+      atomic_load(&handle->waiting) > 0)
   {
-    DEBUG_ERROR("Failed to lock the mutex");
-    return false;
-  }
-
-  const bool signaled = atomic_exchange_explicit(&handle->signaled, true,
-      memory_order_release);
-
-  if (!signaled)
-    if (pthread_cond_broadcast(&handle->cond) != 0)
+    // an auto reset event releases a single waiter
+    if (futexWake(&handle->signaled, handle->autoReset ? 1 : INT_MAX) < 0)
     {
-      DEBUG_ERROR("Failed to signal the condition");
+      DEBUG_ERROR("Failed to wake the waiters (err: %d)", errno);
       return false;
     }
-
-  if (pthread_mutex_unlock(&handle->mutex) != 0)
-  {
-    DEBUG_ERROR("Failed to unlock the mutex");
-    return false;
   }
 
   return true;
@@ -202,5 +203,5 @@ bool lgSignalEvent(LGEvent * handle)
 bool lgResetEvent(LGEvent * handle)
 {
   DEBUG_ASSERT(handle);
-  return atomic_exchange_explicit(&handle->signaled, false, memory_order_release);
+  return atomic_exchange_explicit(&handle->signaled, 0, memory_order_release);
 }
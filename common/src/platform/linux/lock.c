@@ -0,0 +1,63 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/locking.h"
+
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* how many times to poll a contended lock before parking, long enough to ride
+ * out a short critical section without a syscall */
+#define LOCK_SPIN_COUNT 128
+
+void lgLockContended(LG_Lock * lock)
+{
+  // spinning can only delay the holder on a single CPU system
+  static atomic_int spinCount = -1;
+  int spins = atomic_load_explicit(&spinCount, memory_order_relaxed);
+  if (unlikely(spins < 0))
+  {
+    spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? LOCK_SPIN_COUNT : 0;
+    atomic_store_explicit(&spinCount, spins, memory_order_relaxed);
+  }
+
+  for(int i = 0; i < spins; ++i)
+  {
+    CPU_RELAX();
+
+    uint32_t expected = 0;
+    if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 &&
+        atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1,
+          memory_order_acquire, memory_order_relaxed))
+      return;
+  }
+
+  /* mark the lock as having waiters, if it was unlocked in the meantime we
+   * now own it, but in the state that makes the unlock wake the next waiter
+   * which is harmless */
+  while(atomic_exchange_explicit(&lock->state, 2, memory_order_acquire) != 0)
+    syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+}
+
+void lgLockWake(LG_Lock * lock)
+{
+  syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
@@ -20,6 +20,7 @@
 
 #include "common/time.h"
 #include "common/debug.h"
+#include "common/event.h"
 #include "common/thread.h"
 #include "common/ll.h"
 
@@ -34,41 +35,77 @@ struct LGTimerState
   bool              running;
   struct LGThread * thread;
   struct ll       * timers;
+  LGEvent         * wake;
 };
 
 struct LGTimer
 {
-  unsigned int   interval;
-  unsigned int   count;
-  LGTimerFn      fn;
-  void         * udata;
+  uint64_t   interval;
+  uint64_t   next;
+  LGTimerFn  fn;
+  void     * udata;
 };
 
 static struct LGTimerState l_ts = { 0 };
 
-static int timerFn(void * fn)
+// the same clock as the LGEvent condition so deadlines can be waited on directly
+static inline uint64_t monotonicNS(void)
 {
-  struct LGTimer * timer;
   struct timespec time;
-
   clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/**
+ * Rather than ticking every millisecond the thread sleeps until the earliest
+ * deadline of all the registered timers, or indefinitely if there are none.
+ * Creating or destroying a timer signals the wake event so the deadline is
+ * recalculated.
+ */
+static int timerFn(void * opaque)
+{
+  struct LGTimer * timer;
 
   while(l_ts.running)
   {
+    uint64_t now  = monotonicNS();
+    uint64_t wake = UINT64_MAX;
+
     ll_lock(l_ts.timers);
     ll_forEachNL(l_ts.timers, item, timer)
     {
-      if (timer->count++ == timer->interval)
+      if (timer->next <= now)
       {
-        timer->count = 0;
         if (!timer->fn(timer->udata))
+        {
           ll_removeNL(l_ts.timers, item);
+          free(item);
+          continue;
+        }
+
+        /* keep the cadence, but if we have fallen behind skip the missed
+         * intervals rather than firing them back to back */
+        timer->next += timer->interval;
+        if (timer->next <= now)
+          timer->next = now + timer->interval;
       }
+
+      if (timer->next < wake)
+        wake = timer->next;
     }
     ll_unlock(l_ts.timers);
 
-    tsAdd(&time, 1000000);
-    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) != 0) {}
+    if (wake == UINT64_MAX)
+      lgWaitEventAbs(l_ts.wake, NULL);
+    else
+    {
+      struct timespec ts =
+      {
+        .tv_sec  = wake / 1000000000ULL,
+        .tv_nsec = wake % 1000000000ULL
+      };
+      lgWaitEventAbs(l_ts.wake, &ts);
+    }
   }
 
   return 0;
@@ -87,6 +124,13 @@ static inline bool setupTimerThread(void)
     goto err;
   }
 
+  l_ts.wake = lgCreateEvent(true, 0);
+  if (!l_ts.wake)
+  {
+    DEBUG_ERROR("failed to create the timer wake event");
+    goto err_event;
+  }
+
   if (!lgCreateThread("TimerThread", timerFn, NULL, &l_ts.thread))
   {
     DEBUG_ERROR("failed to create the timer thread");
@@ -96,7 +140,12 @@ static inline bool setupTimerThread(void)
   return true;
 
 err_thread:
+  lgFreeEvent(l_ts.wake);
+  l_ts.wake = NULL;
+
+err_event:
   ll_free(l_ts.timers);
+  l_ts.timers = NULL;
 
 err:
   return false;
@@ -108,11 +157,17 @@ static void destroyTimerThread(void)
     return;
 
   l_ts.running = false;
+  lgSignalEvent(l_ts.wake);
   lgJoinThread(l_ts.thread, NULL);
   l_ts.thread = NULL;
+
+  lgFreeEvent(l_ts.wake);
+  l_ts.wake = NULL;
+  ll_free(l_ts.timers);
+  l_ts.timers = NULL;
 }
 
-bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
+bool lgCreateTimerUS(const unsigned int intervalUS, LGTimerFn fn,
     void * udata, LGTimer ** result)
 {
   struct LGTimer * timer = malloc(sizeof(*timer));
@@ -122,8 +177,8 @@ bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
     return false;
   }
 
-  timer->interval = intervalMS;
-  timer->count    = 0;
+  timer->interval = (uint64_t)max(intervalUS, 1U) * 1000ULL;
+  timer->next     = monotonicNS() + timer->interval;
   timer->fn       = fn;
   timer->udata    = udata;
 
@@ -134,6 +189,7 @@ bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
   }
 
   ll_push(l_ts.timers, timer);
+  lgSignalEvent(l_ts.wake);
   *result = timer;
   return true;
 
@@ -142,6 +198,12 @@ err_thread:
   return false;
 }
 
+bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
+    void * udata, LGTimer ** result)
+{
+  return lgCreateTimerUS(intervalMS * 1000U, fn, udata, result);
+}
+
 void lgTimerDestroy(LGTimer * timer)
 {
   if (!l_ts.thread)
@@ -150,5 +212,6 @@ void lgTimerDestroy(LGTimer * timer)
   ll_removeData(l_ts.timers, timer);
   free(timer);
 
+  lgSignalEvent(l_ts.wake);
   destroyTimerThread();
 }
@@ -85,6 +85,9 @@ static LONG CALLBACK exception_filter(EXCEPTION_POINTERS * exc)
   CONTEXT context;
   memcpy(&context, exc->ContextRecord, sizeof context);
 
+  // write out what was queued before the crash, and everything after directly
+  debug_flush();
+
   DEBUG_ERROR("==== FATAL CRASH (%s) ====", BUILD_VERSION);
   DEBUG_ERROR("exception 0x%08lx (%s), address is %p", excInfo->ExceptionCode,
     exception_name(excInfo->ExceptionCode), excInfo->ExceptionAddress);
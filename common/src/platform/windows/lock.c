@@ -0,0 +1,49 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/locking.h"
+
+#include <windows.h>
+
+#define LOCK_SPIN_COUNT 128
+
+/* WaitOnAddress needs Windows 8, so instead of parking on the lock word the
+ * thread gives up its time slice until the lock is released */
+void lgLockContended(LG_Lock * lock)
+{
+  for(unsigned i = 0; ; ++i)
+  {
+    uint32_t expected = 0;
+    if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 &&
+        atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1,
+          memory_order_acquire, memory_order_relaxed))
+      return;
+
+    if (i < LOCK_SPIN_COUNT)
+      CPU_RELAX();
+    else if (!SwitchToThread())
+      Sleep(i < LOCK_SPIN_COUNT * 2 ? 0 : 1);
+  }
+}
+
+void lgLockWake(LG_Lock * lock)
+{
+  // nothing is ever parked on the lock, see lgLockContended
+}
@@ -61,6 +61,13 @@ bool lgCreateTimer(const unsigned int intervalMS, LGTimerFn fn,
   return true;
 }
 
+bool lgCreateTimerUS(const unsigned int intervalUS, LGTimerFn fn,
+    void * udata, LGTimer ** result)
+{
+  // SetTimer has millisecond resolution at best
+  return lgCreateTimer((intervalUS + 999) / 1000, fn, udata, result);
+}
+
 void lgTimerDestroy(LGTimer * timer)
 {
   if (timer->running)
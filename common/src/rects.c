@@ -20,10 +20,14 @@
 
 #include "common/rects.h"
 #include "common/util.h"
-#include "common/cpuinfo.h"
+#include "common/array.h"
+#include "common/cpudispatch.h"
 
 #include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
 #include <immintrin.h>
+#endif
 
 struct Corner
 {
@@ -315,6 +319,63 @@ static void rectCopyUnaligned_memcpy(
   }
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("sse4.1")
+#endif
+static void rectCopyUnaligned_sse4_1(
+    uint8_t *restrict dst, const uint8_t *restrict src,
+    int ystart, int yend, int dx, int dstPitch, int srcPitch, int width)
+{
+  src += ystart * srcPitch + dx;
+  dst += ystart * dstPitch + dx;
+
+  for (int i = ystart; i < yend; ++i)
+  {
+    // the pitch may not be a multiple of the vector size
+    const int align = min((int)((16 - ((uintptr_t)dst & 15)) & 15), width);
+    const int nvec  = (width - align) / (int)sizeof(__m128i);
+    const int rem   = (width - align) % (int)sizeof(__m128i);
+
+    // copy the unaligned bytes
+    for(int col = align - 1; col >= 0; --col)
+      dst[col] = src[col];
+
+    const __m128i *restrict s = (__m128i*)(src + align);
+          __m128i *restrict d = (__m128i*)(dst + align);
+
+    int vec;
+    for(vec = nvec; vec > 3; vec -= 4)
+    {
+      _mm_stream_si128(d + 0, _mm_loadu_si128(s + 0));
+      _mm_stream_si128(d + 1, _mm_loadu_si128(s + 1));
+      _mm_stream_si128(d + 2, _mm_loadu_si128(s + 2));
+      _mm_stream_si128(d + 3, _mm_loadu_si128(s + 3));
+
+      s += 4;
+      d += 4;
+    }
+
+    for(; vec > 0; --vec, ++d, ++s)
+      _mm_stream_si128(d, _mm_loadu_si128(s));
+
+    // copy any remaining bytes
+    for(int col = width - rem; col < width; ++col)
+      dst[col] = src[col];
+
+    src += srcPitch;
+    dst += dstPitch;
+  }
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
 #ifdef __clang__
   #pragma clang attribute push (__attribute__((target("avx"))), apply_to=function)
 #else
@@ -328,12 +389,13 @@ static void rectCopyUnaligned_avx(
   src += ystart * srcPitch + dx;
   dst += ystart * dstPitch + dx;
 
-  const int align = (32 - ((uintptr_t)dst & 31)) & 31;
-  const int nvec  = (width - align) / sizeof(__m256i);
-  const int rem   = (width - align) % sizeof(__m256i);
-
   for (int i = ystart; i < yend; ++i)
   {
+    // the pitch may not be a multiple of the vector size
+    const int align = min((int)((32 - ((uintptr_t)dst & 31)) & 31), width);
+    const int nvec  = (width - align) / (int)sizeof(__m256i);
+    const int rem   = (width - align) % (int)sizeof(__m256i);
+
     // copy the unaligned bytes
     for(int col = align - 1; col >= 0; --col)
       dst[col] = src[col];
@@ -370,14 +432,79 @@ static void rectCopyUnaligned_avx(
   #pragma GCC pop_options
 #endif
 
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx512f,avx512bw"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx512f,avx512bw")
+#endif
+static void rectCopyUnaligned_avx512(
+    uint8_t *restrict dst, const uint8_t *restrict src,
+    int ystart, int yend, int dx, int dstPitch, int srcPitch, int width)
+{
+  src += ystart * srcPitch + dx;
+  dst += ystart * dstPitch + dx;
+
+  for (int i = ystart; i < yend; ++i)
+  {
+    // the pitch may not be a multiple of the vector size
+    const int align = min((int)((64 - ((uintptr_t)dst & 63)) & 63), width);
+    const int nvec  = (width - align) / (int)sizeof(__m512i);
+    const int rem   = (width - align) % (int)sizeof(__m512i);
+
+    // masks for the unaligned head and tail bytes
+    const __mmask64 head = align ? ~0ULL >> (64 - align) : 0;
+    const __mmask64 tail = rem   ? ~0ULL >> (64 - rem  ) : 0;
+
+    _mm512_mask_storeu_epi8(dst, head, _mm512_maskz_loadu_epi8(head, src));
+
+    const __m512i *restrict s = (__m512i*)(src + align);
+          __m512i *restrict d = (__m512i*)(dst + align);
+
+    int vec;
+    for(vec = nvec; vec > 3; vec -= 4)
+    {
+      _mm512_stream_si512(d + 0, _mm512_loadu_si512(s + 0));
+      _mm512_stream_si512(d + 1, _mm512_loadu_si512(s + 1));
+      _mm512_stream_si512(d + 2, _mm512_loadu_si512(s + 2));
+      _mm512_stream_si512(d + 3, _mm512_loadu_si512(s + 3));
+
+      s += 4;
+      d += 4;
+    }
+
+    for(; vec > 0; --vec, ++d, ++s)
+      _mm512_stream_si512(d, _mm512_loadu_si512(s));
+
+    _mm512_mask_storeu_epi8(d, tail, _mm512_maskz_loadu_epi8(tail, s));
+
+    src += srcPitch;
+    dst += dstPitch;
+  }
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+#endif
+
+static const CPUDispatchImpl rectCopyUnalignedImpls[] =
+{
+  CPU_DISPATCH_IMPL(CPU_TIER_C     , rectCopyUnaligned_memcpy),
+#if defined(__x86_64__) || defined(__i386__)
+  CPU_DISPATCH_IMPL(CPU_TIER_SSE4_1, rectCopyUnaligned_sse4_1),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX   , rectCopyUnaligned_avx   ),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX512, rectCopyUnaligned_avx512),
+#endif
+};
+
 static void _rectCopyUnaligned(
   uint8_t *restrict dst, const uint8_t *restrict src,
     int ystart, int yend, int dx, int dstPitch, int srcPitch, int width)
 {
-  if (cpuInfo_getFeatures()->avx)
-    rectCopyUnaligned = &rectCopyUnaligned_avx;
-  else
-    rectCopyUnaligned = &rectCopyUnaligned_memcpy;
+  rectCopyUnaligned = (__typeof__(rectCopyUnaligned))
+    cpuDispatch_select(&rectCopyUnalignedKernel);
 
   return rectCopyUnaligned(
       dst, src, ystart, yend, dx, dstPitch, srcPitch, width);
@@ -386,3 +513,16 @@ static void _rectCopyUnaligned(
 void (*rectCopyUnaligned)(uint8_t * dst, const uint8_t * src,
     int ystart, int yend, int dx, int dstPitch, int srcPitch, int width) =
   &_rectCopyUnaligned;
+
+static void rectCopyUnalignedReset(void)
+{
+  rectCopyUnaligned = &_rectCopyUnaligned;
+}
+
+const CPUDispatchKernel rectCopyUnalignedKernel =
+{
+  .name  = "rectCopyUnaligned",
+  .impls = rectCopyUnalignedImpls,
+  .count = ARRAY_LENGTH(rectCopyUnalignedImpls),
+  .reset = rectCopyUnalignedReset
+};
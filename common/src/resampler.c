@@ -0,0 +1,223 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/resampler.h"
+#include "common/debug.h"
+#include "common/util.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESAMPLER_TAPS   32
+#define RESAMPLER_PHASES 256
+#define RESAMPLER_CUTOFF 0.9
+
+struct Resampler
+{
+  int     channels;
+  int     capacity; // the size of the buffer in frames
+  int     count;    // the number of frames in the buffer
+  double  pos;      // the read position in the buffer
+
+  // (RESAMPLER_PHASES + 1) sets of RESAMPLER_TAPS coefficients, the extra set
+  // allows interpolating between phases without wrapping
+  float   coeffs[RESAMPLER_PHASES + 1][RESAMPLER_TAPS];
+  float * buffer;
+};
+
+static double sinc(double x)
+{
+  if (fabs(x) < 1e-9)
+    return 1.0;
+  return sin(M_PI * x) / (M_PI * x);
+}
+
+static void computeCoeffs(struct Resampler * rs)
+{
+  const double half = RESAMPLER_TAPS / 2;
+  for(int p = 0; p <= RESAMPLER_PHASES; ++p)
+  {
+    const double frac = (double)p / RESAMPLER_PHASES;
+    double sum = 0.0;
+    double c[RESAMPLER_TAPS];
+
+    for(int t = 0; t < RESAMPLER_TAPS; ++t)
+    {
+      // distance of this tap from the interpolation point
+      const double x = t - (half - 1.0) - frac;
+
+      // 4-term Blackman-Harris window
+      const double w = M_PI * x / half;
+      const double window =
+        0.35875 +
+        0.48829 * cos(      w) +
+        0.14128 * cos(2.0 * w) +
+        0.01168 * cos(3.0 * w);
+
+      c[t] = RESAMPLER_CUTOFF * sinc(RESAMPLER_CUTOFF * x) * window;
+      sum += c[t];
+    }
+
+    // normalise for unity gain at DC
+    for(int t = 0; t < RESAMPLER_TAPS; ++t)
+      rs->coeffs[p][t] = c[t] / sum;
+  }
+}
+
+Resampler resampler_new(int channels, int maxFrames)
+{
+  DEBUG_ASSERT(channels > 0 && maxFrames > 0);
+
+  struct Resampler * rs = calloc(1, sizeof(*rs));
+  if (!rs)
+  {
+    DEBUG_ERROR("out of memory");
+    return NULL;
+  }
+
+  rs->channels = channels;
+  rs->capacity = maxFrames + RESAMPLER_TAPS;
+  rs->buffer   = malloc(rs->capacity * channels * sizeof(float));
+  if (!rs->buffer)
+  {
+    DEBUG_ERROR("out of memory");
+    free(rs);
+    return NULL;
+  }
+
+  computeCoeffs(rs);
+  resampler_reset(rs);
+  return rs;
+}
+
+void resampler_free(Resampler * rs)
+{
+  if (!*rs)
+    return;
+
+  free((*rs)->buffer);
+  free(*rs);
+  *rs = NULL;
+}
+
+void resampler_reset(Resampler rs)
+{
+  // prime the buffer with silence so output starts immediately
+  rs->count = resampler_getLatency();
+  rs->pos   = 0.0;
+  memset(rs->buffer, 0, rs->count * rs->channels * sizeof(float));
+}
+
+int resampler_getLatency(void)
+{
+  return RESAMPLER_TAPS / 2;
+}
+
+static inline void interpCoeffs(const struct Resampler * rs, double pos,
+    float * restrict c)
+{
+  const double phase = (pos - floor(pos)) * RESAMPLER_PHASES;
+  const int    p     = (int)phase;
+  const float  f     = phase - p;
+
+  const float * restrict c0 = rs->coeffs[p    ];
+  const float * restrict c1 = rs->coeffs[p + 1];
+  for(int t = 0; t < RESAMPLER_TAPS; ++t)
+    c[t] = c0[t] + (c1[t] - c0[t]) * f;
+}
+
+static int generate(struct Resampler * rs, float * out, int outFrames,
+    double step)
+{
+  const int ch = rs->channels;
+  float c[RESAMPLER_TAPS];
+  int generated = 0;
+
+  while(generated < outFrames && (int)rs->pos + RESAMPLER_TAPS <= rs->count)
+  {
+    interpCoeffs(rs, rs->pos, c);
+    const float * restrict src = rs->buffer + (int)rs->pos * ch;
+
+    if (ch == 2)
+    {
+      float l = 0.0f, r = 0.0f;
+      for(int t = 0; t < RESAMPLER_TAPS; ++t)
+      {
+        l += src[t * 2 + 0] * c[t];
+        r += src[t * 2 + 1] * c[t];
+      }
+      out[0] = l;
+      out[1] = r;
+    }
+    else
+      for(int i = 0; i < ch; ++i)
+      {
+        float acc = 0.0f;
+        for(int t = 0; t < RESAMPLER_TAPS; ++t)
+          acc += src[t * ch + i] * c[t];
+        out[i] = acc;
+      }
+
+    out     += ch;
+    rs->pos += step;
+    ++generated;
+  }
+
+  // discard the frames that are no longer needed
+  const int drop = min((int)rs->pos, rs->count);
+  if (drop > 0)
+  {
+    memmove(rs->buffer, rs->buffer + drop * ch,
+        (rs->count - drop) * ch * sizeof(float));
+    rs->count -= drop;
+    rs->pos   -= drop;
+  }
+
+  return generated;
+}
+
+int resampler_process(Resampler rs, const float * in, int frames,
+    float * out, int outFrames, double ratio)
+{
+  const int    ch   = rs->channels;
+  const double step = 1.0 / ratio;
+  int generated = 0;
+
+  while(frames > 0)
+  {
+    const int n = min(frames, rs->capacity - rs->count);
+    if (n == 0)
+    {
+      DEBUG_ERROR("Output buffer too small, %d frames dropped", frames);
+      break;
+    }
+
+    memcpy(rs->buffer + rs->count * ch, in, n * ch * sizeof(float));
+    rs->count += n;
+    in        += n * ch;
+    frames    -= n;
+
+    generated += generate(rs, out + generated * ch, outFrames - generated,
+        step);
+  }
+
+  return generated;
+}
@@ -22,31 +22,61 @@
 #include "common/debug.h"
 #include "common/util.h"
 
+#include <stdalign.h>
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
 struct RingBuffer
 {
   uint32_t          length;
   uint32_t          valueSize;
-  _Atomic(uint32_t) readPos;
-  _Atomic(uint32_t) writePos;
   bool              unbounded;
-  char              values[0];
+
+  /* The reader and the writer are usually on different threads, keep each
+   * position on its own cache line so they do not contend with each other */
+  alignas(64) _Atomic(uint32_t) readPos;
+  alignas(64) _Atomic(uint32_t) writePos;
+  alignas(64) char              values[0];
 };
 
+/* the struct has cache line aligned members which malloc does not guarantee */
+static void * allocAligned(size_t size)
+{
+  size = ALIGN_TO(size, alignof(struct RingBuffer));
+#ifdef _WIN32
+  return _aligned_malloc(size, alignof(struct RingBuffer));
+#else
+  return aligned_alloc(alignof(struct RingBuffer), size);
+#endif
+}
+
+static void freeAligned(void * ptr)
+{
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
 RingBuffer ringbuffer_newInternal(int length, size_t valueSize,
     bool unbounded)
 {
   DEBUG_ASSERT(valueSize > 0 && valueSize < UINT32_MAX);
 
-  struct RingBuffer * rb = calloc(1, sizeof(*rb) + valueSize * length);
+  const size_t size = sizeof(struct RingBuffer) + valueSize * length;
+  struct RingBuffer * rb = allocAligned(size);
   if (!rb)
   {
     DEBUG_ERROR("out of memory");
     return NULL;
   }
+  memset(rb, 0, size);
 
   rb->length    = length;
   rb->valueSize = valueSize;
@@ -71,7 +101,7 @@ void ringbuffer_free(RingBuffer * rb)
   if (!*rb)
     return;
 
-  free(*rb);
+  freeAligned(*rb);
   *rb = NULL;
 }
 
@@ -0,0 +1,324 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "common/sampleconv.h"
+#include "common/array.h"
+#include "common/cpudispatch.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static void sampleconv_s16ToFloat_c(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+    dst[i] = src[i] * (1.0f / 32768.0f);
+}
+
+static void sampleconv_floatToS16_c(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    const float v = src[i] * 32768.0f;
+    if (v >= 32767.0f)
+      dst[i] = INT16_MAX;
+    else if (v <= -32768.0f)
+      dst[i] = INT16_MIN;
+    else
+      dst[i] = (int16_t)lrintf(v);
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("sse4.1")
+#endif
+static void sampleconv_s16ToFloat_sse4_1(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+  size_t i = 0;
+  for(; i + 8 <= count; i += 8)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+    const __m128 f1 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(s));
+    const __m128 f2 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(s, 8)));
+
+    _mm_storeu_ps(dst + i    , _mm_mul_ps(f1, scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(f2, scale));
+  }
+
+  sampleconv_s16ToFloat_c(src + i, dst + i, count - i);
+}
+
+static void sampleconv_floatToS16_sse4_1(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  const __m128 scale = _mm_set1_ps(32768.0f);
+
+  size_t i = 0;
+  for(; i + 8 <= count; i += 8)
+  {
+    const __m128i i1 = _mm_cvtps_epi32(
+        _mm_mul_ps(_mm_loadu_ps(src + i    ), scale));
+    const __m128i i2 = _mm_cvtps_epi32(
+        _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(i1, i2));
+  }
+
+  sampleconv_floatToS16_c(src + i, dst + i, count - i);
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx2"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx2")
+#endif
+static void sampleconv_s16ToFloat_avx2(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+
+  size_t i = 0;
+  for(; i + 16 <= count; i += 16)
+  {
+    const __m128i s1 = _mm_loadu_si128((const __m128i *)(src + i    ));
+    const __m128i s2 = _mm_loadu_si128((const __m128i *)(src + i + 8));
+
+    const __m256 f1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s1));
+    const __m256 f2 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s2));
+
+    _mm256_storeu_ps(dst + i    , _mm256_mul_ps(f1, scale));
+    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(f2, scale));
+  }
+
+  sampleconv_s16ToFloat_c(src + i, dst + i, count - i);
+}
+
+static void sampleconv_floatToS16_avx2(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+
+  size_t i = 0;
+  for(; i + 16 <= count; i += 16)
+  {
+    const __m256i i1 = _mm256_cvtps_epi32(
+        _mm256_mul_ps(_mm256_loadu_ps(src + i    ), scale));
+    const __m256i i2 = _mm256_cvtps_epi32(
+        _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale));
+
+    // packs operates per 128-bit lane, restore the sample order afterwards
+    const __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packs_epi32(i1, i2), 0xD8);
+
+    _mm256_storeu_si256((__m256i *)(dst + i), packed);
+  }
+
+  sampleconv_floatToS16_c(src + i, dst + i, count - i);
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx512f,avx512bw"))), apply_to=function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target ("avx512f,avx512bw")
+#endif
+static void sampleconv_s16ToFloat_avx512(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  const __m512 scale = _mm512_set1_ps(1.0f / 32768.0f);
+
+  size_t i = 0;
+  for(; i + 32 <= count; i += 32)
+  {
+    const __m256i s1 = _mm256_loadu_si256((const __m256i *)(src + i     ));
+    const __m256i s2 = _mm256_loadu_si256((const __m256i *)(src + i + 16));
+
+    const __m512 f1 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(s1));
+    const __m512 f2 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(s2));
+
+    _mm512_storeu_ps(dst + i     , _mm512_mul_ps(f1, scale));
+    _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(f2, scale));
+  }
+
+  sampleconv_s16ToFloat_c(src + i, dst + i, count - i);
+}
+
+static void sampleconv_floatToS16_avx512(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  const __m512 scale = _mm512_set1_ps(32768.0f);
+
+  size_t i = 0;
+  for(; i + 32 <= count; i += 32)
+  {
+    const __m512i i1 = _mm512_cvtps_epi32(
+        _mm512_mul_ps(_mm512_loadu_ps(src + i     ), scale));
+    const __m512i i2 = _mm512_cvtps_epi32(
+        _mm512_mul_ps(_mm512_loadu_ps(src + i + 16), scale));
+
+    // unlike packs the saturating narrow keeps the sample order
+    _mm256_storeu_si256((__m256i *)(dst + i     ), _mm512_cvtsepi32_epi16(i1));
+    _mm256_storeu_si256((__m256i *)(dst + i + 16), _mm512_cvtsepi32_epi16(i2));
+  }
+
+  sampleconv_floatToS16_c(src + i, dst + i, count - i);
+}
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+#endif
+
+#if defined(__aarch64__)
+static void sampleconv_s16ToFloat_neon(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  size_t i = 0;
+  for(; i + 8 <= count; i += 8)
+  {
+    const int16x8_t s = vld1q_s16(src + i);
+
+    // fixed point conversion with 15 fractional bits scales by 1 / 32768
+    vst1q_f32(dst + i    , vcvtq_n_f32_s32(vmovl_s16(vget_low_s16 (s)), 15));
+    vst1q_f32(dst + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(s)), 15));
+  }
+
+  sampleconv_s16ToFloat_c(src + i, dst + i, count - i);
+}
+
+static void sampleconv_floatToS16_neon(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  const float32x4_t scale = vdupq_n_f32(32768.0f);
+
+  size_t i = 0;
+  for(; i + 8 <= count; i += 8)
+  {
+    const int32x4_t i1 = vcvtnq_s32_f32(
+        vmulq_f32(vld1q_f32(src + i    ), scale));
+    const int32x4_t i2 = vcvtnq_s32_f32(
+        vmulq_f32(vld1q_f32(src + i + 4), scale));
+
+    vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(i1), vqmovn_s32(i2)));
+  }
+
+  sampleconv_floatToS16_c(src + i, dst + i, count - i);
+}
+#endif
+
+static const CPUDispatchImpl sampleconv_s16ToFloatImpls[] =
+{
+  CPU_DISPATCH_IMPL(CPU_TIER_C     , sampleconv_s16ToFloat_c     ),
+#if defined(__x86_64__) || defined(__i386__)
+  CPU_DISPATCH_IMPL(CPU_TIER_SSE4_1, sampleconv_s16ToFloat_sse4_1),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX2  , sampleconv_s16ToFloat_avx2  ),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX512, sampleconv_s16ToFloat_avx512),
+#elif defined(__aarch64__)
+  CPU_DISPATCH_IMPL(CPU_TIER_NEON  , sampleconv_s16ToFloat_neon  ),
+#endif
+};
+
+static const CPUDispatchImpl sampleconv_floatToS16Impls[] =
+{
+  CPU_DISPATCH_IMPL(CPU_TIER_C     , sampleconv_floatToS16_c     ),
+#if defined(__x86_64__) || defined(__i386__)
+  CPU_DISPATCH_IMPL(CPU_TIER_SSE4_1, sampleconv_floatToS16_sse4_1),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX2  , sampleconv_floatToS16_avx2  ),
+  CPU_DISPATCH_IMPL(CPU_TIER_AVX512, sampleconv_floatToS16_avx512),
+#elif defined(__aarch64__)
+  CPU_DISPATCH_IMPL(CPU_TIER_NEON  , sampleconv_floatToS16_neon  ),
+#endif
+};
+
+static void _sampleconv_s16ToFloat(const int16_t * restrict src,
+    float * restrict dst, size_t count)
+{
+  sampleconv_s16ToFloat = (__typeof__(sampleconv_s16ToFloat))
+    cpuDispatch_select(&sampleconv_s16ToFloatKernel);
+
+  sampleconv_s16ToFloat(src, dst, count);
+}
+
+static void _sampleconv_floatToS16(const float * restrict src,
+    int16_t * restrict dst, size_t count)
+{
+  sampleconv_floatToS16 = (__typeof__(sampleconv_floatToS16))
+    cpuDispatch_select(&sampleconv_floatToS16Kernel);
+
+  sampleconv_floatToS16(src, dst, count);
+}
+
+void (*sampleconv_s16ToFloat)(const int16_t * restrict src,
+    float * restrict dst, size_t count) = &_sampleconv_s16ToFloat;
+
+void (*sampleconv_floatToS16)(const float * restrict src,
+    int16_t * restrict dst, size_t count) = &_sampleconv_floatToS16;
+
+static void sampleconv_s16ToFloatReset(void)
+{
+  sampleconv_s16ToFloat = &_sampleconv_s16ToFloat;
+}
+
+static void sampleconv_floatToS16Reset(void)
+{
+  sampleconv_floatToS16 = &_sampleconv_floatToS16;
+}
+
+const CPUDispatchKernel sampleconv_s16ToFloatKernel =
+{
+  .name  = "sampleconv_s16ToFloat",
+  .impls = sampleconv_s16ToFloatImpls,
+  .count = ARRAY_LENGTH(sampleconv_s16ToFloatImpls),
+  .reset = sampleconv_s16ToFloatReset
+};
+
+const CPUDispatchKernel sampleconv_floatToS16Kernel =
+{
+  .name  = "sampleconv_floatToS16",
+  .impls = sampleconv_floatToS16Impls,
+  .count = ARRAY_LENGTH(sampleconv_floatToS16Impls),
+  .reset = sampleconv_floatToS16Reset
+};
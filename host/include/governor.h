@@ -0,0 +1,57 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "interface/capture.h"
+
+/* Paces the capture loop. Captures run at the full rate while the screen is
+ * changing or the client is sending input, and slow down towards
+ * app:idleFPS once the screen has been static for a while, but only when the
+ * client's input arrives through the KVMFR input queue. The rate is also
+ * capped to the refresh rate of the client's display when it is known, and
+ * reduced while the client is not keeping up with the frames posted. */
+
+bool governor_init(unsigned int maxFps, unsigned int idleFps);
+void governor_free(void);
+
+/* something that is likely to be followed by damage happened, such as input
+ * from the client or pointer movement, return to the full rate immediately */
+void governor_activity(void);
+
+/* input arrived through the KVMFR input queue, this is activity and also
+ * enables idling as input can now be observed */
+void governor_input(void);
+
+// the client session changed, input is no longer known to be observable
+void governor_resetInput(void);
+
+// reports the damage of a captured frame
+void governor_frame(const CaptureFrame * frame);
+
+/* waits until the next capture is due, `lastCapture` is the microtime of the
+ * last capture that returned a frame, `pending` is the number of frames that
+ * the client has not yet consumed and `displayRate` is the client's refresh
+ * rate in mHz, or zero if unknown */
+void governor_wait(uint64_t lastCapture, uint32_t pending,
+    uint32_t displayRate);
@@ -0,0 +1,36 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "common/KVMFR.h"
+
+/* starts draining the client's input events from `queue` and passing them to
+ * os_injectInput */
+bool input_start(KVMFRInputQueue * queue);
+void input_stop(void);
+
+/* the queue is only polled while a client is connected, the thread sleeps
+ * until this is called with `active` set */
+void input_setActive(bool active);
+
+// the refresh rate of the client's display in mHz, or zero if unknown
+uint32_t input_getDisplayRate(void);
@@ -49,6 +49,11 @@ bool os_blockScreensaver(void);
 bool os_hasSetCursorPos(void);
 void os_setCursorPos(int x, int y);
 
+// injection of the client's input, os_initInput returns false if unsupported
+bool os_initInput(void);
+void os_freeInput(void);
+void os_injectInput(const KVMFRInputEvent * events, unsigned int count);
+
 // return the KVMFR OS type
 KVMFROS os_getKVMFRType(void);
 
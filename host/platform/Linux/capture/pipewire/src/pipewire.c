@@ -24,6 +24,8 @@
 #include "common/util.h"
 #include "common/debug.h"
 #include "common/stringutils.h"
+#include "common/option.h"
+#include "common/hdrconv.h"
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -47,10 +49,11 @@ struct pipewire
   bool          stop;
   bool          hasFormat;
   bool          formatChanged;
-  int           width, height, dataHeight, pitch;
+  int           width, height, dataHeight, pitch, srcPitch;
   CaptureFormat format;
   bool          hdr;
   bool          hdrPQ;
+  bool          convert16;
   uint8_t     * frameData;
   unsigned int  formatVer;
 };
@@ -68,6 +71,32 @@ static const char * pipewire_getName(void)
   return "PipeWire";
 }
 
+static void pipewire_initOptions(void)
+{
+  struct Option options[] =
+  {
+    {
+      .module       = "pipewire",
+      .name         = "HDR16to10",
+      .description  =
+        "Convert HDR16/8bpp to HDR10/4bpp on the CPU (saves bandwidth)",
+      .type         = OPTION_TYPE_BOOL,
+      .value.x_bool = true
+    },
+    {
+      .module       = "pipewire",
+      .name         = "HDR16to10PQ",
+      .description  =
+        "PQ encode converted HDR10 frames, otherwise they are linear",
+      .type         = OPTION_TYPE_BOOL,
+      .value.x_bool = true
+    },
+    {0}
+  };
+
+  option_register(options);
+}
+
 static bool pipewire_create(
   CaptureGetPointerBuffer getPointerBufferFn,
   CapturePostPointerBuffer postPointerBufferFn,
@@ -191,13 +220,26 @@ static void streamParamChangedCallback(void * opaque, uint32_t id,
   this->width  = info.size.width;
   this->height = info.size.height;
   this->format = convertSpaFormat(info.format);
-  this->hdr    = info.format & (
-      SPA_VIDEO_FORMAT_xBGR_210LE |
-      SPA_VIDEO_FORMAT_RGBA_F16);
+  this->hdr    =
+    info.format == SPA_VIDEO_FORMAT_xBGR_210LE ||
+    info.format == SPA_VIDEO_FORMAT_RGBA_F16;
   this->hdrPQ  = true; // this is assumed and untested
 
   const int bpp = this->format == CAPTURE_FMT_RGBA16F ? 8 : 4;
-  this->pitch = this->width * bpp;
+  this->srcPitch = this->width * bpp;
+
+  /* FP16 frames are twice the size of HDR10 for no visible gain, convert them
+   * while copying into the frame buffer */
+  this->convert16 = this->format == CAPTURE_FMT_RGBA16F &&
+    option_get_bool("pipewire", "HDR16to10");
+  if (this->convert16)
+  {
+    this->format = CAPTURE_FMT_RGBA10;
+    this->hdrPQ  = option_get_bool("pipewire", "HDR16to10PQ");
+    this->pitch  = this->width * 4;
+  }
+  else
+    this->pitch = this->srcPitch;
 
   if (this->hasFormat)
   {
@@ -470,8 +512,12 @@ static CaptureResult pipewire_getFrame(
   if (this->stop || !this->frameData)
     return CAPTURE_RESULT_REINIT;
 
-  framebuffer_write(frame, this->frameData,
-      this->dataHeight * this->pitch);
+  if (this->convert16)
+    hdrconv_writeFrame(frame, this->frameData, this->srcPitch,
+        this->width, this->dataHeight, this->hdrPQ);
+  else
+    framebuffer_write(frame, this->frameData,
+        this->dataHeight * this->pitch);
 
   pw_thread_loop_accept(this->threadLoop);
   return CAPTURE_RESULT_OK;
@@ -482,6 +528,7 @@ struct CaptureInterface Capture_pipewire =
   .shortName       = "pipewire",
   .asyncCapture    = false,
   .getName         = pipewire_getName,
+  .initOptions     = pipewire_initOptions,
   .create          = pipewire_create,
   .init            = pipewire_init,
   .stop            = pipewire_stop,
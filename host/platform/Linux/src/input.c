@@ -0,0 +1,237 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "interface/platform.h"
+#include "common/debug.h"
+#include "common/util.h"
+#include "common/array.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+/* two devices are created as a device that reports both relative and absolute
+ * motion is not handled well by libinput. The relative device also carries
+ * the keyboard and buttons */
+static struct
+{
+  int rel;
+  int abs;
+}
+uinput = { .rel = -1, .abs = -1 };
+
+static const int buttonMap[] =
+{
+  [KVMFR_BUTTON_LEFT  ] = BTN_LEFT,
+  [KVMFR_BUTTON_MIDDLE] = BTN_MIDDLE,
+  [KVMFR_BUTTON_RIGHT ] = BTN_RIGHT,
+  [KVMFR_BUTTON_SIDE  ] = BTN_SIDE,
+  [KVMFR_BUTTON_EXTRA ] = BTN_EXTRA
+};
+
+static int createDevice(const char * name, bool absolute)
+{
+  int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+  {
+    DEBUG_INFO("Unable to open /dev/uinput: %s", strerror(errno));
+    return -1;
+  }
+
+  bool ok =
+    ioctl(fd, UI_SET_EVBIT, EV_SYN) == 0 &&
+    ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0;
+
+  for(int i = 0; ok && i < ARRAY_LENGTH(buttonMap); ++i)
+    if (buttonMap[i])
+      ok = ioctl(fd, UI_SET_KEYBIT, buttonMap[i]) == 0;
+
+  if (absolute)
+  {
+    ok = ok && ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0;
+    for(int axis = ABS_X; ok && axis <= ABS_Y; ++axis)
+    {
+      struct uinput_abs_setup abs =
+      {
+        .code = axis,
+        .absinfo =
+        {
+          .minimum = 0,
+          .maximum = KVMFR_INPUT_ABS_MAX
+        }
+      };
+      ok = ioctl(fd, UI_SET_ABSBIT, axis) == 0 &&
+        ioctl(fd, UI_ABS_SETUP, &abs) == 0;
+    }
+  }
+  else
+  {
+    ok = ok &&
+      ioctl(fd, UI_SET_EVBIT , EV_REL   ) == 0 &&
+      ioctl(fd, UI_SET_RELBIT, REL_X    ) == 0 &&
+      ioctl(fd, UI_SET_RELBIT, REL_Y    ) == 0 &&
+      ioctl(fd, UI_SET_RELBIT, REL_WHEEL) == 0;
+
+    for(int key = KEY_ESC; ok && key <= KEY_MICMUTE; ++key)
+      ok = ioctl(fd, UI_SET_KEYBIT, key) == 0;
+  }
+
+  struct uinput_setup setup =
+  {
+    .id =
+    {
+      .bustype = BUS_VIRTUAL,
+      .version = 1
+    }
+  };
+  strncpy(setup.name, name, sizeof(setup.name) - 1);
+
+  if (!ok ||
+      ioctl(fd, UI_DEV_SETUP, &setup) != 0 ||
+      ioctl(fd, UI_DEV_CREATE) != 0)
+  {
+    DEBUG_ERROR("Failed to create the uinput device: %s", strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static void destroyDevice(int * fd)
+{
+  if (*fd < 0)
+    return;
+
+  ioctl(*fd, UI_DEV_DESTROY);
+  close(*fd);
+  *fd = -1;
+}
+
+bool os_initInput(void)
+{
+  uinput.rel = createDevice("Looking Glass Input", false);
+  if (uinput.rel < 0)
+    return false;
+
+  uinput.abs = createDevice("Looking Glass Tablet", true);
+  if (uinput.abs < 0)
+  {
+    destroyDevice(&uinput.rel);
+    return false;
+  }
+
+  return true;
+}
+
+void os_freeInput(void)
+{
+  destroyDevice(&uinput.abs);
+  destroyDevice(&uinput.rel);
+}
+
+static inline void emit(struct input_event * ev, unsigned int * n,
+    int type, int code, int value)
+{
+  ev[*n] = (struct input_event)
+  {
+    .type  = type,
+    .code  = code,
+    .value = value
+  };
+  ++*n;
+}
+
+static void flush(int fd, struct input_event * ev, unsigned int n)
+{
+  if (n && write(fd, ev, n * sizeof(*ev)) < 0)
+    DEBUG_WARN_RATELIMIT(1000, "uinput write failed: %s", strerror(errno));
+}
+
+void os_injectInput(const KVMFRInputEvent * events, unsigned int count)
+{
+  // at most three events plus a report per input event
+  static struct input_event ev[KVMFR_INPUT_QUEUE_LEN * 3];
+  unsigned int n  = 0;
+  int          fd = uinput.rel;
+
+  for(unsigned int i = 0; i < count; ++i)
+  {
+    const KVMFRInputEvent * e = &events[i];
+
+    /* the devices are read independently, so the pending events must be
+     * written out before switching to keep the queue order, otherwise a click
+     * could land before the move that preceded it */
+    const int target =
+      e->type == KVMFR_INPUT_POSITION ? uinput.abs : uinput.rel;
+    if (target != fd)
+    {
+      flush(fd, ev, n);
+      n  = 0;
+      fd = target;
+    }
+
+    switch(e->type)
+    {
+      case KVMFR_INPUT_MOTION:
+        if (e->x)
+          emit(ev, &n, EV_REL, REL_X, e->x);
+        if (e->y)
+          emit(ev, &n, EV_REL, REL_Y, e->y);
+        break;
+
+      case KVMFR_INPUT_POSITION:
+        emit(ev, &n, EV_ABS, ABS_X, clamp(e->x, 0, KVMFR_INPUT_ABS_MAX));
+        emit(ev, &n, EV_ABS, ABS_Y, clamp(e->y, 0, KVMFR_INPUT_ABS_MAX));
+        break;
+
+      case KVMFR_INPUT_BUTTON:
+        if (e->code == KVMFR_BUTTON_WHEEL_UP ||
+            e->code == KVMFR_BUTTON_WHEEL_DOWN)
+        {
+          if (!e->x)
+            continue;
+          emit(ev, &n, EV_REL, REL_WHEEL,
+              e->code == KVMFR_BUTTON_WHEEL_UP ? 1 : -1);
+        }
+        else if (e->code < ARRAY_LENGTH(buttonMap) && buttonMap[e->code])
+          emit(ev, &n, EV_KEY, buttonMap[e->code], e->x ? 1 : 0);
+        else
+          continue;
+        break;
+
+      case KVMFR_INPUT_KEY:
+        if (e->code < KEY_ESC || e->code > KEY_MICMUTE)
+          continue;
+        emit(ev, &n, EV_KEY, e->code, e->x ? 1 : 0);
+        break;
+
+      default:
+        continue;
+    }
+
+    emit(ev, &n, EV_SYN, SYN_REPORT, 0);
+  }
+
+  flush(fd, ev, n);
+}
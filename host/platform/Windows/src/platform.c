@@ -718,6 +718,155 @@ void os_setCursorPos(int x, int y)
   SetCursorPos(x, y);
 }
 
+/* SendInput only reaches the input desktop if the calling thread is attached
+ * to it, so like the mouse hook the input thread must follow it as it switches
+ * to the secure desktop for UAC prompts and the lock screen and back */
+static struct
+{
+  DWORD thread;
+  HDESK desktop;
+}
+inputDesktop = { 0 };
+
+bool os_initInput(void)
+{
+  return true;
+}
+
+void os_freeInput(void)
+{
+  if (inputDesktop.desktop)
+  {
+    CloseDesktop(inputDesktop.desktop);
+    inputDesktop.desktop = NULL;
+  }
+  inputDesktop.thread = 0;
+}
+
+static bool mapInput(const KVMFRInputEvent * event, INPUT * in)
+{
+  memset(in, 0, sizeof(*in));
+  switch(event->type)
+  {
+    case KVMFR_INPUT_MOTION:
+      in->type       = INPUT_MOUSE;
+      in->mi.dx      = event->x;
+      in->mi.dy      = event->y;
+      in->mi.dwFlags = MOUSEEVENTF_MOVE;
+      return true;
+
+    case KVMFR_INPUT_POSITION:
+      in->type       = INPUT_MOUSE;
+      in->mi.dx      = MulDiv(event->x, 65535, KVMFR_INPUT_ABS_MAX);
+      in->mi.dy      = MulDiv(event->y, 65535, KVMFR_INPUT_ABS_MAX);
+      in->mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE;
+      return true;
+
+    case KVMFR_INPUT_BUTTON:
+      in->type = INPUT_MOUSE;
+      switch(event->code)
+      {
+        case KVMFR_BUTTON_LEFT:
+          in->mi.dwFlags = event->x ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
+          return true;
+
+        case KVMFR_BUTTON_MIDDLE:
+          in->mi.dwFlags = event->x ?
+            MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
+          return true;
+
+        case KVMFR_BUTTON_RIGHT:
+          in->mi.dwFlags = event->x ?
+            MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
+          return true;
+
+        case KVMFR_BUTTON_WHEEL_UP:
+        case KVMFR_BUTTON_WHEEL_DOWN:
+          if (!event->x)
+            return false;
+          in->mi.dwFlags   = MOUSEEVENTF_WHEEL;
+          in->mi.mouseData = event->code == KVMFR_BUTTON_WHEEL_UP ?
+            WHEEL_DELTA : -WHEEL_DELTA;
+          return true;
+
+        case KVMFR_BUTTON_SIDE:
+        case KVMFR_BUTTON_EXTRA:
+          in->mi.dwFlags   = event->x ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+          in->mi.mouseData = event->code == KVMFR_BUTTON_SIDE ?
+            XBUTTON1 : XBUTTON2;
+          return true;
+      }
+      return false;
+
+    case KVMFR_INPUT_KEY:
+      // windows takes the PS/2 set 1 scancode the client provides in `y`
+      if (!event->y)
+        return false;
+      in->type       = INPUT_KEYBOARD;
+      in->ki.wScan   = event->y & 0xff;
+      in->ki.dwFlags = KEYEVENTF_SCANCODE;
+      if ((event->y & 0xff00) == 0xe000)
+        in->ki.dwFlags |= KEYEVENTF_EXTENDEDKEY;
+      if (!event->x)
+        in->ki.dwFlags |= KEYEVENTF_KEYUP;
+      return true;
+  }
+
+  return false;
+}
+
+static bool attachInputDesktop(void)
+{
+  HDESK desk = OpenInputDesktop(0, FALSE, GENERIC_ALL);
+  if (!desk)
+  {
+    DEBUG_WINERROR("Failed to OpenInputDesktop", GetLastError());
+    return false;
+  }
+
+  if (!SetThreadDesktop(desk))
+  {
+    DEBUG_WINERROR("Failed to SetThreadDesktop", GetLastError());
+    CloseDesktop(desk);
+    return false;
+  }
+
+  if (inputDesktop.desktop)
+    CloseDesktop(inputDesktop.desktop);
+
+  inputDesktop.thread  = GetCurrentThreadId();
+  inputDesktop.desktop = desk;
+  return true;
+}
+
+void os_injectInput(const KVMFRInputEvent * events, unsigned int count)
+{
+  INPUT inputs[KVMFR_INPUT_QUEUE_LEN];
+  unsigned int n = 0;
+
+  for(unsigned int i = 0; i < count; ++i)
+    if (mapInput(&events[i], &inputs[n]))
+      ++n;
+
+  if (!n)
+    return;
+
+  // the input thread is recreated when LGMP is reinitialized
+  if (inputDesktop.thread != GetCurrentThreadId())
+    attachInputDesktop();
+
+  unsigned int sent = SendInput(n, inputs, sizeof(*inputs));
+  if (sent == n)
+    return;
+
+  // the input desktop has likely switched, follow it and send the remainder
+  if (attachInputDesktop())
+    sent += SendInput(n - sent, inputs + sent, sizeof(*inputs));
+
+  if (sent != n)
+    DEBUG_WARN_RATELIMIT(1000, "SendInput failed: 0x%lx", GetLastError());
+}
+
 KVMFROS os_getKVMFRType(void)
 {
   return KVMFR_OS_WINDOWS;
@@ -35,6 +35,9 @@
 #include "common/cpuinfo.h"
 #include "common/util.h"
 #include "common/array.h"
+#include "common/metrics.h"
+#include "input.h"
+#include "governor.h"
 
 #include <lgmp/host.h>
 
@@ -86,6 +89,9 @@ struct app
   PLGMPHost lgmp;
   void *ivshmemBase;
 
+  bool     inputEnabled;
+  uint32_t inputOffset;
+
   PLGMPHostQueue pointerQueue;
   PLGMPMemory    pointerMemory[LGMP_Q_POINTER_LEN];
   PLGMPMemory    pointerShapeMemory[POINTER_SHAPE_BUFFERS];
@@ -116,6 +122,16 @@ struct app
   LGTimer  * lgmpTimer;
   LGThread * frameThread;
   bool threadsStarted;
+
+  struct
+  {
+    LGMetric * capture;
+    LGMetric * copy;
+    LGMetric * post;
+    LGMetric * frames;
+    LGMetric * timeouts;
+  }
+  metrics;
 };
 
 static struct app app;
@@ -162,6 +178,27 @@ static struct Option options[] =
     .type           = OPTION_TYPE_INT,
     .value.x_int    = 0,
   },
+  {
+    .module         = "app",
+    .name           = "idleFPS",
+    .description    = "The capture rate to slow down to while the screen is static and input is seen (0 = disable)",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 10,
+  },
+  {
+    .module         = "app",
+    .name           = "input",
+    .description    = "Accept input from the client over the shared memory",
+    .type           = OPTION_TYPE_BOOL,
+    .value.x_bool   = true,
+  },
+  {
+    .module         = "app",
+    .name           = "metricsFile",
+    .description    = "Write performance metrics to this file in the Prometheus format",
+    .type           = OPTION_TYPE_STRING,
+    .value.x_string = "",
+  },
   {0}
 };
 
@@ -351,22 +388,29 @@ static bool sendFrame(CaptureResult result, bool * restart)
   memcpy(fi->damageRects, frame.damageRects,
     frame.damageRectsCount * sizeof(FrameDamageRect));
 
+  governor_frame(&frame);
+
   app.frameValid = true;
 
   framebuffer_prepare(app.frameBuffer[app.captureIndex]);
 
   /* we post and then get the frame, this is intentional! */
+  uint64_t start = nanotime();
   if ((status = lgmpHostQueuePost(app.frameQueue, 0,
     app.frameMemory[app.captureIndex])) != LGMP_OK)
   {
     DEBUG_ERROR("%s", lgmpStatusString(status));
     return true;
   }
+  metrics_observe(app.metrics.post, nanotime() - start);
+  metrics_inc(app.metrics.frames);
 
+  start = nanotime();
   app.iface->getFrame(
     app.captureIndex,
     app.frameBuffer[app.captureIndex],
     app.maxFrameSize);
+  metrics_observe(app.metrics.copy, nanotime() - start);
 
   app.readIndex = app.captureIndex;
   if (++app.captureIndex == LGMP_Q_FRAME_LEN)
@@ -585,6 +629,10 @@ void capturePostPointerBuffer(const CapturePointer * pointer)
 
   memcpy(&app.pointerInfo, pointer, sizeof(CapturePointer));
 
+  // pointer movement usually comes with hover effects
+  if (pointer->positionUpdate)
+    governor_activity();
+
   /* if there was not a position update, restore the x & y */
   if (!pointer->positionUpdate)
   {
@@ -602,6 +650,8 @@ static void lgmpShutdown(void)
   if (app.lgmpTimer)
     lgTimerDestroy(app.lgmpTimer);
 
+  input_stop();
+
   for(int i = 0; i < LGMP_Q_FRAME_LEN; ++i)
     lgmpHostMemFree(&app.frameMemory[i]);
   for(int i = 0; i < LGMP_Q_POINTER_LEN; ++i)
@@ -658,7 +708,9 @@ static bool newKVMFRData(KVMFRUserData * dst)
     {
       .magic    = KVMFR_MAGIC,
       .version  = KVMFR_VERSION,
-      .features = os_hasSetCursorPos() ? KVMFR_FEATURE_SETCURSORPOS : 0
+      .features =
+        (os_hasSetCursorPos() ? KVMFR_FEATURE_SETCURSORPOS : 0) |
+        (app.inputEnabled     ? KVMFR_FEATURE_INPUT        : 0)
     };
     strncpy(kvmfr.hostver, BUILD_VERSION, sizeof(kvmfr.hostver) - 1);
     if (!appendData(dst, &kvmfr, sizeof(kvmfr)))
@@ -720,17 +772,45 @@ static bool newKVMFRData(KVMFRUserData * dst)
       return false;
   }
 
+  if (app.inputEnabled)
+  {
+    KVMFRRecord_Input input =
+    {
+      .offset = app.inputOffset,
+      .size   = sizeof(KVMFRInputQueue)
+    };
+
+    KVMFRRecord record =
+    {
+      .type = KVMFR_RECORD_INPUT,
+      .size = sizeof(input)
+    };
+
+    if (!appendData(dst, &record, sizeof(record)) ||
+        !appendData(dst, &input , sizeof(input )))
+      return false;
+  }
+
   return true;
 }
 
 static bool lgmpSetup(struct IVSHMEM * shmDev)
 {
+  /* the input queue is placed at the end of the shared memory outside of LGMP
+   * so that its location is known before LGMP is initialized */
+  size_t lgmpSize = shmDev->size;
+  if (app.inputEnabled)
+  {
+    lgmpSize -= ALIGN_TO(sizeof(KVMFRInputQueue), app.alignSize);
+    app.inputOffset = lgmpSize;
+  }
+
   KVMFRUserData udata = { 0 };
   if (!newKVMFRData(&udata))
     goto fail_init;
 
   LGMP_STATUS status;
-  if ((status = lgmpHostInit(shmDev->mem, shmDev->size, &app.lgmp,
+  if ((status = lgmpHostInit(shmDev->mem, lgmpSize, &app.lgmp,
           udata.used, udata.data)) != LGMP_OK)
   {
     DEBUG_ERROR("lgmpHostInit Failed: %s", lgmpStatusString(status));
@@ -799,6 +879,16 @@ static bool lgmpSetup(struct IVSHMEM * shmDev)
     goto fail_lgmp;
   }
 
+  if (app.inputEnabled)
+  {
+    if (!input_start((KVMFRInputQueue *)
+          ((uint8_t *)shmDev->mem + app.inputOffset)))
+      goto fail_lgmp;
+
+    // LGMP may be reinitialized while a client is connected
+    input_setActive(app.state == APP_STATE_RUNNING);
+  }
+
   free(udata.data);
   return true;
 
@@ -888,12 +978,40 @@ int app_main(int argc, char * argv[])
   DEBUG_INFO("Max Pointer Size : %u KiB", (unsigned int)MAX_POINTER_SIZE / 1024);
   DEBUG_INFO("KVMFR Version    : %u", KVMFR_VERSION);
 
+  app.metrics.capture  = metrics_histogram("lg_host_capture_seconds",
+      "Time spent in the capture interface waiting for a frame");
+  app.metrics.copy     = metrics_histogram("lg_host_frame_copy_seconds",
+      "Time taken to copy a captured frame into shared memory");
+  app.metrics.post     = metrics_histogram("lg_host_frame_post_seconds",
+      "Time taken to post a frame to the LGMP queue");
+  app.metrics.frames   = metrics_counter("lg_host_frames_total",
+      "Frames sent to the client");
+  app.metrics.timeouts = metrics_counter("lg_host_capture_timeouts_total",
+      "Captures that timed out without a new frame");
+
+  const char * metricsFile = option_get_string("app", "metricsFile");
+  if (*metricsFile)
+  {
+    if (metrics_startExport(metricsFile, 1000))
+      DEBUG_INFO("Metrics File     : %s", metricsFile);
+    else
+      DEBUG_WARN("Failed to start exporting metrics to %s", metricsFile);
+  }
+
   app.alignSize         = sysinfo_getPageSize();
   app.frameValid        = false;
   app.pointerShapeValid = false;
 
-  int throttleFps = option_get_int("app", "throttleFPS");
-  int throttleUs = throttleFps ? 1000000 / throttleFps : 0;
+  app.inputEnabled = option_get_bool("app", "input") && os_initInput();
+  DEBUG_INFO("Input Injection  : %s", app.inputEnabled ? "yes" : "no");
+
+  if (!governor_init(
+        max(0, option_get_int("app", "throttleFPS")),
+        max(0, option_get_int("app", "idleFPS"))))
+  {
+    exitcode = LG_HOST_EXIT_FATAL;
+    goto fail_ivshmem;
+  }
   uint64_t previousFrameTime = 0;
 
   {
@@ -996,9 +1114,11 @@ int app_main(int argc, char * argv[])
           goto fail;
         }
         setAppState(APP_STATE_RUNNING);
+        input_setActive(true);
         break;
 
       case APP_STATE_TRANSITION_TO_IDLE:
+        input_setActive(false);
         if (!stopThreads() || !captureStop())
         {
           exitcode = LG_HOST_EXIT_FAILED;
@@ -1025,24 +1145,24 @@ int app_main(int argc, char * argv[])
           LG_UNLOCK(app.pointerLock);
         }
 
-        const uint64_t delta = microtime() - previousFrameTime;
-        if (delta < throttleUs)
-        {
-          const uint64_t us = throttleUs - delta;
-          // only delay if the time is reasonable
-          if (us > 1000)
-            nsleep(us * 1000);
-        }
+        governor_wait(previousFrameTime,
+            lgmpHostQueuePending(app.frameQueue),
+            input_getDisplayRate());
 
         const uint64_t captureStartTime = microtime();
+        const uint64_t captureStartNs   = nanotime();
 
         const CaptureResult result = app.iface->capture(
           app.captureIndex, app.frameBuffer[app.captureIndex]);
 
         if (likely(result == CAPTURE_RESULT_OK))
+        {
           previousFrameTime = captureStartTime;
+          metrics_observe(app.metrics.capture, nanotime() - captureStartNs);
+        }
         else if (likely(result == CAPTURE_RESULT_TIMEOUT))
         {
+          metrics_inc(app.metrics.timeouts);
           if (!app.iface->asyncCapture)
             if (unlikely(app.frameValid &&
                   lgmpHostQueueNewSubs(app.frameQueue) > 0))
@@ -1094,11 +1214,15 @@ fail:
   app.iface->free();
 
   LG_LOCK_FREE(app.pointerLock);
+  lgLockStatsDump();
 
 fail_lgmp:
   lgmpShutdown();
 
 fail_ivshmem:
+  governor_free();
+  metrics_stopExport();
+  os_freeInput();
   ivshmemClose(&shmDev);
   ivshmemFree(&shmDev);
   DEBUG_INFO("Host application exited");
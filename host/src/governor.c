@@ -0,0 +1,194 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "governor.h"
+#include "common/debug.h"
+#include "common/event.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <stdatomic.h>
+
+// how long without activity before the rate starts to drop, in us
+#define GOVERNOR_ACTIVE_TIME 500000ULL
+
+/* the interval grows by a quarter every capture once idle, starting from at
+ * least this many us so that an unlimited rate still ramps down */
+#define GOVERNOR_RAMP_START  1000ULL
+
+// waits shorter than this in us are not worth sleeping for
+#define GOVERNOR_MIN_SLEEP   1000ULL
+
+/* the display rate is written by the client in mHz, values outside of this
+ * range are not plausible and are ignored */
+#define GOVERNOR_MIN_DISPLAY_RATE 24000U
+#define GOVERNOR_MAX_DISPLAY_RATE 1000000U
+
+static struct
+{
+  uint64_t minInterval;
+  uint64_t idleInterval;
+  uint64_t interval;
+
+  atomic_bool       idle;
+  atomic_bool       inputSeen;
+  _Atomic(uint64_t) lastActive;
+  LGEvent         * wakeEvent;
+}
+gov = { 0 };
+
+bool governor_init(unsigned int maxFps, unsigned int idleFps)
+{
+  gov.minInterval  = maxFps  ? 1000000ULL / maxFps  : 0;
+  gov.idleInterval = idleFps ? 1000000ULL / idleFps : 0;
+  gov.interval     = gov.minInterval;
+  atomic_store(&gov.idle, false);
+  atomic_store(&gov.inputSeen, false);
+  atomic_store(&gov.lastActive, microtime());
+
+  if (gov.idleInterval && gov.idleInterval < gov.minInterval)
+    gov.idleInterval = gov.minInterval;
+
+  gov.wakeEvent = lgCreateEvent(true, 0);
+  if (!gov.wakeEvent)
+  {
+    DEBUG_ERROR("Failed to create the governor wake event");
+    return false;
+  }
+
+  return true;
+}
+
+void governor_free(void)
+{
+  if (gov.wakeEvent)
+  {
+    lgFreeEvent(gov.wakeEvent);
+    gov.wakeEvent = NULL;
+  }
+}
+
+void governor_activity(void)
+{
+  atomic_store_explicit(&gov.lastActive, microtime(), memory_order_relaxed);
+  if (atomic_load_explicit(&gov.idle, memory_order_relaxed))
+    lgSignalEvent(gov.wakeEvent);
+}
+
+void governor_input(void)
+{
+  atomic_store_explicit(&gov.inputSeen, true, memory_order_relaxed);
+  governor_activity();
+}
+
+void governor_resetInput(void)
+{
+  atomic_store_explicit(&gov.inputSeen, false, memory_order_relaxed);
+}
+
+void governor_frame(const CaptureFrame * frame)
+{
+  // no damage rects means the whole frame changed
+  if (frame->damageRectsCount == 0)
+  {
+    governor_activity();
+    return;
+  }
+
+  /* even a tiny change such as a typed character is activity, it may be the
+   * response to input that was not seen here */
+  for(uint32_t i = 0; i < frame->damageRectsCount; ++i)
+    if (frame->damageRects[i].width && frame->damageRects[i].height)
+    {
+      governor_activity();
+      return;
+    }
+}
+
+static uint64_t activeInterval(uint32_t displayRate)
+{
+  /* there is no point capturing faster than the client can display, but
+   * allow some headroom so that jitter in the guest does not drop frames */
+  uint64_t interval = gov.minInterval;
+  if (displayRate >= GOVERNOR_MIN_DISPLAY_RATE &&
+      displayRate <= GOVERNOR_MAX_DISPLAY_RATE)
+    interval = max(interval, 1000000000ULL / displayRate * 7 / 8);
+  return interval;
+}
+
+static uint64_t nextInterval(uint32_t pending, uint32_t displayRate)
+{
+  const uint64_t active = activeInterval(displayRate);
+  const uint64_t quiet  = microtime() -
+    atomic_load_explicit(&gov.lastActive, memory_order_relaxed);
+
+  /* without input from the client there is no telling if the user is
+   * waiting on a change that has yet to come, so never idle */
+  uint64_t interval;
+  if (!gov.idleInterval || quiet < GOVERNOR_ACTIVE_TIME ||
+      !atomic_load_explicit(&gov.inputSeen, memory_order_relaxed))
+  {
+    interval = active;
+    atomic_store_explicit(&gov.idle, false, memory_order_relaxed);
+  }
+  else
+  {
+    interval = max(gov.interval, max(active, GOVERNOR_RAMP_START));
+    interval = min(interval + interval / 4, max(gov.idleInterval, active));
+    atomic_store_explicit(&gov.idle, true, memory_order_relaxed);
+  }
+
+  /* the client is still working on earlier frames, wait a frame longer for
+   * each one as capturing now would only replace a frame it has not shown */
+  if (pending > 1)
+  {
+    const uint64_t backoff = (pending - 1) * max(active, GOVERNOR_RAMP_START);
+    interval = max(interval, gov.idleInterval ?
+        min(backoff, gov.idleInterval) : backoff);
+  }
+
+  gov.interval = interval;
+  return interval;
+}
+
+void governor_wait(uint64_t lastCapture, uint32_t pending,
+    uint32_t displayRate)
+{
+  uint64_t interval = nextInterval(pending, displayRate);
+  while(true)
+  {
+    const uint64_t delta = microtime() - lastCapture;
+    if (delta + GOVERNOR_MIN_SLEEP >= interval)
+      return;
+
+    const uint64_t us = interval - delta;
+    if (!atomic_load_explicit(&gov.idle, memory_order_relaxed))
+    {
+      nsleep(us * 1000);
+      return;
+    }
+
+    // only activity can cut an idle wait short
+    if (!lgWaitEvent(gov.wakeEvent, us / 1000))
+      return;
+
+    interval = nextInterval(pending, displayRate);
+  }
+}
@@ -0,0 +1,165 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "input.h"
+#include "governor.h"
+#include "interface/platform.h"
+#include "common/debug.h"
+#include "common/event.h"
+#include "common/thread.h"
+#include "common/time.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+/* there is no way for the client to signal us so the queue is polled while a
+ * client is connected, quickly while input is arriving and more slowly the
+ * longer it has been idle. Without a client the thread sleeps until woken */
+#define INPUT_ACTIVE_TIME   1000000ULL  // us
+#define INPUT_IDLE_TIME     10000000ULL // us
+#define INPUT_POLL_ACTIVE   250000ULL   // ns
+#define INPUT_POLL_IDLE     4000000ULL  // ns
+#define INPUT_POLL_SLEEP    16000000ULL // ns
+
+static struct
+{
+  KVMFRInputQueue * queue;
+  LGThread        * thread;
+  LGEvent         * wakeEvent;
+  atomic_bool       running;
+  atomic_bool       active;
+}
+input = { 0 };
+
+static int inputThread(void * opaque)
+{
+  static KVMFRInputEvent events[KVMFR_INPUT_QUEUE_LEN];
+  KVMFRInputQueue * queue = input.queue;
+  uint64_t lastEvent = 0;
+
+  while(atomic_load_explicit(&input.running, memory_order_relaxed))
+  {
+    if (!atomic_load_explicit(&input.active, memory_order_relaxed))
+    {
+      lgWaitEvent(input.wakeEvent, TIMEOUT_INFINITE);
+
+      // a new client is likely to send input soon
+      lastEvent = microtime();
+      continue;
+    }
+
+    const uint32_t rpos  = queue->rpos;
+    const uint32_t wpos  = queue->wpos;
+    const uint32_t count = wpos - rpos;
+
+    if (count == 0)
+    {
+      const uint64_t idle = microtime() - lastEvent;
+      nsleep(idle < INPUT_ACTIVE_TIME ? INPUT_POLL_ACTIVE :
+             idle < INPUT_IDLE_TIME   ? INPUT_POLL_IDLE   : INPUT_POLL_SLEEP);
+      continue;
+    }
+
+    if (count > KVMFR_INPUT_QUEUE_LEN)
+    {
+      DEBUG_WARN("Input queue overrun, discarding %u events", count);
+      queue->rpos = wpos;
+      continue;
+    }
+
+    // the events must be read only after wpos shows they have been written
+    atomic_thread_fence(memory_order_acquire);
+    for(uint32_t i = 0; i < count; ++i)
+      memcpy(&events[i],
+          &queue->events[(rpos + i) % KVMFR_INPUT_QUEUE_LEN],
+          sizeof(*events));
+
+    // and the slots handed back only after they have been read
+    atomic_thread_fence(memory_order_release);
+    queue->rpos = wpos;
+
+    os_injectInput(events, count);
+    governor_input();
+    lastEvent = microtime();
+  }
+
+  return 0;
+}
+
+bool input_start(KVMFRInputQueue * queue)
+{
+  memset(queue, 0, sizeof(*queue));
+  input.queue = queue;
+  governor_resetInput();
+
+  input.wakeEvent = lgCreateEvent(true, 0);
+  if (!input.wakeEvent)
+  {
+    DEBUG_ERROR("Failed to create the input wake event");
+    return false;
+  }
+
+  atomic_store(&input.active , false);
+  atomic_store(&input.running, true );
+  if (!lgCreateThread("InputThread", inputThread, NULL, &input.thread))
+  {
+    DEBUG_ERROR("Failed to create the input thread");
+    atomic_store(&input.running, false);
+    lgFreeEvent(input.wakeEvent);
+    input.wakeEvent = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void input_setActive(bool active)
+{
+  if (!input.thread ||
+      atomic_exchange(&input.active, active) == active)
+    return;
+
+  if (active)
+  {
+    // a new client may not send input at all
+    governor_resetInput();
+    lgSignalEvent(input.wakeEvent);
+  }
+}
+
+uint32_t input_getDisplayRate(void)
+{
+  KVMFRInputQueue * queue = input.queue;
+  return queue ? queue->displayRate : 0;
+}
+
+void input_stop(void)
+{
+  if (!input.thread)
+    return;
+
+  atomic_store(&input.running, false);
+  lgSignalEvent(input.wakeEvent);
+  lgJoinThread(input.thread, NULL);
+  lgFreeEvent(input.wakeEvent);
+  input.thread    = NULL;
+  input.wakeEvent = NULL;
+  input.queue     = NULL;
+}
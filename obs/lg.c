@@ -30,11 +30,13 @@
 #include <common/ivshmem.h>
 #include <common/KVMFR.h>
 #include <common/framebuffer.h>
+#include <common/rects.h>
 #include <lgmp/client.h>
 
 #include <stdio.h>
 #include <unistd.h>
 #include <stdatomic.h>
+#include <pthread.h>
 #include <GL/gl.h>
 
 #include "rgb24.effect.h"
@@ -77,10 +79,13 @@ typedef struct
   obs_source_t       * context;
   LGState              state;
   char               * shmFile;
+  unsigned int         pollInterval;
+  bool                 formatValid;
   uint32_t             formatVer;
   uint32_t             screenWidth, screenHeight;
   uint32_t             dataWidth, dataHeight;
   uint32_t             frameWidth, frameHeight;
+  uint32_t             pitch;
   enum gs_color_format format;
   bool                 unpack;
   uint32_t             drmFormat;
@@ -94,12 +99,14 @@ typedef struct
   gs_texture_t       * dstTexture;
   uint8_t            * texData;
   uint32_t             linesize;
+  bool                 fullCopy;
 
   bool                 hideMouse;
 #if LIBOBS_API_MAJOR_VER >= 27
   bool                 dmabuf;
   bool                 dmabufTested;
   DMAFrameInfo         dmaInfo[LGMP_Q_FRAME_LEN];
+  DMAFrameInfo       * dmaFrame;
   gs_texture_t       * dmaTexture;
 #endif
 
@@ -108,7 +115,12 @@ typedef struct
 #endif
 
   pthread_t            frameThread, pointerThread;
-  os_sem_t           * frameSem;
+
+  /* frame hand-off between the frame thread and the video tick */
+  pthread_mutex_t      frameLock;
+  bool                 formatPending;
+  KVMFRFrame           pendingFormat;
+  bool                 newFrame;
 
   bool                 cursorMono;
   gs_texture_t       * cursorTex;
@@ -131,6 +143,7 @@ LGPlugin;
 
 static void * frameThread(void * data);
 static void * pointerThread(void * data);
+static bool lgProcessFrame(LGPlugin * this, LGMPMessage * msg);
 static void lgUpdate(void * data, obs_data_t * settings);
 
 static const char * lgGetName(void * unused)
@@ -164,7 +177,7 @@ static void * lgCreate(obs_data_t * settings, obs_source_t * context)
       this->unpackEffect, "swap"      );
   obs_leave_graphics();
 
-  os_sem_init (&this->frameSem , 0);
+  pthread_mutex_init(&this->frameLock, NULL);
   os_sem_init (&this->cursorSem, 1);
   atomic_store(&this->cursorVer, 0);
   lgUpdate(this, settings);
@@ -206,7 +219,7 @@ static void deinit(LGPlugin * this)
     case STATE_OPEN:
 #if LIBOBS_API_MAJOR_VER >= 27
       for (int i = 0 ; i < ARRAY_LENGTH(this->dmaInfo); ++i)
-        if (this->dmaInfo[i].fd >= 0)
+        if (this->dmaInfo[i].frame && this->dmaInfo[i].fd >= 0)
         {
           close(this->dmaInfo[i].fd);
           this->dmaInfo[i].fd = -1;
@@ -241,6 +254,7 @@ static void deinit(LGPlugin * this)
       gs_texture_unmap(this->texture);
     gs_texture_destroy(this->texture);
     this->texture = NULL;
+    this->texData = NULL;
   }
 
   if (this->cursorTex)
@@ -256,19 +270,24 @@ static void deinit(LGPlugin * this)
       gs_texture_destroy(this->dmaInfo[i].texture);
       this->dmaInfo[i].texture = NULL;
     }
+  memset(this->dmaInfo, 0, sizeof(this->dmaInfo));
+  this->dmaFrame   = NULL;
   this->dmaTexture = NULL;
 #endif
 
   obs_leave_graphics();
 
-  this->state = STATE_STOPPED;
+  this->formatValid   = false;
+  this->formatPending = false;
+  this->newFrame      = false;
+  this->state         = STATE_STOPPED;
 }
 
 static void lgDestroy(void * data)
 {
   LGPlugin * this = (LGPlugin *)data;
   deinit(this);
-  os_sem_destroy(this->frameSem );
+  pthread_mutex_destroy(&this->frameLock);
   os_sem_destroy(this->cursorSem);
 
   obs_enter_graphics();
@@ -281,6 +300,7 @@ static void lgDestroy(void * data)
 static void lgGetDefaults(obs_data_t * defaults)
 {
   obs_data_set_default_string(defaults, "shmFile", "/dev/kvmfr0");
+  obs_data_set_default_int(defaults, "pollInterval", 1000);
 #if LIBOBS_API_MAJOR_VER >= 27
   obs_data_set_default_bool(defaults, "dmabuf", true);
 #endif
@@ -294,6 +314,8 @@ static obs_properties_t * lgGetProperties(void * data)
       obs_module_text("SHM File"), OBS_TEXT_DEFAULT);
   obs_properties_add_bool(props, "hideMouse",
       obs_module_text("Hide mouse cursor"));
+  obs_properties_add_int(props, "pollInterval",
+      obs_module_text("Frame poll interval (microseconds)"), 50, 10000, 50);
 #if LIBOBS_API_MAJOR_VER >= 27
   obs_properties_add_bool(props, "dmabuf",
       obs_module_text("Use DMABUF import (requires kvmfr device)"));
@@ -318,24 +340,28 @@ static void * frameThread(void * data)
   }
 
   this->state = STATE_RUNNING;
-  os_sem_post(this->frameSem);
 
   while(this->state == STATE_RUNNING)
   {
     LGMP_STATUS status;
+    LGMPMessage msg;
 
-    os_sem_wait(this->frameSem);
-    if ((status = lgmpClientAdvanceToLast(this->frameQueue)) != LGMP_OK)
+    if ((status = lgmpClientProcess(this->frameQueue, &msg)) != LGMP_OK)
     {
       if (status != LGMP_ERR_QUEUE_EMPTY)
       {
-        os_sem_post(this->frameSem);
-        printf("lgmpClientAdvanceToLast: %s\n", lgmpStatusString(status));
+        printf("lgmpClientProcess: %s\n", lgmpStatusString(status));
         break;
       }
+
+      usleep(this->pollInterval);
+      continue;
     }
-    os_sem_post(this->frameSem);
-    usleep(1000);
+
+    if (!lgProcessFrame(this, &msg))
+      break;
+
+    lgmpClientMessageDone(this->frameQueue);
   }
 
   lgmpClientUnsubscribe(&this->frameQueue);
@@ -479,7 +505,8 @@ static void lgUpdate(void * data, obs_data_t * settings)
   if (!ivshmemOpenDev(&this->shmDev, this->shmFile))
     return;
 
-  this->hideMouse = obs_data_get_bool(settings, "hideMouse") ? 1 : 0;
+  this->hideMouse    = obs_data_get_bool(settings, "hideMouse") ? 1 : 0;
+  this->pollInterval = obs_data_get_int (settings, "pollInterval");
 #if LIBOBS_API_MAJOR_VER >= 27
   this->dmabuf = obs_data_get_bool(settings, "dmabuf") &&
     ivshmemHasDMA(&this->shmDev);
@@ -530,7 +557,11 @@ static DMAFrameInfo * dmabufOpenDMAFrameInfo(LGPlugin * this, LGMPMessage * msg,
   {
     if (fi->texture)
     {
+      obs_enter_graphics();
+      if (this->dmaTexture == fi->texture)
+        this->dmaTexture = NULL;
       gs_texture_destroy(fi->texture);
+      obs_leave_graphics();
       fi->texture = NULL;
     }
     close(fi->fd);
@@ -570,8 +601,8 @@ static DMAFrameInfo * dmabufOpenDMAFrameInfo(LGPlugin * this, LGMPMessage * msg,
 }
 #endif
 
-static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame,
-    LGMPMessage * msg)
+/* must be called with frameLock held */
+static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame)
 {
   this->formatVer    = frame->formatVer;
   this->screenWidth  = frame->screenWidth;
@@ -599,10 +630,13 @@ static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame,
 
     gs_texture_destroy(this->texture);
     this->texture = NULL;
+    this->texData = NULL;
   }
 
-  this->dataWidth = frame->dataWidth;
-  this->unpack    = false;
+  this->dataWidth   = frame->dataWidth;
+  this->pitch       = frame->pitch;
+  this->unpack      = false;
+  this->formatValid = false;
 
   this->bpp = 4;
   switch(this->type)
@@ -656,44 +690,10 @@ static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame,
 
     default:
       printf("invalid type %d\n", this->type);
-      lgmpClientMessageDone(this->frameQueue);
-      os_sem_post(this->frameSem);
       obs_leave_graphics();
       return;
   }
 
-#if LIBOBS_API_MAJOR_VER >= 27
-  if (this->dmabuf)
-  {
-    DMAFrameInfo * fi = dmabufOpenDMAFrameInfo(this, msg, frame,
-        frame->frameHeight * frame->pitch);
-    if (fi && !fi->texture)
-    {
-      // create the first texture now so we can test if dmabuf is usable
-      fi->texture = gs_texture_create_from_dmabuf(
-        this->dataWidth,
-        this->dataHeight,
-        this->drmFormat,
-        this->format,
-        1,
-        &fi->fd,
-        &(uint32_t) { frame->pitch },
-        &(uint32_t) { 0 },
-        &(uint64_t) { 0 });
-
-      if (!fi->texture)
-      {
-        puts("Failed to create dmabuf texture");
-        this->dmabuf = false;
-      }
-
-      this->dmabufTested = true;
-    }
-  }
-#else
-  (void)drmFormat;
-#endif
-
   if (!this->dmabuf)
   {
     this->texture = gs_texture_create(
@@ -707,8 +707,6 @@ static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame,
     if (!this->texture)
     {
       printf("create texture failed\n");
-      lgmpClientMessageDone(this->frameQueue);
-      os_sem_post(this->frameSem);
       obs_leave_graphics();
       return;
     }
@@ -729,6 +727,111 @@ static void lgFormatInit(LGPlugin * this, const KVMFRFrame * frame,
   }
 
   obs_leave_graphics();
+
+  this->formatValid = true;
+  this->fullCopy    = true;
+}
+
+/**
+ * Called from the frame thread for every new frame message. Any waiting on the
+ * host and any CPU copy is done here so that the video tick only has to pick
+ * up the result.
+ *
+ * Returns false if the frame thread should stop.
+ */
+static bool lgProcessFrame(LGPlugin * this, LGMPMessage * msg)
+{
+  const KVMFRFrame * frame = (const KVMFRFrame *)msg->mem;
+  FrameBuffer * fb = (FrameBuffer *)(((uint8_t*)frame) + frame->offset);
+
+  pthread_mutex_lock(&this->frameLock);
+
+  if (!this->formatValid || this->formatVer != frame->formatVer)
+  {
+    /* textures can only be created by the video tick, hand the format over and
+     * hold on to the message until it has been applied */
+    memcpy(&this->pendingFormat, frame, sizeof(this->pendingFormat));
+    this->formatPending = true;
+    pthread_mutex_unlock(&this->frameLock);
+
+    while(this->formatPending && this->state == STATE_RUNNING)
+      usleep(this->pollInterval);
+
+    if (this->state != STATE_RUNNING)
+      return false;
+
+    pthread_mutex_lock(&this->frameLock);
+    if (!this->formatValid)
+    {
+      pthread_mutex_unlock(&this->frameLock);
+      return true;
+    }
+  }
+
+#if LIBOBS_API_MAJOR_VER >= 27
+  if (this->dmabuf)
+  {
+    DMAFrameInfo * fi = dmabufOpenDMAFrameInfo(this, msg, frame,
+        frame->frameHeight * frame->pitch);
+
+    if (fi)
+    {
+      // wait for the frame to be complete before we hand it over
+      framebuffer_wait(fb, frame->frameHeight * frame->pitch);
+      this->dmaFrame = fi;
+      this->newFrame = true;
+    }
+
+    pthread_mutex_unlock(&this->frameLock);
+    return true;
+  }
+#endif
+
+  if (!this->texData)
+  {
+    pthread_mutex_unlock(&this->frameLock);
+    return true;
+  }
+
+  /* the texture stays mapped between ticks and the GL backend does not orphan
+   * the unpack buffer, so only the regions that changed since the last frame
+   * need to be copied. Packed formats are not damage aware as the rects are in
+   * unpacked pixel coordinates. */
+  if (this->fullCopy || this->unpack || frame->damageRectsCount == 0)
+  {
+    framebuffer_read(
+        fb,
+        this->texData   , // dst
+        this->linesize  , // dstpitch
+        this->dataHeight, // height
+        this->dataWidth , // width
+        this->bpp       , // bpp
+        frame->pitch
+    );
+    this->fullCopy = false;
+  }
+  else
+  {
+    FrameDamageRect rects[KVMFR_MAX_DAMAGE_RECTS];
+    int count = frame->damageRectsCount;
+    memcpy(rects, frame->damageRects, count * sizeof(*rects));
+    count = rectsMergeOverlapping(rects, count);
+
+    rectsFramebufferToBuffer(
+        rects,
+        count,
+        this->bpp,
+        this->texData,
+        this->linesize,
+        this->dataHeight,
+        fb,
+        frame->pitch
+    );
+  }
+
+  this->newFrame = true;
+  pthread_mutex_unlock(&this->frameLock);
+  return true;
 }
 
 static void lgVideoTick(void * data, float seconds)
@@ -745,16 +848,6 @@ static void lgVideoTick(void * data, float seconds)
   if (this->state != STATE_RUNNING)
     return;
 
-  LGMP_STATUS status;
-  LGMPMessage msg;
-
-  os_sem_wait(this->frameSem);
-  if (this->state != STATE_RUNNING)
-  {
-    os_sem_post(this->frameSem);
-    return;
-  }
-
   this->cursorRect.x = this->cursor.x;
   this->cursorRect.y = this->cursor.y;
 
@@ -813,42 +906,28 @@ static void lgVideoTick(void * data, float seconds)
     os_sem_post(this->cursorSem);
   }
 
-  if ((status = lgmpClientAdvanceToLast(this->frameQueue)) != LGMP_OK)
+  /* never wait on the frame thread, if it is busy with a frame it will be
+   * picked up on the next tick */
+  if (pthread_mutex_trylock(&this->frameLock) != 0)
+    return;
+
+  if (this->formatPending)
   {
-    if (status != LGMP_ERR_QUEUE_EMPTY)
-    {
-      os_sem_post(this->frameSem);
-      printf("lgmpClientAdvanceToLast: %s\n", lgmpStatusString(status));
-      return;
-    }
+    lgFormatInit(this, &this->pendingFormat);
+    this->formatPending = false;
   }
 
-  if ((status = lgmpClientProcess(this->frameQueue, &msg)) != LGMP_OK)
+  if (!this->newFrame)
   {
-    if (status == LGMP_ERR_QUEUE_EMPTY)
-    {
-      os_sem_post(this->frameSem);
-      return;
-    }
-
-    printf("lgmpClientProcess: %s\n", lgmpStatusString(status));
-    this->state = STATE_STOPPING;
-    os_sem_post(this->frameSem);
+    pthread_mutex_unlock(&this->frameLock);
     return;
   }
-
-  const KVMFRFrame * frame = (KVMFRFrame *)msg.mem;
-
-  bool textureValid = (this->dmabufTested && this->dmabuf) || this->texture;
-  if (!textureValid || this->formatVer != frame->formatVer)
-    lgFormatInit(this, frame, &msg);
+  this->newFrame = false;
 
 #if LIBOBS_API_MAJOR_VER >= 27
   if (this->dmabuf)
   {
-    DMAFrameInfo * fi = dmabufOpenDMAFrameInfo(this, &msg, frame,
-        frame->frameHeight * frame->pitch);
-
+    DMAFrameInfo * fi = this->dmaFrame;
     if (!fi->texture)
     {
       obs_enter_graphics();
@@ -859,49 +938,36 @@ static void lgVideoTick(void * data, float seconds)
         this->format,
         1,
         &fi->fd,
-        &(uint32_t) { frame->pitch },
+        &(uint32_t) { this->pitch },
         &(uint32_t) { 0 },
         &(uint64_t) { 0 });
       obs_leave_graphics();
-    }
 
-    lgmpClientMessageDone(this->frameQueue);
-
-    // wait for the frame to be complete before we try to use it
-    FrameBuffer * fb = (FrameBuffer *)(((uint8_t*)frame) + frame->offset);
-    framebuffer_wait(fb, frame->frameHeight * frame->pitch);
+      if (!fi->texture && !this->dmabufTested)
+      {
+        /* fall back to CPU copies, the format must be set up again */
+        puts("Failed to create dmabuf texture");
+        this->dmabuf      = false;
+        this->formatValid = false;
+      }
+      this->dmabufTested = true;
+    }
 
     this->dmaTexture = fi->texture;
-    os_sem_post(this->frameSem);
+    pthread_mutex_unlock(&this->frameLock);
     return;
   }
 #endif
 
-  if (!this->texture)
+  if (this->texture)
   {
-    lgmpClientMessageDone(this->frameQueue);
-    os_sem_post(this->frameSem);
-    return;
+    obs_enter_graphics();
+    gs_texture_unmap(this->texture);
+    gs_texture_map(this->texture, &this->texData, &this->linesize);
+    obs_leave_graphics();
   }
 
-  FrameBuffer * fb = (FrameBuffer *)(((uint8_t*)frame) + frame->offset);
-  framebuffer_read(
-      fb,
-      this->texData   , // dst
-      this->linesize  , // dstpitch
-      this->dataHeight, // height
-      this->dataWidth , // width
-      this->bpp       , // bpp
-      frame->pitch
-  );
-
-  lgmpClientMessageDone(this->frameQueue);
-  os_sem_post(this->frameSem);
-
-  obs_enter_graphics();
-  gs_texture_unmap(this->texture);
-  gs_texture_map(this->texture, &this->texData, &this->linesize);
-  obs_leave_graphics();
+  pthread_mutex_unlock(&this->frameLock);
 }
 
 static void lgVideoRender(void * data, gs_effect_t * effect)
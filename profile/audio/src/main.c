@@ -0,0 +1,284 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Replays Spice audio packet timing through the client's playback conversion
+ * and resampling path to measure its CPU cost and the resulting latency.
+ *
+ * A trace file contains one packet per line in the form `<time_us> <frames>`
+ * where `time_us` is the arrival time of the packet. If no trace is given a
+ * synthetic one is generated using the period and jitter options. */
+
+#include "common/debug.h"
+#include "common/option.h"
+#include "common/resampler.h"
+#include "common/sampleconv.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+  uint64_t time;
+  int      frames;
+}
+Packet;
+
+static struct Option options[] =
+{
+  {
+    .module         = "audio",
+    .name           = "trace",
+    .description    = "The timing trace to replay",
+    .shortopt       = 't',
+    .type           = OPTION_TYPE_STRING,
+    .value.x_string = NULL
+  },
+  {
+    .module         = "audio",
+    .name           = "sampleRate",
+    .description    = "The sample rate of the stream",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 48000
+  },
+  {
+    .module         = "audio",
+    .name           = "channels",
+    .description    = "The number of channels in the stream",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 2
+  },
+  {
+    .module         = "audio",
+    .name           = "period",
+    .description    = "The synthetic packet size in frames",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 480
+  },
+  {
+    .module         = "audio",
+    .name           = "jitter",
+    .description    = "The maximum synthetic packet jitter in milliseconds",
+    .type           = OPTION_TYPE_FLOAT,
+    .value.x_float  = 2.0f
+  },
+  {
+    .module         = "audio",
+    .name           = "seconds",
+    .description    = "The length of the synthetic trace in seconds",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 60
+  },
+  {
+    .module         = "audio",
+    .name           = "drift",
+    .description    = "The device clock drift in parts per million",
+    .type           = OPTION_TYPE_FLOAT,
+    .value.x_float  = 100.0f
+  },
+  {
+    .module         = "audio",
+    .name           = "targetLatency",
+    .description    = "The target buffer latency in milliseconds",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 13
+  },
+  {0}
+};
+
+static Packet * loadTrace(const char * file, int * count)
+{
+  FILE * fp = fopen(file, "r");
+  if (!fp)
+  {
+    DEBUG_ERROR("Failed to open %s", file);
+    return NULL;
+  }
+
+  int      size    = 1024;
+  Packet * packets = malloc(sizeof(*packets) * size);
+  *count = 0;
+
+  unsigned long long time;
+  int frames;
+  while(fscanf(fp, "%llu %d", &time, &frames) == 2)
+  {
+    if (*count == size)
+    {
+      size   *= 2;
+      packets = realloc(packets, sizeof(*packets) * size);
+    }
+
+    packets[(*count)++] = (Packet)
+    {
+      .time   = time * 1000ULL,
+      .frames = frames
+    };
+  }
+
+  fclose(fp);
+
+  if (*count == 0)
+  {
+    DEBUG_ERROR("The trace is empty");
+    free(packets);
+    return NULL;
+  }
+
+  // make the trace relative to the first packet
+  for(int i = *count - 1; i >= 0; --i)
+    packets[i].time -= packets[0].time;
+
+  return packets;
+}
+
+static Packet * syntheticTrace(int sampleRate, int * count)
+{
+  const int   period  = option_get_int  ("audio", "period" );
+  const int   seconds = option_get_int  ("audio", "seconds");
+  const float jitter  = option_get_float("audio", "jitter" );
+
+  *count = (int)((uint64_t)seconds * sampleRate / period);
+  Packet * packets = malloc(sizeof(*packets) * *count);
+
+  const double periodNs = period * 1.0e9 / sampleRate;
+  for(int i = 0; i < *count; ++i)
+  {
+    const double j = ((double)rand() / RAND_MAX) * jitter * 1.0e6;
+    packets[i] = (Packet)
+    {
+      .time   = llrint(i * periodNs + j),
+      .frames = period
+    };
+  }
+
+  return packets;
+}
+
+int main(int argc, char * argv[])
+{
+  debug_init();
+  DEBUG_INFO("Looking Glass - Audio Profiler");
+
+  option_register(options);
+  if (!option_parse(argc, argv) || !option_validate())
+  {
+    option_free();
+    return -1;
+  }
+
+  const int    sampleRate = option_get_int  ("audio", "sampleRate");
+  const int    channels   = option_get_int  ("audio", "channels"  );
+  const double drift      = option_get_float("audio", "drift"     ) * 1.0e-6;
+  const double target     =
+    option_get_int("audio", "targetLatency") * sampleRate / 1000.0;
+
+  int      count;
+  Packet * packets;
+  const char * trace = option_get_string("audio", "trace");
+  if (trace)
+    packets = loadTrace(trace, &count);
+  else
+    packets = syntheticTrace(sampleRate, &count);
+
+  if (!packets)
+  {
+    option_free();
+    return -1;
+  }
+
+  int maxFrames = 0;
+  for(int i = 0; i < count; ++i)
+    maxFrames = max(maxFrames, packets[i].frames);
+
+  int16_t * s16     = malloc(sizeof(*s16) * maxFrames * channels);
+  float   * in      = malloc(sizeof(*in ) * maxFrames * channels);
+  const int outSize = maxFrames + maxFrames / 10 + 1;
+  float   * out     = malloc(sizeof(*out) * outSize   * channels);
+  Resampler rs      = resampler_new(channels, maxFrames);
+
+  for(int i = 0; i < maxFrames * channels; ++i)
+    s16[i] = (int16_t)(sin(i * 0.05) * 16384.0);
+
+  uint64_t convertNs  = 0;
+  uint64_t resampleNs = 0;
+  uint64_t inFrames   = 0;
+
+  /* The device consumes at the nominal rate plus drift, the same PI controller
+   * gains as the client are used to steer the resampling ratio */
+  double written      = target;
+  double integral     = 0.0;
+  double latencyMin   = INFINITY;
+  double latencyMax   = -INFINITY;
+  double latencyTotal = 0.0;
+
+  for(int i = 0; i < count; ++i)
+  {
+    const Packet * p = packets + i;
+
+    const double consumed = p->time * 1.0e-9 * sampleRate * (1.0 + drift);
+    const double level    = written - consumed;
+    const double error    = target - level;
+    const double periodSec = (double)p->frames / sampleRate;
+
+    integral += error * periodSec;
+    const double ratio = 1.0 + 0.5e-6 * error + 1.0e-16 * integral;
+
+    uint64_t t = nanotime();
+    sampleconv_s16ToFloat(s16, in, p->frames * channels);
+    convertNs += nanotime() - t;
+
+    t = nanotime();
+    const int generated = resampler_process(rs, in, p->frames, out, outSize,
+        ratio);
+    resampleNs += nanotime() - t;
+
+    written  += generated;
+    inFrames += p->frames;
+
+    const double latencyMs =
+      (level + resampler_getLatency()) * 1000.0 / sampleRate;
+    latencyMin    = min(latencyMin, latencyMs);
+    latencyMax    = max(latencyMax, latencyMs);
+    latencyTotal += latencyMs;
+  }
+
+  const double audioSec = (double)inFrames / sampleRate;
+  fprintf(stdout, "packets   : %d (%.2f s of audio)\n", count, audioSec);
+  fprintf(stdout, "convert   : %7.2f ns/frame (%.4f%% cpu)\n",
+      (double)convertNs / inFrames, convertNs * 1.0e-7 / audioSec);
+  fprintf(stdout, "resample  : %7.2f ns/frame (%.4f%% cpu)\n",
+      (double)resampleNs / inFrames, resampleNs * 1.0e-7 / audioSec);
+  fprintf(stdout, "latency   : min:%.2f ms max:%.2f ms avg:%.2f ms "
+      "(resampler %.2f ms)\n",
+      latencyMin, latencyMax, latencyTotal / count,
+      resampler_getLatency() * 1000.0 / sampleRate);
+
+  resampler_free(&rs);
+  free(out);
+  free(in);
+  free(s16);
+  free(packets);
+  option_free();
+  return 0;
+}
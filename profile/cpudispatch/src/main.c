@@ -0,0 +1,360 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Cross-checks every CPU dispatch tier of the SIMD kernels against the
+ * portable C implementation and reports the throughput of each.
+ *
+ * Each tier that has its own implementation of a kernel is forced in turn with
+ * cpuDispatch_setTier and the kernel is called through its public function
+ * pointer, exactly as the host and client do. The process exits with a non
+ * zero status if any implementation disagrees with C. */
+
+#include "common/array.h"
+#include "common/cpudispatch.h"
+#include "common/debug.h"
+#include "common/framebuffer.h"
+#include "common/hdrconv.h"
+#include "common/option.h"
+#include "common/rects.h"
+#include "common/sampleconv.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct Option options[] =
+{
+  {
+    .module         = "cpudispatch",
+    .name           = "width",
+    .description    = "The width of the test image in pixels, odd by default "
+                      "so that the rows are not vector aligned",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 1921
+  },
+  {
+    .module         = "cpudispatch",
+    .name           = "height",
+    .description    = "The height of the test image in pixels",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 1080
+  },
+  {
+    .module         = "cpudispatch",
+    .name           = "iterations",
+    .description    = "The number of timed runs of each implementation",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 50
+  },
+  {0}
+};
+
+typedef struct
+{
+  int      width;
+  int      height;
+  size_t   size;      // the size of the test image in bytes, 4 bytes per pixel
+  size_t   samples;   // the number of audio samples
+  uint8_t  * src;
+  uint8_t  * dst;
+  uint8_t  * ref;
+  uint8_t  * fbMem;
+  FrameBuffer * fb;
+}
+Test;
+
+typedef struct
+{
+  const char * kernel;
+  const char * label;
+  void   (*run)(Test * t, void * dst);
+  bool   (*compare)(Test * t, const void * ref, const void * dst);
+  size_t (*bytes)(Test * t);
+}
+Check;
+
+static void fillRandom(uint8_t * buf, size_t size)
+{
+  for(size_t i = 0; i < size; ++i)
+    buf[i] = rand();
+}
+
+static bool compareExact(Test * t, const void * ref, const void * dst)
+{
+  return memcmp(ref, dst, t->size) == 0;
+}
+
+static size_t imageBytes(Test * t)
+{
+  return t->size;
+}
+
+static void runFramebufferWrite(Test * t, void * dst)
+{
+  framebuffer_prepare(t->fb);
+  framebuffer_write(t->fb, t->src, t->size);
+}
+
+static bool compareFramebuffer(Test * t, const void * ref, const void * dst)
+{
+  return
+    atomic_load(&t->fb->wp) == t->size &&
+    memcmp(framebuffer_get_buffer(t->fb), t->src, t->size) == 0;
+}
+
+/* a mix of wide and narrow rects at every alignment, copied over a fixed
+ * pattern so any write outside of the rects is caught */
+static void runRectCopy(Test * t, void * dst)
+{
+  const int pitch = t->width * 4;
+  memset(dst, 0x5A, t->size);
+
+  int y = 0;
+  for(int i = 0; y < t->height; ++i)
+  {
+    const int rows  = 1 + i % 7;
+    const int dx    = (i * 13) % 97;
+    const int width = i % 3 == 0 ? pitch - dx - (i % 61) : 1 + (i * 29) % 300;
+    const int yend  = min(y + rows, t->height);
+
+    rectCopyUnaligned(dst, t->src, y, yend, dx, pitch, pitch, width);
+    y = yend;
+  }
+}
+
+static void runS16ToFloat(Test * t, void * dst)
+{
+  sampleconv_s16ToFloat((const int16_t *)t->src, dst, t->samples);
+}
+
+static bool compareS16ToFloat(Test * t, const void * ref, const void * dst)
+{
+  return memcmp(ref, dst, t->samples * sizeof(float)) == 0;
+}
+
+static size_t s16Bytes(Test * t)
+{
+  return t->samples * sizeof(int16_t);
+}
+
+static void runFloatToS16(Test * t, void * dst)
+{
+  sampleconv_floatToS16((const float *)t->src, dst, t->samples);
+}
+
+static bool compareFloatToS16(Test * t, const void * ref, const void * dst)
+{
+  return memcmp(ref, dst, t->samples * sizeof(int16_t)) == 0;
+}
+
+static size_t floatBytes(Test * t)
+{
+  return t->samples * sizeof(float);
+}
+
+static void runHDR(Test * t, void * dst, bool pq)
+{
+  const size_t srcPitch = t->width * 8;
+  for(int y = 0; y < t->height / 2; ++y)
+    hdrconv_rgba16fToRGB10((const uint16_t *)(t->src + y * srcPitch),
+        (uint32_t *)dst + y * t->width, t->width, pq);
+}
+
+static void runHDRLinear(Test * t, void * dst)
+{
+  runHDR(t, dst, false);
+}
+
+static void runHDRPQ(Test * t, void * dst)
+{
+  runHDR(t, dst, true);
+}
+
+static bool compareHDR(Test * t, const void * ref, const void * dst,
+    int tolerance)
+{
+  const uint32_t * a = ref;
+  const uint32_t * b = dst;
+  const size_t count = (size_t)t->width * (t->height / 2);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    if ((a[i] & 0xC0000000) != (b[i] & 0xC0000000))
+      return false;
+
+    for(int c = 0; c < 3; ++c)
+    {
+      const int ca = (a[i] >> (c * 10)) & 0x3FF;
+      const int cb = (b[i] >> (c * 10)) & 0x3FF;
+      if (abs(ca - cb) > tolerance)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// the SIMD implementations round to nearest even rather than up
+static bool compareHDRLinear(Test * t, const void * ref, const void * dst)
+{
+  return compareHDR(t, ref, dst, 1);
+}
+
+/* the SIMD implementations look the PQ encoding up from the half precision
+ * input which loses a few steps in the darkest values */
+static bool compareHDRPQ(Test * t, const void * ref, const void * dst)
+{
+  return compareHDR(t, ref, dst, 3);
+}
+
+static size_t hdrBytes(Test * t)
+{
+  return (size_t)t->width * (t->height / 2) * 8;
+}
+
+static const Check checks[] =
+{
+  { "framebuffer_write", "framebuffer_write",
+    runFramebufferWrite, compareFramebuffer, imageBytes },
+  { "rectCopyUnaligned", "rectCopyUnaligned",
+    runRectCopy, compareExact, imageBytes },
+  { "sampleconv_s16ToFloat", "sampleconv_s16ToFloat",
+    runS16ToFloat, compareS16ToFloat, s16Bytes },
+  { "sampleconv_floatToS16", "sampleconv_floatToS16",
+    runFloatToS16, compareFloatToS16, floatBytes },
+  { "hdrconv_rgba16fToRGB10", "hdrconv_rgba16fToRGB10 (linear)",
+    runHDRLinear, compareHDRLinear, hdrBytes },
+  { "hdrconv_rgba16fToRGB10", "hdrconv_rgba16fToRGB10 (PQ)",
+    runHDRPQ, compareHDRPQ, hdrBytes },
+};
+
+/* fills the source buffer with data that is valid input for the check */
+static void prepareSource(Test * t, const Check * check)
+{
+  fillRandom(t->src, t->size);
+
+  if (check->run == runFloatToS16)
+  {
+    // include values outside of [-1.0, 1.0] to exercise the clamping
+    float * f = (float *)t->src;
+    for(size_t i = 0; i < t->samples; ++i)
+      f[i] = ((float)rand() / RAND_MAX) * 2.5f - 1.25f;
+    f[0] = 1.0f;
+    f[1] = -1.0f;
+  }
+  else if (check->run == runHDRLinear || check->run == runHDRPQ)
+  {
+    // finite halfs only, up to ~500 in scRGB
+    uint16_t * h = (uint16_t *)t->src;
+    for(size_t i = 0; i < t->size / 2; ++i)
+      h[i] = (h[i] & 0x83FF) | ((rand() % 24) << 10);
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  debug_init();
+  DEBUG_INFO("Looking Glass - CPU Dispatch Profiler");
+
+  option_register(options);
+  if (!option_parse(argc, argv) || !option_validate())
+  {
+    option_free();
+    return -1;
+  }
+
+  Test t =
+  {
+    .width  = option_get_int("cpudispatch", "width" ),
+    .height = option_get_int("cpudispatch", "height")
+  };
+  const int iterations = option_get_int("cpudispatch", "iterations");
+
+  t.size    = (size_t)t.width * t.height * 4;
+  t.samples = t.size / sizeof(float);
+  t.src     = aligned_alloc(64, ALIGN_TO(t.size, 64));
+  t.dst     = aligned_alloc(64, ALIGN_TO(t.size, 64));
+  t.ref     = aligned_alloc(64, ALIGN_TO(t.size, 64));
+
+  // place the framebuffer so that its data is 64 byte aligned
+  t.fbMem = aligned_alloc(64, ALIGN_TO(t.size + 64, 64));
+  t.fb    = (FrameBuffer *)(t.fbMem + 64 - FB_WP_SIZE);
+
+  const CPUTier defaultTier = cpuDispatch_getTier();
+  fprintf(stdout, "default tier: %s\n\n", cpuDispatch_tierName(defaultTier));
+  fprintf(stdout, "%-32s %-8s %-6s %10s\n", "kernel", "tier", "result", "MB/s");
+
+  int failed = 0;
+  for(int i = 0; i < ARRAY_LENGTH(checks); ++i)
+  {
+    const Check * check = checks + i;
+    const CPUDispatchKernel * kernel = cpuDispatch_findKernel(check->kernel);
+    DEBUG_ASSERT(kernel);
+
+    srand(i);
+    prepareSource(&t, check);
+
+    cpuDispatch_setTier(CPU_TIER_C);
+    check->run(&t, t.ref);
+
+    for(int tier = 0; tier < CPU_TIER_MAX; ++tier)
+    {
+      if (!cpuDispatch_getImpl(kernel, tier))
+        continue;
+
+      cpuDispatch_setTier(tier);
+      memset(t.dst, 0, t.size);
+      check->run(&t, t.dst);
+
+      const bool ok = tier == CPU_TIER_C || check->compare(&t, t.ref, t.dst);
+      if (!ok)
+        ++failed;
+
+      const uint64_t start = nanotime();
+      for(int n = 0; n < iterations; ++n)
+        check->run(&t, t.dst);
+      const uint64_t elapsed = nanotime() - start;
+
+      fprintf(stdout, "%-32s %-8s %-6s %10.1f\n",
+          check->label, cpuDispatch_tierName(tier), ok ? "ok" : "FAIL",
+          (double)check->bytes(&t) * iterations / (elapsed / 1e3));
+    }
+  }
+
+  cpuDispatch_setTier(defaultTier);
+
+  free(t.fbMem);
+  free(t.ref);
+  free(t.dst);
+  free(t.src);
+  option_free();
+
+  if (failed)
+  {
+    DEBUG_ERROR("%d implementation(s) disagree with the C implementation",
+        failed);
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Measures the cost of LGEvent in the three patterns the client and host use:
+ *
+ *   signal    - signaling an event nobody is waiting on (ie, frameEvent when
+ *               the render thread is busy)
+ *   pingpong  - two threads handing control back and forth via a pair of auto
+ *               reset events, reports the round trip wakeup latency
+ *   contended - several threads signaling one auto reset event that a single
+ *               thread is consuming */
+
+#include "common/debug.h"
+#include "common/event.h"
+#include "common/option.h"
+#include "common/thread.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct Option options[] =
+{
+  {
+    .module         = "event",
+    .name           = "iterations",
+    .description    = "The number of iterations for each test",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 100000
+  },
+  {
+    .module         = "event",
+    .name           = "spinTime",
+    .description    = "The spin time to create the events with in milliseconds",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 0
+  },
+  {
+    .module         = "event",
+    .name           = "signalers",
+    .description    = "The number of signaling threads for the contended test",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 4
+  },
+  {0}
+};
+
+static struct
+{
+  int         iterations;
+  LGEvent   * ping;
+  LGEvent   * pong;
+  LGEvent   * contended;
+  atomic_bool running;
+}
+state;
+
+static int pongThread(void * opaque)
+{
+  for(int i = 0; i < state.iterations; ++i)
+  {
+    lgWaitEvent(state.ping, TIMEOUT_INFINITE);
+    lgSignalEvent(state.pong);
+  }
+  return 0;
+}
+
+static int signalThread(void * opaque)
+{
+  uint64_t * count = (uint64_t *)opaque;
+  while(atomic_load(&state.running))
+  {
+    lgSignalEvent(state.contended);
+    ++*count;
+  }
+  return 0;
+}
+
+int main(int argc, char * argv[])
+{
+  debug_init();
+  DEBUG_INFO("Looking Glass - Event Profiler");
+
+  option_register(options);
+  if (!option_parse(argc, argv) || !option_validate())
+  {
+    option_free();
+    return -1;
+  }
+
+  state.iterations    = max(option_get_int("event", "iterations"), 1);
+  const int spinTime  = max(option_get_int("event", "spinTime"  ), 0);
+  const int signalers = max(option_get_int("event", "signalers" ), 1);
+
+  state.ping      = lgCreateEvent(true, spinTime);
+  state.pong      = lgCreateEvent(true, spinTime);
+  state.contended = lgCreateEvent(true, spinTime);
+  if (!state.ping || !state.pong || !state.contended)
+  {
+    DEBUG_ERROR("Failed to create the events");
+    return -1;
+  }
+
+  // signal
+  uint64_t start = nanotime();
+  for(int i = 0; i < state.iterations; ++i)
+    lgSignalEvent(state.contended);
+  const double signalNs = (double)(nanotime() - start) / state.iterations;
+  lgResetEvent(state.contended);
+
+  // pingpong
+  LGThread * thread;
+  if (!lgCreateThread("pong", pongThread, NULL, &thread))
+    return -1;
+
+  start = nanotime();
+  for(int i = 0; i < state.iterations; ++i)
+  {
+    lgSignalEvent(state.ping);
+    lgWaitEvent(state.pong, TIMEOUT_INFINITE);
+  }
+  const double pingpongNs = (double)(nanotime() - start) / state.iterations;
+  lgJoinThread(thread, NULL);
+
+  // contended
+  LGThread ** threads = calloc(signalers, sizeof(*threads));
+  uint64_t  * signals = calloc(signalers, sizeof(*signals));
+  atomic_store(&state.running, true);
+  for(int i = 0; i < signalers; ++i)
+    if (!lgCreateThread("signal", signalThread, signals + i, threads + i))
+      return -1;
+
+  start = nanotime();
+  for(int i = 0; i < state.iterations; ++i)
+    lgWaitEvent(state.contended, TIMEOUT_INFINITE);
+  const uint64_t elapsed = nanotime() - start;
+
+  atomic_store(&state.running, false);
+  uint64_t totalSignals = 0;
+  for(int i = 0; i < signalers; ++i)
+  {
+    lgJoinThread(threads[i], NULL);
+    totalSignals += signals[i];
+  }
+
+  fprintf(stdout, "signal    : %8.1f ns\n", signalNs);
+  fprintf(stdout, "pingpong  : %8.1f ns/round trip\n", pingpongNs);
+  fprintf(stdout, "contended : %8.1f ns/wait (%d signalers, %.1f ns/signal)\n",
+      (double)elapsed / state.iterations, signalers,
+      (double)elapsed * signalers / totalSignals);
+
+  free(signals);
+  free(threads);
+  lgFreeEvent(state.contended);
+  lgFreeEvent(state.pong);
+  lgFreeEvent(state.ping);
+  option_free();
+  return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * Looking Glass
+ * Copyright © 2017-2025 The Looking Glass Authors
+ * https://looking-glass.io
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 59
+ * Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Runs a set of idle lgCreateTimer timers and reports how often the process
+ * is woken up, along with how late each timer callback fires.
+ *
+ * Wakeups are counted from the context switches of every thread other than
+ * the main thread, which just sleeps for the duration of the run. */
+
+#include "common/debug.h"
+#include "common/option.h"
+#include "common/time.h"
+#include "common/util.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct
+{
+  LGTimer  * timer;
+  uint64_t   interval;
+  uint64_t   expected;
+  uint64_t   fired;
+  double     lateMin;
+  double     lateMax;
+  double     lateTotal;
+}
+Timer;
+
+static struct Option options[] =
+{
+  {
+    .module         = "timer",
+    .name           = "count",
+    .description    = "The number of timers to run",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 2
+  },
+  {
+    .module         = "timer",
+    .name           = "interval",
+    .description    = "The interval of the first timer in microseconds, "
+                      "each additional timer doubles it",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 1000
+  },
+  {
+    .module         = "timer",
+    .name           = "seconds",
+    .description    = "The length of the run in seconds",
+    .type           = OPTION_TYPE_INT,
+    .value.x_int    = 10
+  },
+  {0}
+};
+
+static uint64_t contextSwitches(void)
+{
+  DIR * dir = opendir("/proc/self/task");
+  if (!dir)
+  {
+    DEBUG_ERROR("Failed to open /proc/self/task");
+    return 0;
+  }
+
+  const pid_t pid = getpid();
+  uint64_t total = 0;
+
+  struct dirent * ent;
+  while((ent = readdir(dir)))
+  {
+    if (ent->d_name[0] == '.' || atoi(ent->d_name) == pid)
+      continue;
+
+    char path[300];
+    snprintf(path, sizeof(path), "/proc/self/task/%s/status", ent->d_name);
+    FILE * fp = fopen(path, "r");
+    if (!fp)
+      continue;
+
+    char line[128];
+    unsigned long long value;
+    while(fgets(line, sizeof(line), fp))
+      if (sscanf(line, "voluntary_ctxt_switches: %llu"   , &value) == 1 ||
+          sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+        total += value;
+
+    fclose(fp);
+  }
+
+  closedir(dir);
+  return total;
+}
+
+static bool timerFn(void * udata)
+{
+  Timer * t = (Timer *)udata;
+  const uint64_t now  = nanotime();
+  const double   late = (double)((int64_t)(now - t->expected)) * 1.0e-3;
+
+  t->lateMin    = min(t->lateMin, late);
+  t->lateMax    = max(t->lateMax, late);
+  t->lateTotal += late;
+  ++t->fired;
+
+  t->expected += t->interval;
+  if (t->expected <= now)
+    t->expected = now + t->interval;
+
+  return true;
+}
+
+int main(int argc, char * argv[])
+{
+  debug_init();
+  DEBUG_INFO("Looking Glass - Timer Profiler");
+
+  option_register(options);
+  if (!option_parse(argc, argv) || !option_validate())
+  {
+    option_free();
+    return -1;
+  }
+
+  const int count    = max(option_get_int("timer", "count"), 0);
+  const int interval = max(option_get_int("timer", "interval"), 1);
+  const int seconds  = max(option_get_int("timer", "seconds"), 1);
+
+  Timer * timers = calloc(count, sizeof(*timers));
+  for(int i = 0; i < count; ++i)
+  {
+    Timer * t = timers + i;
+    t->interval = ((uint64_t)interval << i) * 1000ULL;
+    t->expected = nanotime() + t->interval;
+    t->lateMin  = INFINITY;
+    t->lateMax  = -INFINITY;
+
+    if (!lgCreateTimerUS(interval << i, timerFn, t, &t->timer))
+    {
+      DEBUG_ERROR("Failed to create timer %d", i);
+      return -1;
+    }
+  }
+
+  const uint64_t startSwitches = contextSwitches();
+  const uint64_t start         = nanotime();
+  nsleep((uint64_t)seconds * 1000000000ULL);
+  const double   elapsed       = (nanotime() - start) * 1.0e-9;
+  const uint64_t switches      = contextSwitches() - startSwitches;
+
+  for(int i = 0; i < count; ++i)
+    lgTimerDestroy(timers[i].timer);
+
+  uint64_t fired = 0;
+  for(int i = 0; i < count; ++i)
+  {
+    const Timer * t = timers + i;
+    fired += t->fired;
+    if (!t->fired)
+    {
+      fprintf(stdout, "timer %-2d  : %8.3f ms never fired\n", i,
+          t->interval * 1.0e-6);
+      continue;
+    }
+
+    fprintf(stdout, "timer %-2d  : %8.3f ms fired:%-6" PRIu64
+        " late min:%.1f us max:%.1f us avg:%.1f us\n",
+        i, t->interval * 1.0e-6, t->fired,
+        t->lateMin, t->lateMax, t->lateTotal / t->fired);
+  }
+
+  fprintf(stdout, "callbacks : %8.1f/s\n", fired    / elapsed);
+  fprintf(stdout, "wakeups   : %8.1f/s\n", switches / elapsed);
+
+  free(timers);
+  option_free();
+  return 0;
+}